@@ -0,0 +1,80 @@
+/**
+ * ArcTable.cpp
+ *
+ * Construction of the adjacency table of a network, by counting sort of the arcs on their source and target nodes.
+ */
+
+#include "ArcTable.h"
+
+#include "ExternTrace.h"
+
+ArcTable::ArcTable(){
+	outStart.push_back(0);
+	inStart.push_back(0);
+}
+
+/**
+ * int ArcTable::update(const SmartDigraph&, const SmartDigraph::NodeMap<Molecule*>&, const SmartDigraph::ArcMap<Interaction*>&)
+ *
+ * Bring the table up to date with the graph. Nothing is done if no nodes or arcs were added since the last update,
+ * otherwise the new nodes are appended and the arc ranges are rebuilt.
+ *
+ * @param g the graph of the network
+ * @param molecules the molecules of the nodes
+ * @param interactions the interactions of the arcs
+ *
+ * @return 1 if the table was rebuilt, 0 if it was up to date
+ */
+int ArcTable::update(const SmartDigraph& g, const SmartDigraph::NodeMap<Molecule*>& molecules, const SmartDigraph::ArcMap<Interaction*>& interactions){
+
+	int numNodes = g.maxNodeId() + 1;
+	int numArcs = g.maxArcId() + 1;
+
+	if(numNodes == (int)nodes.size() && numArcs == (int)records.size())
+		return 0;
+
+	for(int id = nodes.size(); id < numNodes; id++)
+		nodes.push_back(molecules[g.nodeFromId(id)]);
+
+	//number of arcs leaving and entering each node
+	outStart.assign(numNodes + 1, 0);
+	inStart.assign(numNodes + 1, 0);
+	for(int id = 0; id < numArcs; id++){
+		SmartDigraph::Arc a = g.arcFromId(id);
+		outStart[g.id(g.source(a)) + 1]++;
+		inStart[g.id(g.target(a)) + 1]++;
+	}
+	for(int n = 0; n < numNodes; n++){
+		outStart[n + 1] += outStart[n];
+		inStart[n + 1] += inStart[n];
+	}
+
+	//place the arcs in increasing id order, so each range is sorted
+	vector<int> outNext(outStart.begin(), outStart.end() - 1);
+	vector<int> inNext(inStart.begin(), inStart.end() - 1);
+
+	records.resize(numArcs);
+	position.resize(numArcs);
+	inArcs.resize(numArcs);
+
+	for(int id = 0; id < numArcs; id++){
+		SmartDigraph::Arc a = g.arcFromId(id);
+
+		ArcRecord r;
+		r.id = id;
+		r.source = g.id(g.source(a));
+		r.target = g.id(g.target(a));
+		r.interaction = interactions[a];
+		r.kind = r.interaction->kind;
+		r.sourceMol = nodes[r.source];
+		r.targetMol = nodes[r.target];
+
+		int p = outNext[r.source]++;
+		records[p] = r;
+		position[id] = p;
+		inArcs[inNext[r.target]++] = p;
+	}
+
+	t.trace("mloc","ArcTable %p rebuilt with %d nodes and %d arcs\n", this, numNodes, numArcs);
+	return 1;
+}
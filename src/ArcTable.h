@@ -0,0 +1,76 @@
+/**
+ * ArcTable.h
+ *
+ * Compact adjacency table of a DerivGraph network, used by the solvers to iterate the interactions.
+ *
+ * The arcs are stored as records holding the interaction and the molecules at both ends, grouped by their source
+ * node: the arcs leaving a node are one contiguous range of records, in increasing id order. The arcs entering a
+ * node are a contiguous range of record positions. Nodes and arcs are found by their SmartDigraph id, as with
+ * SmartDigraph::nodeFromId() and arcFromId().
+ *
+ * Networks only grow, so a table is brought up to date by update() whenever nodes or arcs were added since it
+ * was built. The Molecules and Interactions themselves are not copied, so rate changes need no update.
+ *
+ */
+
+#ifndef ARCTABLE_H_
+#define ARCTABLE_H_
+
+#include <vector>
+#include "lemon/smart_graph.h"
+
+#include "Molecule.h"
+#include "Interaction.h"
+
+using namespace std;
+using namespace lemon;
+
+// one interaction of the network, with the molecules at both ends
+struct ArcRecord{
+	int id;
+	int source;
+	int target;
+	int kind;
+	Interaction* interaction;
+	Molecule* sourceMol;
+	Molecule* targetMol;
+};
+
+class ArcTable{
+
+public:
+	ArcTable();
+
+	int update(const SmartDigraph&, const SmartDigraph::NodeMap<Molecule*>&, const SmartDigraph::ArcMap<Interaction*>&);
+
+	int getNodeCount(){ return nodes.size(); };
+	int getArcCount(){ return records.size(); };
+
+	Molecule* nodeFromId(int id){ return nodes[id]; };
+	ArcRecord& arcFromId(int id){ return records[position[id]]; };
+
+	// the records of the arcs leaving node n
+	ArcRecord* outBegin(int n){ return base() + outStart[n]; };
+	ArcRecord* outEnd(int n){ return base() + outStart[n + 1]; };
+
+	// the record positions of the arcs entering node n
+	const int* inBegin(int n){ return inArcs.empty() ? 0 : &inArcs[0] + inStart[n]; };
+	const int* inEnd(int n){ return inArcs.empty() ? 0 : &inArcs[0] + inStart[n + 1]; };
+	ArcRecord& at(int p){ return records[p]; };
+
+private:
+	ArcRecord* base(){ return records.empty() ? 0 : &records[0]; };
+
+	vector<Molecule*> nodes;
+
+	// records, grouped by source node, and the position of each arc id among them
+	vector<ArcRecord> records;
+	vector<int> position;
+	vector<int> outStart;
+
+	// positions of the records grouped by target node
+	vector<int> inArcs;
+	vector<int> inStart;
+};
+
+#endif
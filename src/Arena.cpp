@@ -0,0 +1,184 @@
+/**
+ * Arena.cpp
+ *
+ * Chunked bump allocator, with a per-thread free list of chunks.
+ */
+
+#include <cstdlib>
+#include <pthread.h>
+
+#include "Arena.h"
+
+#include "ExternTrace.h"
+
+// allocations are aligned for any of the member types of the network objects
+#define ARENA_ALIGN (sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*))
+
+// start of every chunk
+struct ChunkHeader{
+	char* next;
+	size_t size;
+};
+
+// space taken by the header at the start of a chunk
+#define ARENA_HEADER_SIZE ((sizeof(ChunkHeader) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+// free chunks of the default size, linked through their headers. One list per thread
+struct ChunkCache{
+	char* head;
+	int count;
+};
+
+static pthread_key_t cacheKey;
+static pthread_once_t cacheOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * static void freeCache(void*)
+ *
+ * Return the free chunks of a thread to the heap when the thread exits.
+ *
+ * @param p the ChunkCache of the thread
+ */
+static void freeCache(void* p){
+
+	ChunkCache* cache = (ChunkCache*) p;
+	while(cache->head){
+		char* next = ((ChunkHeader*) cache->head)->next;
+		free(cache->head);
+		cache->head = next;
+	}
+	delete cache;
+}
+
+static void makeCacheKey(){
+	pthread_key_create(&cacheKey, freeCache);
+}
+
+/**
+ * static ChunkCache* getCache()
+ *
+ * @return the free list of the calling thread
+ */
+static ChunkCache* getCache(){
+
+	pthread_once(&cacheOnce, makeCacheKey);
+
+	ChunkCache* cache = (ChunkCache*) pthread_getspecific(cacheKey);
+	if(!cache){
+		cache = new ChunkCache();
+		cache->head = 0;
+		cache->count = 0;
+		pthread_setspecific(cacheKey, cache);
+	}
+	return cache;
+}
+
+/**
+ * Arena::Arena(size_t)
+ *
+ * Create an empty arena. No memory is allocated until the first call to allocate.
+ *
+ * @param chunk the size of each chunk, larger requests get a chunk of their own
+ */
+Arena::Arena(size_t chunk){
+
+	chunkSize = chunk;
+	current = 0;
+	used = 0;
+	totalSize = 0;
+}
+
+/**
+ * Arena::~Arena()
+ *
+ * Release every chunk. Destructors of the objects in the arena are not called.
+ */
+Arena::~Arena(){
+
+	while(current){
+		ChunkHeader* h = (ChunkHeader*) current;
+		current = h->next;
+		freeChunk((char*) h, h->size);
+	}
+}
+
+/**
+ * char* Arena::newChunk(size_t)
+ *
+ * @param len the size of the chunk
+ *
+ * @return a chunk from the free list of the calling thread if it has one of this size, or from the heap
+ */
+char* Arena::newChunk(size_t len){
+
+	if(len == ARENA_CHUNK_SIZE){
+		ChunkCache* cache = getCache();
+		if(cache->head){
+			char* c = cache->head;
+			cache->head = ((ChunkHeader*) c)->next;
+			cache->count--;
+			return c;
+		}
+	}
+
+	char* c = (char*) malloc(len);
+	if(!c){
+		t.trace("error","Arena %p could not allocate %d bytes\n", this, (int)len);
+		abort();
+	}
+	return c;
+}
+
+/**
+ * void Arena::freeChunk(char*, size_t)
+ *
+ * Put a chunk of the default size on the free list of the calling thread, unless the list is full. Other chunks are
+ * returned to the heap.
+ *
+ * @param c the chunk
+ * @param len the size of the chunk
+ */
+void Arena::freeChunk(char* c, size_t len){
+
+	if(len == ARENA_CHUNK_SIZE){
+		ChunkCache* cache = getCache();
+		if(cache->count < ARENA_CACHE_CHUNKS){
+			((ChunkHeader*) c)->next = cache->head;
+			cache->head = c;
+			cache->count++;
+			return;
+		}
+	}
+
+	free(c);
+}
+
+/**
+ * void* Arena::allocate(size_t)
+ *
+ * @param size the number of bytes needed
+ *
+ * @return aligned memory which stays valid until the arena is deleted
+ */
+void* Arena::allocate(size_t size){
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+	if(!current || used + size > ((ChunkHeader*) current)->size){
+
+		size_t len = ARENA_HEADER_SIZE + size > chunkSize ? ARENA_HEADER_SIZE + size : chunkSize;
+		char* c = newChunk(len);
+
+		ChunkHeader* h = (ChunkHeader*) c;
+		h->next = current;
+		h->size = len;
+
+		current = c;
+		totalSize += len;
+		used = ARENA_HEADER_SIZE;
+	}
+
+	void* p = current + used;
+	used += size;
+	return p;
+}
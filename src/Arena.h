@@ -0,0 +1,54 @@
+/**
+ * Arena.h
+ *
+ * Chunked bump allocator for the Molecule and Interaction objects of a DerivGraph.
+ *
+ * Members are only ever added to a network, and all of them live until the DerivGraph is deleted, so they are carved
+ * out of a few large chunks instead of being allocated one by one. Objects are placed with
+ *
+ *   new (arena) Protein(*other);
+ *
+ * and must be destroyed with an explicit destructor call. The memory is released when the Arena is deleted.
+ *
+ * Chunks of the default size are not returned to the heap, but kept in a free list of the thread which deleted the
+ * arena, and reused by the next arena that thread fills. Cells are copied and deleted every generation, so in the
+ * steady state building and destroying networks does not call malloc, and threads do not contend for the heap lock.
+ *
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+
+// default size of an arena chunk
+#define ARENA_CHUNK_SIZE 16384
+
+// number of free chunks each thread keeps for reuse, further chunks are returned to the heap
+#define ARENA_CACHE_CHUNKS 256
+
+class Arena{
+
+public:
+	Arena(size_t = ARENA_CHUNK_SIZE);
+	~Arena();
+
+	void* allocate(size_t);
+	size_t getSize(){ return totalSize; };
+
+private:
+	char* newChunk(size_t);
+	void freeChunk(char*, size_t);
+
+	// the chunk being filled. Every chunk starts with a ChunkHeader linking it to the chunk filled before it
+	char* current;
+
+	size_t chunkSize;
+	size_t used;
+	size_t totalSize;
+};
+
+inline void* operator new(size_t size, Arena& a){ return a.allocate(size); }
+inline void operator delete(void*, Arena&){}
+
+#endif
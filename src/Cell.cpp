@@ -20,7 +20,7 @@ int Cell::CellCounter = 0;
  * Allocates:
  * 	1 derivGraph object
  */
-Cell::Cell(int max_basic, int max_ptm, int max_comp, int max_promoter,float min_kinetic_rate, float max_kinetic_rate, float rk_time_step, float rk_time_limit, float initial_conc){
+Cell::Cell(int max_basic, int max_ptm, int max_comp, int max_promoter,float min_kinetic_rate, float max_kinetic_rate, float rk_time_step, float rk_time_limit, float initial_conc, int hill){
 
     t.trace("init", "Creating new Cell\n");
     t.trace("mloc", "Cell location at %p\n", this);
@@ -38,10 +38,20 @@ Cell::Cell(int max_basic, int max_ptm, int max_comp, int max_promoter,float min_
     //molecule initial concentration
     equations->setDefaultInitialConc(initial_conc);
 
+    //hill coefficient of the genes
+    equations->setHill(hill);
+
     rkTimeStep = rk_time_step;
     rkTimeLimit = rk_time_limit;
 
     currentGen = 0;
+    inherited = 0;
+    scoring = SCORE_COUNT;
+    cycleDetection = 0;
+    integrator = INTEGRATE_RK4;
+    slices = 0;
+    networkThreads = 1;
+    components = 0;
   
     //assign the cell a unique number 
     CellID = CellCounter++;
@@ -54,19 +64,69 @@ Cell::Cell(int max_basic, int max_ptm, int max_comp, int max_promoter,float min_
 
 }
 
+/**
+ * Cell::Cell(Snapshot&)
+ *
+ * Rebuild a cell written by Cell::save. The caller should check Snapshot::failed() afterwards.
+ *
+ * Allocates:
+ * 	1 derivGraph object
+ */
+Cell::Cell(Snapshot& s){
+
+    t.trace("init", "Restoring Cell\n");
+
+    CellID = s.getInt();
+    currentGen = s.getInt();
+    rkTimeStep = s.getFloat();
+    rkTimeLimit = s.getFloat();
+    s.getRandom(r);
+    inherited = s.getInt();
+    scoring = SCORE_COUNT;
+    cycleDetection = 0;
+    integrator = INTEGRATE_RK4;
+    slices = 0;
+    networkThreads = 1;
+    components = 0;
+
+    equations = new DerivGraph();
+    equations->load(s);
+
+    t.trace("init", "Cell %d restored at generation %d\n", CellID, currentGen);
+}
+
+/**
+ * void Cell::save(Snapshot&)
+ *
+ * Serialize the cell and its DerivGraph, including the state of both random generators.
+ *
+ * @param s the snapshot to append to
+ */
+void Cell::save(Snapshot& s){
+
+	s.putInt(CellID);
+	s.putInt(currentGen);
+	s.putFloat(rkTimeStep);
+	s.putFloat(rkTimeLimit);
+	s.putRandom(r);
+	s.putInt(inherited);
+
+	equations->save(s);
+}
+
 /**
  * Cell::~Cell()
  *
  * Cell default destructor.
  *
  * Frees:
- * 	1 derivGraph object
+ * 	1 derivGraph object (unless it is still shared with other cells)
  *
  */
 Cell::~Cell(){
 
-t.trace("free","Deleting DerivGraph object at %p\n", equations);
-delete equations;
+t.trace("free","Releasing DerivGraph object at %p\n", equations);
+equations->release();
 
 }
 
@@ -90,6 +150,7 @@ delete equations;
  *   New Protein-Promoter
  * (Null Mutation) -- no op
  *
+ * @return the MutationType which was selected
  */
 int Cell::mutate(){
 	//advance generation
@@ -99,6 +160,8 @@ int Cell::mutate(){
 	double mutationCategory = r.rand(1);
 	double mutationType = r.rand(1);
 
+	int selected = MUT_NULL;
+
 	//small mutation category
 	if(mutationCategory < .4)
 	{
@@ -108,31 +171,31 @@ int Cell::mutate(){
 		if(mutationType < .2)
 		{
 			t.trace("mutate","Mutation Type: Forward Rate Change\n");	
-			equations->forwardRateChange();
+			selected = MUT_FORWARD_RATE;
 		}
 		//reverse rate change
 		else if(mutationType < .4)
 		{
 			t.trace("mutate","Mutation Type: Reverse Rate Change\n");	
-			equations->reverseRateChange();
+			selected = MUT_REVERSE_RATE;
 		}
 		//degradation rate change
 		else if(mutationType < .6)
 		{
 			t.trace("mutate","Mutation Type: Degradation Rate Change\n");	
-			equations->degradationRateChange();
+			selected = MUT_DEGRADATION_RATE;
 		}
 		//new Post Translational Modification
 		else if(mutationType < .8)
 		{
 			t.trace("mutate","Mutation Type: New PTM\n");	
-			equations->newPTM();
+			selected = MUT_NEW_PTM;
 		}
 		//histone modification
 		else
 		{
 			t.trace("mutate","Mutation Type: Histone Modification\n");	
-			equations->histoneMod();
+			selected = MUT_HISTONE;
 		}
 	}
 	//large mutation category
@@ -143,27 +206,61 @@ int Cell::mutate(){
 		if(mutationType < .33)
 		{
 			t.trace("mutate","Mutation Type: New Protein-Protein Complex\n");	
-			equations->newComplex();
+			selected = MUT_NEW_COMPLEX;
 		}	
 		//new basic protein
 		else if(mutationType < .67)
 		{
 			t.trace("mutate","Mutation Type: New Basic Protein\n");	
-			equations->newBasic();
+			selected = MUT_NEW_BASIC;
 		}
 		//new protein-promoter
 		else
 		{
 			t.trace("mutate","Mutation Type: New Protein-Promoter Interaction\n");
-			equations->newPromoter();
+			selected = MUT_NEW_PROMOTER;
 		}
 	}
 	//null mutation
 	else
 		t.trace("mutate","Mutation Category: Null\n"); 
 	
+	//mutations stopped by a limit leave the network unchanged, so a shared network does not need to be copied
+	if(equations->isLimited(selected)){
+		t.trace("mutate","Mutation is at its limit\n");
+		return selected;
+	}
+
+	makeWritable();
+
+	switch(selected){
+	case MUT_FORWARD_RATE:
+		equations->forwardRateChange();
+		break;
+	case MUT_REVERSE_RATE:
+		equations->reverseRateChange();
+		break;
+	case MUT_DEGRADATION_RATE:
+		equations->degradationRateChange();
+		break;
+	case MUT_NEW_PTM:
+		equations->newPTM();
+		break;
+	case MUT_HISTONE:
+		equations->histoneMod();
+		break;
+	case MUT_NEW_COMPLEX:
+		equations->newComplex();
+		break;
+	case MUT_NEW_BASIC:
+		equations->newBasic();
+		break;
+	case MUT_NEW_PROMOTER:
+		equations->newPromoter();
+		break;
+	}
 	
-	return -1;
+	return selected;
 }
 /**
  * int Cell::getScore()
@@ -172,18 +269,44 @@ int Cell::mutate(){
  * down on generated data.
  *
  * The default behavior or getScore is to assign the score of the highest scored molecule within the cell to the cell itself.
+ * A network rejected by a screen scores 0 (see setRejected).
  *
  * @return the score of the cell
  */
 int Cell::getScore(){
 
 	//get highest scored molecule within the cell
-	Molecule* m = equations->getBestMolecule(CellID);
+	equations->lock();
+	if(equations->isRejected()){
+		equations->unlock();
+		return 0;
+	}
+	Molecule* m = equations->getBestMolecule(CellID, scoring);
 	
 	// return the score of the best molecule
-	return m->getScore();
+	int score = equations->getMoleculeScore(m, scoring);
+	equations->unlock();
+	return score;
 		
 }
+/**
+ * int Cell::getNodeCount()
+ *
+ * @return the number of molecules (nodes) in the cell, including the null node
+ */
+int Cell::getNodeCount(){
+	return equations->getNodeCount();
+}
+
+/**
+ * int Cell::getArcCount()
+ *
+ * @return the number of interactions (arcs) in the cell
+ */
+int Cell::getArcCount(){
+	return equations->getArcCount();
+}
+
 /**
  * void Cell::outputDotImage(const char*, int)
  *
@@ -193,7 +316,9 @@ int Cell::getScore(){
  * @param pid a relatively unique value for the output directory (the pid of the current process)
  */
 void Cell::outputDotImage(const char* prefix, int pid){
+	equations->lock();
 	equations->outputDotImage(prefix, pid, CellID, currentGen);
+	equations->unlock();
 }
 
 /**
@@ -207,7 +332,9 @@ void Cell::outputDotImage(const char* prefix, int pid){
  * @param pid a relatively unique value for the output directory (the pid of the current process)
  */
 void Cell::outputDataPlot(const char* prefix, int pid){
+	equations->lock();
 	equations->outputDataPlot(prefix, pid, CellID, currentGen, rkTimeStep);
+	equations->unlock();
 }
 
 /**
@@ -221,7 +348,9 @@ void Cell::outputDataPlot(const char* prefix, int pid){
  * @param pid a relatively unique value for the output directory (the pid of the current process)
  */
 void Cell::outputDataCsv(const char* prefix, int pid){
+	equations->lock();
 	equations->outputDataCsv(prefix, pid, CellID, currentGen, rkTimeStep);
+	equations->unlock();
 }
 
 /**
@@ -233,7 +362,141 @@ void Cell::outputDataCsv(const char* prefix, int pid){
  * @param pid a relatively unique value for the output directory (the pid of the current process)
  */
 void Cell::outputInteractionCsv(const char* prefix, int pid){
+	equations->lock();
 	equations->outputInteractionCsv(prefix, pid, CellID, currentGen);
+	equations->unlock();
+}
+
+/**
+ * void Cell::outputLgf(const char*, int)
+ *
+ * Output the network of the current cell in LEMON Graph Format, which can be loaded again with loadNetwork
+ *
+ * @param prefix the prefix of the output folder, relative to the execution directory (typically "../output")
+ * @param pid a relatively unique value for the output directory (the pid of the current process)
+ */
+void Cell::outputLgf(const char* prefix, int pid){
+	equations->lock();
+	equations->outputLgf(prefix, pid, CellID, currentGen);
+	equations->unlock();
+}
+
+/**
+ * int Cell::loadNetwork(const char*)
+ *
+ * Replace the network of the cell with one read from a LEMON Graph Format file. The mutation limits, kinetic rate bounds
+ * and runge kutta parameters of the cell are kept. The cell is left unchanged if the file can not be read.
+ *
+ * @param file the LGF file, as written by outputLgf
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int Cell::loadNetwork(const char* file){
+
+	DerivGraph* loaded = new DerivGraph();
+	loaded->copySettings(equations);
+
+	if(!loaded->importLgf(file)){
+		delete loaded;
+		return 0;
+	}
+
+	t.trace("free","Releasing DerivGraph object at %p\n", equations);
+	equations->release();
+	equations = loaded;
+	inherited = 0;
+
+	return 1;
+}
+
+/**
+ * int Cell::loadNetwork(Snapshot&)
+ *
+ * Replace the network of the cell with one written by saveNetwork, for example by a cell on another island.
+ * The cell is left unchanged if the snapshot is truncated.
+ *
+ * @param s the snapshot to read from
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int Cell::loadNetwork(Snapshot& s){
+
+	DerivGraph* loaded = new DerivGraph();
+
+	if(!loaded->load(s)){
+		delete loaded;
+		return 0;
+	}
+
+	replaceNetwork(loaded);
+	return 1;
+}
+
+/**
+ * void Cell::saveNetwork(Snapshot&)
+ *
+ * Serialize the network of the cell, without the state of the cell itself.
+ *
+ * @param s the snapshot to append to
+ */
+void Cell::saveNetwork(Snapshot& s){
+	equations->save(s);
+}
+
+/**
+ * DerivGraph* Cell::shareNetwork()
+ *
+ * Share the network of the cell with another cell during selection. Nothing is copied until one of the cells
+ * changes the network.
+ *
+ * @return the network, with a holder added for the caller, to be passed to replaceNetwork
+ */
+DerivGraph* Cell::shareNetwork(){
+	return equations->share();
+}
+
+/**
+ * void Cell::replaceNetwork(DerivGraph*)
+ *
+ * Replace the network of the cell with one shared by another cell. The CellID, generation counter and random
+ * generator of the cell are kept.
+ *
+ * @param network the new network, whose holder is taken over by the cell
+ */
+void Cell::replaceNetwork(DerivGraph* network){
+
+	t.trace("free","Releasing DerivGraph object at %p\n", equations);
+	equations->release();
+	equations = network;
+	inherited = 1;
+}
+
+/**
+ * void Cell::makeWritable()
+ *
+ * Prepare the network for a change. A network shared with other cells is replaced by a private copy first.
+ *
+ * The first change after an inherited network is received reseeds the random generator of the network from the
+ * generator of the cell, so the children of a cell do not repeat each other's mutations. This is done whether or not
+ * the network had to be copied, so the results do not depend on which cells still share it.
+ */
+void Cell::makeWritable(){
+
+	if(equations->isShared()){
+		equations->lock();
+		DerivGraph* copy = new DerivGraph(*equations);
+		equations->unlock();
+		equations->release();
+		equations = copy;
+	}
+
+	if(inherited){
+		equations->r.seed(r.randInt());
+		inherited = 0;
+	}
+
+	//the Runge-Kutta solution is out of date
+	equations->invalidate();
 }
 
 /**
@@ -245,7 +508,67 @@ void Cell::outputInteractionCsv(const char* prefix, int pid){
  * This method is computationally intensive.
  */
 void Cell::rk(){
-	equations->rungeKuttaEvaluate(rkTimeStep, rkTimeLimit);
+	equations->lock();
+	equations->rungeKuttaEvaluate(rkTimeStep, rkTimeLimit, cycleDetection, integrator, slices, networkThreads, components);
+	equations->unlock();
+}
+
+/**
+ * void Cell::sensitivityAnalysis()
+ *
+ * Rank the rates of the cell by their effect on the oscillation amplitude of its best scoring molecule, so the
+ * following rate mutations favor the rates which matter (see DerivGraph::sensitivityEvaluate).
+ *
+ * This method costs about as many Runge-Kutta evaluations as the network has reactions.
+ */
+void Cell::sensitivityAnalysis(){
+	equations->lock();
+	equations->rungeKuttaEvaluate(rkTimeStep, rkTimeLimit, cycleDetection, integrator, slices, networkThreads, components);
+	equations->sensitivityEvaluate(equations->getBestMolecule(CellID, scoring), rkTimeStep, rkTimeLimit);
+	equations->unlock();
+}
+
+/**
+ * int Cell::hasFeedback()
+ *
+ * Structural screen of the network, much cheaper than solving it (see DerivGraph::hasFeedback).
+ *
+ * @return 1 if the network has a feedback loop through a repression, 0 if it can not oscillate
+ */
+int Cell::hasFeedback(){
+	equations->lock();
+	int feedback = equations->hasFeedback();
+	equations->unlock();
+	return feedback;
+}
+
+/**
+ * int Cell::isStable()
+ *
+ * Linear stability screen of the network, from its steady state instead of its trajectory (see
+ * DerivGraph::isStable).
+ *
+ * @return 1 if the network settles to a stable steady state, 0 if it may oscillate
+ */
+int Cell::isStable(){
+	equations->lock();
+	int stable = equations->isStable();
+	equations->unlock();
+	return stable;
+}
+
+/**
+ * void Cell::setRejected(int)
+ *
+ * Record the result of the screens. A rejected network was not solved, and the counts of its molecules are those of
+ * the network it was mutated from, so its score is 0 until it is screened again.
+ *
+ * @param rejected 1 if a screen found the network can not oscillate, 0 if it was evaluated
+ */
+void Cell::setRejected(int rejected){
+	equations->lock();
+	equations->setRejected(rejected);
+	equations->unlock();
 }
 
 /**
@@ -260,7 +583,10 @@ void Cell::rk(){
  */
 void Cell::stochasticSim(){
 
-	//TODO: some variables from RK that are used for gillespie should get renamed to be more general
-	equations->gillespieEvaluate(rkTimeLimit);
+	//the stochastic simulation changes the molecule counts and draws random numbers, so it needs a private network
+	makeWritable();
+
+	//the counts are recorded on the Runge-Kutta timestep
+	equations->gillespieEvaluate(rkTimeStep, rkTimeLimit);
 
 }
@@ -14,7 +14,8 @@
 class Cell{
 
 public:
-	Cell(int, int, int, int,float,float, float, float, float);
+	Cell(int, int, int, int,float,float, float, float, float, int);
+	Cell(Snapshot&);
 	~Cell();
 	int mutate();
 	
@@ -23,13 +24,42 @@ public:
 	void outputDataPlot(const char*, int);
 	void outputDataCsv(const char*, int);
 	void outputInteractionCsv(const char*, int);
+	void outputLgf(const char*, int);
+
+	// network import
+	int loadNetwork(const char*);
+	int loadNetwork(Snapshot&);
+	void saveNetwork(Snapshot&);
+
+	// reproduction
+	DerivGraph* shareNetwork();
+	void replaceNetwork(DerivGraph*);
 	
 	// runge kutta functions
 	void rk();
 	void stochasticSim();
+	void sensitivityAnalysis();
+	int hasFeedback();
+	int isStable();
+	void setRejected(int);
 	int getScore();
+	void setScoring(int m){ scoring = m; };
+	void setCycleDetection(int c){ cycleDetection = c; };
+	void setIntegrator(int m){ integrator = m; };
+	void setParareal(ThreadPool* p){ slices = p; };
+	void setNetworkThreads(int n){ networkThreads = n; };
+	void setComponentCache(ComponentCache* c){ components = c; };
+
+	// network size
+	int getNodeCount();
+	int getArcCount();
 	
 	int getID(){ return CellID; };
+
+	// checkpointing
+	void save(Snapshot&);
+	static int getCellCounter(){ return CellCounter; };
+	static void setCellCounter(int c){ CellCounter = c; };
 private:
 	
 	// cell properties
@@ -40,12 +70,34 @@ private:
 	// random generator
 	MTRand r;
 
-	// molecules/interactions class
+	// molecules/interactions class, possibly shared with other cells
 	DerivGraph * equations;
 
+	// set when the network was received from another cell and has not been changed since
+	int inherited;
+	void makeWritable();
+
 	// runge kutta values
 	float rkTimeStep;
 	float rkTimeLimit;
+
+	// ScoreMethod of getScore
+	int scoring;
+
+	// consistent periods which stop rk() early, 0 to always integrate to rkTimeLimit
+	int cycleDetection;
+
+	// IntegratorMethod of rk()
+	int integrator;
+
+	// threads rk() integrates time slices of the run on (see Parareal), 0 to integrate serially
+	ThreadPool* slices;
+
+	// threads rk() may share the evaluation of the rate laws of a large network among (see KineticsTeam)
+	int networkThreads;
+
+	// solutions of parts of networks rk() takes instead of integrating them (see ComponentCache), 0 to integrate them all
+	ComponentCache* components;
 };
 
 #endif
@@ -0,0 +1,249 @@
+/**
+ * Checkpoint.cpp
+ *
+ * Snapshot buffers and the asynchronous checkpoint writer.
+ *
+ * The writer is double buffered. The generational loop serializes into one Snapshot while the other one is written
+ * to disk by a background thread. A new checkpoint only waits if the previous one is still being written.
+ * Files are written to a temporary name and renamed, so a crash during a write never destroys the last good checkpoint.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "Checkpoint.h"
+
+#include "ExternTrace.h"
+
+/**
+ * Snapshot::Snapshot()
+ *
+ * Create an empty snapshot.
+ */
+Snapshot::Snapshot(){
+	readPos = 0;
+	readFailed = 0;
+}
+
+/**
+ * void Snapshot::put(const void*, size_t)
+ *
+ * Append raw bytes to the snapshot.
+ *
+ * @param src the bytes to append
+ * @param len the number of bytes
+ */
+void Snapshot::put(const void* src, size_t len){
+
+	const char* c = (const char*) src;
+	data.insert(data.end(), c, c + len);
+}
+
+/**
+ * void Snapshot::get(void*, size_t)
+ *
+ * Read raw bytes from the snapshot. Reading past the end zero-fills the destination and marks the snapshot as failed.
+ *
+ * @param dest where to copy the bytes
+ * @param len the number of bytes
+ */
+void Snapshot::get(void* dest, size_t len){
+
+	if(readFailed || readPos + len > data.size()){
+		readFailed = 1;
+		memset(dest, 0, len);
+		return;
+	}
+	memcpy(dest, &data[readPos], len);
+	readPos += len;
+}
+
+/**
+ * void Snapshot::putRandom(const MTRand&)
+ *
+ * Append the state of a random generator. MTRand stores its state in unsigned longs, but every word only holds
+ * 32 bits, so the state is packed to halve its size on 64 bit machines.
+ *
+ * @param mt the generator to save
+ */
+void Snapshot::putRandom(const MTRand& mt){
+
+	MTRand::uint32 state[MTRand::SAVE];
+	unsigned int packed[MTRand::SAVE];
+
+	mt.save(state);
+	for(int i = 0; i < MTRand::SAVE; i++)
+		packed[i] = (unsigned int) state[i];
+	put(packed, sizeof(packed));
+}
+
+/**
+ * void Snapshot::getRandom(MTRand&)
+ *
+ * Restore the state of a random generator written by putRandom. The generator is left untouched if the
+ * snapshot is truncated.
+ *
+ * @param mt the generator to restore
+ */
+void Snapshot::getRandom(MTRand& mt){
+
+	MTRand::uint32 state[MTRand::SAVE];
+	unsigned int packed[MTRand::SAVE];
+
+	get(packed, sizeof(packed));
+	if(readFailed)
+		return;
+
+	for(int i = 0; i < MTRand::SAVE; i++)
+		state[i] = packed[i];
+	mt.load(state);
+}
+
+/**
+ * void Snapshot::clear()
+ *
+ * Empty the snapshot. The capacity of the buffer is kept, so refilling it does not reallocate.
+ */
+void Snapshot::clear(){
+	data.clear();
+	readPos = 0;
+	readFailed = 0;
+}
+
+/**
+ * int Snapshot::writeFile(const char*)
+ *
+ * @param path the file to write the snapshot to
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int Snapshot::writeFile(const char* path){
+
+	FILE* f = fopen(path, "wb");
+	if(!f)
+		return 0;
+
+	size_t written = data.empty() ? 0 : fwrite(&data[0], 1, data.size(), f);
+
+	if(fclose(f) != 0 || written != data.size())
+		return 0;
+	return 1;
+}
+
+/**
+ * int Snapshot::readFile(const char*)
+ *
+ * Replace the contents of the snapshot with a file, and rewind it for reading.
+ *
+ * @param path the file to read
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int Snapshot::readFile(const char* path){
+
+	clear();
+
+	FILE* f = fopen(path, "rb");
+	if(!f)
+		return 0;
+
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if(len > 0){
+		data.resize(len);
+		if(fread(&data[0], 1, len, f) != (size_t)len){
+			fclose(f);
+			clear();
+			return 0;
+		}
+	}
+	fclose(f);
+	return 1;
+}
+
+/**
+ * Checkpoint::Checkpoint(const char*)
+ *
+ * @param file the checkpoint file, replaced each time a checkpoint is written
+ */
+Checkpoint::Checkpoint(const char* file){
+
+	snprintf(path, sizeof(path), "%s", file);
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", file);
+	current = 0;
+	writing = 0;
+}
+
+/**
+ * Checkpoint::~Checkpoint()
+ *
+ * Waits for an outstanding write to finish.
+ */
+Checkpoint::~Checkpoint(){
+	wait();
+}
+
+/**
+ * Snapshot* Checkpoint::getBuffer()
+ *
+ * @return an empty snapshot to serialize the next checkpoint into
+ */
+Snapshot* Checkpoint::getBuffer(){
+
+	buffers[current].clear();
+	return &buffers[current];
+}
+
+/**
+ * void Checkpoint::write()
+ *
+ * Hand the snapshot returned by getBuffer() to the background writer.
+ */
+void Checkpoint::write(){
+
+	//only one write can be in flight, the other buffer is about to be reused
+	wait();
+
+	writeIndex = current;
+	writing = 1;
+	if(pthread_create(&writer, 0, writerThread, this) != 0){
+		//no thread available, write synchronously instead
+		writing = 0;
+		writerThread(this);
+	}
+	current = 1 - current;
+}
+
+/**
+ * void Checkpoint::wait()
+ *
+ * Block until the background writer (if any) has finished.
+ */
+void Checkpoint::wait(){
+
+	if(writing){
+		pthread_join(writer, 0);
+		writing = 0;
+	}
+}
+
+/**
+ * void* Checkpoint::writerThread(void*)
+ *
+ * Body of the background writer. Writes the buffer filled before write() to the temporary file and renames it
+ * over the checkpoint.
+ *
+ * @param arg the Checkpoint
+ */
+void* Checkpoint::writerThread(void* arg){
+
+	Checkpoint* c = (Checkpoint*) arg;
+	Snapshot* s = &c->buffers[c->writeIndex];
+
+	if(!s->writeFile(c->tmpPath) || rename(c->tmpPath, c->path) != 0)
+		t.trace("error","Could not write checkpoint %s\n", c->path);
+
+	return 0;
+}
@@ -0,0 +1,83 @@
+/**
+ * Checkpoint.h
+ *
+ * Binary snapshots of a running Experiment.
+ *
+ * A Snapshot is an in-memory byte buffer which the Experiment, Cell and DerivGraph classes serialize themselves into.
+ * A Checkpoint writes finished snapshots to disk on a background thread, so the generational loop only pays for
+ * the in-memory serialization.
+ *
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <pthread.h>
+#include "MersenneTwister.h"
+
+using namespace std;
+
+// identifies a snapshot file, and the version of its layout
+#define SNAPSHOT_MAGIC 0x45564f31
+#define SNAPSHOT_VERSION 6
+
+class Snapshot{
+
+public:
+	Snapshot();
+
+	// raw (native byte order) values
+	void put(const void*, size_t);
+	void get(void*, size_t);
+
+	void putInt(int v){ put(&v, sizeof(v)); };
+	void putFloat(float v){ put(&v, sizeof(v)); };
+	int getInt(){ int v = 0; get(&v, sizeof(v)); return v; };
+	float getFloat(){ float v = 0; get(&v, sizeof(v)); return v; };
+
+	// random generator state, packed to 32 bits per word
+	void putRandom(const MTRand&);
+	void getRandom(MTRand&);
+
+	void clear();
+	int failed(){ return readFailed; };
+
+	int writeFile(const char*);
+	int readFile(const char*);
+
+	vector<char> data;
+
+private:
+	size_t readPos;
+	int readFailed;
+};
+
+class Checkpoint{
+
+public:
+	Checkpoint(const char*);
+	~Checkpoint();
+
+	Snapshot* getBuffer();
+	void write();
+	void wait();
+
+private:
+	static void* writerThread(void*);
+
+	char path[300];
+	char tmpPath[310];
+
+	// the snapshot being filled by the generational loop, and the one being written to disk
+	Snapshot buffers[2];
+	int current;
+	int writeIndex;
+
+	pthread_t writer;
+	int writing;
+};
+
+#endif
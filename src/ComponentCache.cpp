@@ -0,0 +1,97 @@
+/**
+ * ComponentCache.cpp
+ *
+ * A map from the key of a part of a network to its solution, flushed when it grows too large.
+ */
+
+#include "ComponentCache.h"
+
+#include "ExternTrace.h"
+
+/**
+ * ComponentCache::ComponentCache(int)
+ *
+ * @param megabytes the memory the solutions may take
+ */
+ComponentCache::ComponentCache(int megabytes){
+
+	size = 0;
+	capacity = (size_t)(megabytes < 0 ? 0 : megabytes) << 20;
+	hits = 0;
+	misses = 0;
+	flushes = 0;
+	pthread_mutex_init(&mutex, 0);
+}
+
+ComponentCache::~ComponentCache(){
+	pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * int ComponentCache::find(const string&, vector<float>&)
+ *
+ * @param key the content of the part of the network
+ * @param points filled with its solution, as it was stored
+ *
+ * @return 1 if the solution was found, 0 otherwise
+ */
+int ComponentCache::find(const string& key, vector<float>& points){
+
+	pthread_mutex_lock(&mutex);
+
+	map<string, vector<float> >::iterator it = entries.find(key);
+	int found = it != entries.end();
+	if(found){
+		points = it->second;
+		hits++;
+	}
+	else
+		misses++;
+
+	pthread_mutex_unlock(&mutex);
+	return found;
+}
+
+/**
+ * void ComponentCache::store(const string&, const vector<float>&)
+ *
+ * Keep the solution of a part of a network. If it does not fit, the solutions kept so far are dropped first.
+ *
+ * @param key the content of the part of the network
+ * @param points its solution
+ */
+void ComponentCache::store(const string& key, const vector<float>& points){
+
+	size_t bytes = key.size() + points.size() * sizeof(float);
+	if(bytes > capacity)
+		return;
+
+	pthread_mutex_lock(&mutex);
+
+	if(entries.find(key) == entries.end()){
+		if(size + bytes > capacity){
+			entries.clear();
+			size = 0;
+			flushes++;
+			t.trace("components","Component cache flushed after %ld hits and %ld misses\n", hits, misses);
+		}
+		entries[key] = points;
+		size += bytes;
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * void ComponentCache::report(FILE*)
+ *
+ * Write how many parts of networks were found, and how many had to be integrated.
+ *
+ * @param out the stream to write to
+ */
+void ComponentCache::report(FILE* out){
+
+	long lookups = hits + misses;
+	fprintf(out, "Component cache (%d MB)\n", (int)(capacity >> 20));
+	fprintf(out, "  %8ld found  %8ld integrated  %6.1f%% found  %d flushes, %d solutions held\n", hits, misses, lookups > 0 ? 100.0 * hits / lookups : 0.0, flushes, (int)entries.size());
+}
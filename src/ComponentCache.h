@@ -0,0 +1,60 @@
+/**
+ * ComponentCache.h
+ *
+ * Runge-Kutta solutions of parts of networks, looked up by their content.
+ *
+ * Mutations often leave a network in several parts no reaction links: basic modules not yet joined by a complex or
+ * a promoter. Each such part, a weakly connected component of the network without the null node, changes as it would
+ * on its own, so DerivGraph::rungeKuttaEvaluate integrates only the parts it finds no solution for here, and stores
+ * theirs. A mutation changes one part, and the others are found, as are the parts cells share with other cells.
+ *
+ * The key of a part holds everything its solution depends on: the timestep and length of the run, the kind, initial
+ * concentration and scale of its molecules, and its reactions (see Kinetics::getSignature). A found solution is
+ * therefore the one integration would give, to the last bit.
+ *
+ * The solutions are kept until they take more than the given memory, and then all dropped at once: the population
+ * moves on, and the parts of the last generations are the ones found again. The cache is shared by the threads
+ * processing the cells.
+ *
+ */
+
+#ifndef COMPONENTCACHE_H_
+#define COMPONENTCACHE_H_
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+class ComponentCache{
+
+public:
+	ComponentCache(int);
+	~ComponentCache();
+
+	int find(const string&, vector<float>&);
+	void store(const string&, const vector<float>&);
+
+	void report(FILE*);
+
+private:
+	// tests/CachedComponents.cpp counts the parts found and stored
+	friend class CachedComponents;
+
+	map<string, vector<float> > entries;
+
+	// bytes held by the entries, and the most they may hold
+	size_t size;
+	size_t capacity;
+
+	long hits;
+	long misses;
+	int flushes;
+
+	pthread_mutex_t mutex;
+};
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ * Conservation.cpp
+ *
+ * The left null space of the stoichiometry matrix, by sparse elimination of the molecules of single entry columns
+ * and the reduced row echelon form of the rest.
+ */
+
+#include <cmath>
+
+#include "Conservation.h"
+
+#include "ExternTrace.h"
+
+// largest coefficient, relative to the largest of the matrix, taken for 0 in the row echelon form
+#define CONSERVATION_TOLERANCE 1e-9
+
+/**
+ * void Conservation::analyze(Kinetics&, const vector<float>&, const vector<int>*)
+ *
+ * Find the conservation laws of the compiled reactions, and their totals at the initial concentrations.
+ *
+ * @param k the compiled reactions of the network
+ * @param initial the concentration of every node at the start, by node id
+ * @param selected by node id, nonzero for the nodes the reactions were compiled for, or null for all of them
+ */
+void Conservation::analyze(Kinetics& k, const vector<float>& initial, const vector<int>* selected){
+
+	int nodes = k.getNodeCount();
+	int reactions = k.getReactionCount();
+
+	laws.clear();
+	dependent.assign(nodes, 0);
+
+	//the molecules which may still have a weight in some law. Those of empty rows are laws on their own
+	vector<int> candidate(nodes, 0);
+	for(int n = 0; n < nodes; n++){
+		if(selected && !(*selected)[n])
+			continue;
+		if(k.getRowStart(n + 1) > k.getRowStart(n))
+			candidate[n] = 1;
+		else{
+			Law law;
+			law.node = n;
+			law.total = initial[n];
+			laws.push_back(law);
+			dependent[n] = 1;
+		}
+	}
+
+	//a column with one candidate entry forces its weight to 0, which may leave other columns with one
+	for(int changed = 1; changed;){
+		changed = 0;
+		for(int r = 0; r < reactions; r++){
+			int count = 0, last = -1;
+			for(int e = k.getColumnStart(r); e < k.getColumnStart(r + 1); e++)
+				if(candidate[k.getEntryNode(e)] && k.getEntryCoeff(e) != 0 && k.getEntryNode(e) != last){
+					last = k.getEntryNode(e);
+					count++;
+				}
+			if(count == 1){
+				candidate[last] = 0;
+				changed = 1;
+			}
+		}
+	}
+
+	vector<int> species;
+	vector<int> column(nodes, -1);
+	for(int n = 0; n < nodes; n++)
+		if(candidate[n]){
+			column[n] = species.size();
+			species.push_back(n);
+		}
+	int m = species.size();
+	if(m == 0)
+		return;
+
+	//the transpose of the stoichiometry matrix restricted to the candidates, reaction by reaction
+	vector<double> a;
+	double largest = 0;
+	for(int r = 0; r < reactions; r++){
+		vector<double> row(m, 0);
+		int used = 0;
+		for(int e = k.getColumnStart(r); e < k.getColumnStart(r + 1); e++)
+			if(column[k.getEntryNode(e)] >= 0){
+				row[column[k.getEntryNode(e)]] += k.getEntryCoeff(e);
+				used = 1;
+			}
+		if(!used)
+			continue;
+		for(int j = 0; j < m; j++)
+			if(fabs(row[j]) > largest)
+				largest = fabs(row[j]);
+		a.insert(a.end(), row.begin(), row.end());
+	}
+	int rows = a.size() / m;
+	double tolerance = CONSERVATION_TOLERANCE * largest;
+
+	//reduced row echelon form with partial pivoting. The molecules without a pivot are the free ones
+	vector<int> pivotColumn;
+	int rank = 0;
+	for(int j = 0; j < m && rank < rows; j++){
+
+		int best = rank;
+		for(int i = rank + 1; i < rows; i++)
+			if(fabs(a[i * m + j]) > fabs(a[best * m + j]))
+				best = i;
+		if(fabs(a[best * m + j]) <= tolerance)
+			continue;
+
+		for(int l = 0; l < m; l++){
+			double swap = a[rank * m + l];
+			a[rank * m + l] = a[best * m + l];
+			a[best * m + l] = swap;
+		}
+
+		double p = a[rank * m + j];
+		for(int l = 0; l < m; l++)
+			a[rank * m + l] /= p;
+
+		for(int i = 0; i < rows; i++){
+			if(i == rank || a[i * m + j] == 0)
+				continue;
+			double f = a[i * m + j];
+			for(int l = 0; l < m; l++)
+				a[i * m + l] -= f * a[rank * m + l];
+		}
+
+		pivotColumn.push_back(j);
+		rank++;
+	}
+
+	vector<int> pivot(m, 0);
+	for(int i = 0; i < rank; i++)
+		pivot[pivotColumn[i]] = 1;
+
+	//each free molecule f gives the null vector with weight 1 on f and -a[i][f] on the pivot molecule of row i
+	for(int f = 0; f < m; f++){
+		if(pivot[f])
+			continue;
+
+		Law law;
+		law.node = species[f];
+		law.total = initial[species[f]];
+		for(int i = 0; i < rank; i++){
+			double w = -a[i * m + f];
+			if(fabs(w) <= tolerance)
+				continue;
+			law.terms.push_back(species[pivotColumn[i]]);
+			law.weights.push_back(w);
+			law.total += w * initial[species[pivotColumn[i]]];
+		}
+		laws.push_back(law);
+		dependent[species[f]] = 1;
+	}
+
+	t.trace("conservation","%d conservation laws, %d of them constant, among %d nodes\n", getLawCount(), getConstantCount(), nodes);
+}
+
+/**
+ * int Conservation::getConstantCount()
+ *
+ * @return the number of laws of a single molecule, which no reaction changes
+ */
+int Conservation::getConstantCount(){
+
+	int count = 0;
+	for(unsigned int l = 0; l < laws.size(); l++)
+		if(laws[l].terms.empty())
+			count++;
+	return count;
+}
+
+/**
+ * float Conservation::reconstruct(int, const float*)
+ *
+ * @param l the law
+ * @param c the concentration of every node, by node id, of which only the terms of the law are read
+ *
+ * @return the concentration of the dependent molecule of the law, never negative
+ */
+float Conservation::reconstruct(int l, const float* c){
+
+	const Law& law = laws[l];
+
+	double value = law.total;
+	for(unsigned int j = 0; j < law.terms.size(); j++)
+		value -= law.weights[j] * c[law.terms[j]];
+	return value < 0 ? 0 : (float)value;
+}
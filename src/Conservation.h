@@ -0,0 +1,63 @@
+/**
+ * Conservation.h
+ *
+ * Conservation laws (moieties) of a network, which take molecules out of the integrated state.
+ *
+ * A weighting w of the molecules with w N = 0, N the stoichiometry matrix of Kinetics, is a left null vector of N: no
+ * reaction changes the weighted sum of the concentrations, so it keeps its initial value, the total of the law. The
+ * simplest laws are the molecules no reaction changes (DNA without a promoter, the null node), whose rows of N are
+ * empty. Others conserve a moiety, as the total of a promoter, free or bound, would be without the transcription and
+ * degradation which use it up.
+ *
+ * The laws are found when the network is compiled. A column with a single entry forces the weight of its molecule to
+ * 0, so those molecules are dropped until no such column is left, which in practice leaves only the constant molecules
+ * since every protein, mRNA, modified protein and complex is degraded. The left null space of what remains is the
+ * reduced row echelon form of N restricted to it, and each free molecule of that form becomes dependent: its
+ * concentration is the total of its law less the weighted sum of the pivot molecules, none of them dependent.
+ *
+ * The dependent molecules are not integrated, and their concentration is set from the integrated ones at every
+ * Runge-Kutta stage and after every timestep (see DerivGraph::rungeKuttaEvaluate).
+ *
+ */
+
+#ifndef CONSERVATION_H_
+#define CONSERVATION_H_
+
+#include <vector>
+
+#include "Kinetics.h"
+
+using namespace std;
+
+class Conservation{
+
+public:
+	void analyze(Kinetics&, const vector<float>&, const vector<int>* = 0);
+
+	int getLawCount(){ return laws.size(); };
+
+	// the dependent molecule of law l, and whether node n is one
+	int getNode(int l){ return laws[l].node; };
+	int isDependent(int n){ return dependent[n]; };
+
+	// the laws without terms, whose molecule never changes
+	int getConstantCount();
+
+	float reconstruct(int, const float*);
+
+private:
+	struct Law{
+		// the dependent molecule and the initial weighted sum
+		int node;
+		double total;
+
+		// the other molecules of the law, none of them dependent, and their weights relative to the dependent one
+		vector<int> terms;
+		vector<double> weights;
+	};
+
+	vector<Law> laws;
+	vector<int> dependent;
+};
+
+#endif
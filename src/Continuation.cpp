@@ -0,0 +1,250 @@
+/**
+ * Continuation.cpp
+ *
+ * Predictor-corrector continuation of steady states over the hill coefficient, and location of Hopf points.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "Continuation.h"
+
+#include "ExternTrace.h"
+
+// steps of the hill coefficient smaller than this are not tried, the branch is lost
+#define CONTINUATION_MIN_STEP 1e-4
+
+// bisections locating a Hopf point between two steps
+#define CONTINUATION_BISECTIONS 30
+
+// real parts of complex eigenvalues closer to 0 than this are rounding, they tell neither side of a Hopf point
+#define CONTINUATION_DEAD_BAND 1e-5
+
+/**
+ * Continuation::Continuation(FILE*, const char*)
+ *
+ * @param output the stream the bifurcation table is written to
+ * @param name the name of the network in the table
+ */
+Continuation::Continuation(FILE* output, const char* name){
+
+	out = output;
+	label = name;
+	kinetics = 0;
+	hopfPoints = 0;
+}
+
+/**
+ * static void Continuation::writeHeader(FILE*)
+ *
+ * @param output the stream the bifurcation table is written to
+ */
+void Continuation::writeHeader(FILE* output){
+
+	fprintf(output, "network\thill\tpoint\tabscissa\tperiod\n");
+}
+
+/**
+ * int Continuation::run(Kinetics&, const vector<float>&, const vector<float>&, float, float, float)
+ *
+ * Follow the steady state of a network from one hill coefficient to another, writing a row of the table every step.
+ * The first steady state is the one reached from the initial concentrations.
+ *
+ * @param k the compiled reactions of the network. Its hill coefficients are changed
+ * @param initial the initial concentration of every node, by node id
+ * @param nodeScale the factor each concentration is multiplied by before the rate laws see it (see SteadyState)
+ * @param from the first hill coefficient, at least 1
+ * @param to the last hill coefficient, at least 1
+ * @param step the spacing of the rows of the table
+ *
+ * @return 1 if the steady state was followed the whole way, 0 otherwise
+ */
+int Continuation::run(Kinetics& k, const vector<float>& initial, const vector<float>& nodeScale, float from, float to, float step){
+
+	kinetics = &k;
+	scale = nodeScale;
+	hopfPoints = 0;
+
+	if(step <= 0)
+		return 0;
+	if(to < from)
+		step = -step;
+
+	kinetics->setHill(from);
+	if(!steady.solve(*kinetics, initial, scale)){
+		write(from, "none");
+		return 0;
+	}
+	write(from, kind());
+
+	//the last two points of the branch
+	vector<float> z = steady.getState(), previous = z;
+	float h = from, hPrevious = from;
+
+	//the last point whose complex eigenvalues tell which side of a Hopf point it is on
+	vector<float> zTest = z;
+	float hTest = from;
+	double test = steady.getOscillatoryAbscissa(0);
+	int resolved = !isinf(test) && fabs(test) > CONTINUATION_DEAD_BAND;
+
+	int points = (int)floor((to - from) / step + 1e-4);
+	vector<float> guess(z.size());
+
+	for(int p = 1; p <= points; p++){
+
+		float target = from + p * step;
+		float sub = target - h;
+
+		while(h != target){
+
+			float next = h + sub;
+			if((step > 0 && next > target) || (step < 0 && next < target))
+				next = target;
+
+			//secant predictor
+			float slope = h != hPrevious ? (next - h) / (h - hPrevious) : 0;
+			for(unsigned int n = 0; n < z.size(); n++){
+				guess[n] = z[n] + slope * (z[n] - previous[n]);
+				if(guess[n] < 0)
+					guess[n] = 0;
+			}
+
+			if(!correct(next, guess)){
+				sub /= 2;
+				if(fabs(sub) < CONTINUATION_MIN_STEP){
+					write(h, "lost");
+					return 0;
+				}
+				continue;
+			}
+
+			vector<float> reached = steady.getState();
+			double reachedTest = steady.getOscillatoryAbscissa(0);
+
+			if(!isinf(reachedTest) && fabs(reachedTest) > CONTINUATION_DEAD_BAND){
+				if(resolved && (test < 0) != (reachedTest < 0))
+					locateHopf(hTest, zTest, test, next, reached);
+				zTest = reached;
+				hTest = next;
+				test = reachedTest;
+				resolved = 1;
+			}
+
+			previous = z;
+			hPrevious = h;
+			z = reached;
+			h = next;
+
+			//try longer steps again once the corrector copes
+			sub *= 2;
+		}
+
+		//the bisection may have left the solver at another point
+		correct(h, z);
+		write(h, kind());
+	}
+
+	return 1;
+}
+
+/**
+ * int Continuation::correct(float, const vector<float>&)
+ *
+ * @param hill the hill coefficient
+ * @param guess the predicted steady state
+ *
+ * @return 1 if the corrector found the steady state, 0 otherwise
+ */
+int Continuation::correct(float hill, const vector<float>& guess){
+
+	kinetics->setHill(hill);
+	return steady.solve(*kinetics, guess, scale, 1);
+}
+
+/**
+ * void Continuation::locateHopf(float, const vector<float>&, double, float, const vector<float>&)
+ *
+ * Bisect the hill coefficient between two points of the branch on either side of a Hopf bifurcation, and write the
+ * row of the Hopf point.
+ *
+ * @param low the hill coefficient of the first point
+ * @param zLow its steady state
+ * @param testLow the largest real part of its complex eigenvalues
+ * @param high the hill coefficient of the second point
+ * @param zHigh its steady state
+ */
+void Continuation::locateHopf(float low, const vector<float>& zLow, double testLow, float high, const vector<float>& zHigh){
+
+	float a = low, b = high;
+	vector<float> za = zLow, zb = zHigh, guess(zLow.size());
+
+	for(int i = 0; i < CONTINUATION_BISECTIONS; i++){
+
+		float mid = (a + b) / 2;
+		if(mid == a || mid == b)
+			break;
+
+		for(unsigned int n = 0; n < guess.size(); n++)
+			guess[n] = (za[n] + zb[n]) / 2;
+
+		if(!correct(mid, guess))
+			break;
+
+		double test = steady.getOscillatoryAbscissa(0);
+		if(isinf(test))
+			break;
+
+		if((test < 0) == (testLow < 0)){
+			a = mid;
+			za = steady.getState();
+		}
+		else{
+			b = mid;
+			zb = steady.getState();
+		}
+	}
+
+	correct((a + b) / 2, za);
+	hopfPoints++;
+	write((a + b) / 2, "hopf");
+
+	t.trace("hopf","%s Hopf point at hill %f\n", label, (a + b) / 2);
+}
+
+/**
+ * const char* Continuation::kind()
+ *
+ * @return the kind of the steady state the solver found last: stable, unstable, or neutral if its largest real part
+ * is 0 up to rounding
+ */
+const char* Continuation::kind(){
+
+	if(steady.isStable())
+		return "stable";
+	if(fabs(steady.getAbscissa()) <= CONTINUATION_DEAD_BAND)
+		return "neutral";
+	return "unstable";
+}
+
+/**
+ * void Continuation::write(float, const char*)
+ *
+ * Write a row of the table, for the steady state the solver found last.
+ *
+ * @param hill the hill coefficient
+ * @param point the kind of point
+ */
+void Continuation::write(float hill, const char* point){
+
+	double omega = 0;
+	double abscissa = 0;
+	double period = 0;
+
+	if(strcmp(point, "none") != 0 && strcmp(point, "lost") != 0){
+		abscissa = steady.getAbscissa();
+		if(!isinf(steady.getOscillatoryAbscissa(&omega)))
+			period = 2 * M_PI / omega;
+	}
+
+	fprintf(out, "%s\t%g\t%s\t%g\t%g\n", label, hill, point, abscissa, period);
+}
@@ -0,0 +1,59 @@
+/**
+ * Continuation.h
+ *
+ * Numerical continuation of the steady state of a network over the hill coefficient of its repressions.
+ *
+ * Instead of evolving a population again for every hill coefficient, the steady state of a given network is followed
+ * as the coefficient changes: every step predicts the new steady state from the last two (secant predictor) and
+ * corrects the prediction by Newton iterations (see SteadyState). A step the corrector fails on is halved. Where the
+ * largest real part of the complex eigenvalues changes sign, the steady state starts or stops oscillating (a Hopf
+ * bifurcation), and the crossing is located by bisection. Real parts within rounding of 0, as those of the stiff pairs
+ * of nearly repressed genes at high hill coefficients, are not taken for a crossing.
+ *
+ * The result is a bifurcation table, one row for every point of the hill grid and for every Hopf point:
+ *   network   hill   point   abscissa   period
+ * where point is stable, unstable, neutral (an eigenvalue is 0 up to rounding), hopf, lost (the corrector failed
+ * even on tiny steps, as at a fold) or none (no steady state was found at the start), abscissa is the largest real
+ * part of the eigenvalues, and period the period of the leading complex pair (0 if all eigenvalues are real).
+ *
+ */
+
+#ifndef CONTINUATION_H_
+#define CONTINUATION_H_
+
+#include <cstdio>
+#include <vector>
+
+#include "Kinetics.h"
+#include "SteadyState.h"
+
+using namespace std;
+
+class Continuation{
+
+public:
+	Continuation(FILE*, const char*);
+
+	int run(Kinetics&, const vector<float>&, const vector<float>&, float, float, float);
+
+	int getHopfCount(){ return hopfPoints; };
+
+	static void writeHeader(FILE*);
+
+private:
+	int correct(float, const vector<float>&);
+	void locateHopf(float, const vector<float>&, double, float, const vector<float>&);
+	const char* kind();
+	void write(float, const char*);
+
+	FILE* out;
+	const char* label;
+
+	Kinetics* kinetics;
+	vector<float> scale;
+	SteadyState steady;
+
+	int hopfPoints;
+};
+
+#endif
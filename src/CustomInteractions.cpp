@@ -1,11 +1,13 @@
 /**
  * Implementation file for Custom Interactions.
  *
- * Interactions may overload the virtual method getEffect() to create a custom effect between Molecules
+ * The rate law of each kind of Interaction is in Kinetics.cpp
  *
  */
 
 #include "CustomInteractions.h"
+#include "Checkpoint.h"
+#include "Arena.h"
 
 #include "ExternTrace.h"
 
@@ -20,71 +22,11 @@
  */
 Transcription::Transcription(){
 	name="txn";
+	kind = IK_TRANSCRIPTION;
 }
 
 Transcription::~Transcription(){}
-
-/**
- * float Transcription::getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float)
- * 
- * Overload of virtual method Interaction::getEffect
- *
- * Transcription has a DNA source and an mRNA target. DNA is not removed as mRNA is created. The amount of mRNA created may be repressed
- *  by a protein which is "bound" to the DNA.
- *
- * @param g Reference to the Digraph object. Can be used to make complex effects based on local configuration around the current node
- * @param m Reference to the NodeMap object. Can be used to get the Molecule objects from the graph contaniers.
- * @param i Reference to the ArcMap object. Can be used to get the Interaction objects from the graph containers.
- * @param n The Node being affected by the interaction. Note that this can be the source or target.
- * @param rkIter The current iteration of Runge-Kutta evaluation.
- * @param rkStep The stepsize of the Runge-Kutta evaluation.
- *
- * @return The effect (change) of this interaction has on the concentration of node n at the current iteration of runge-kutta
- */
-float Transcription::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m, ListDigraph::ArcMap<Interaction*>* i, ListDigraph::Node n, int rkIter, float rkStep){	
-
-
-	t.trace("efct","Original Node value: %f\n", (*m)[n]->getValue());
-	t.trace("efct","Interaction Rate: %f\n", rate);
-	t.trace("efct","Interaction Dir: %s\n", (g->source(g->arcFromId(arcID)) == n) ? "outgoing" : "incoming");
-	t.trace("efct","Opposite Node value: %f\n", (*m)[g->oppositeNode(n, g->arcFromId(arcID))]->getValue());
-
-	Molecule* thisMol = (*m)[n];
-	Molecule* oppositeMol = (*m)[g->oppositeNode(n, g->arcFromId(arcID))];
-	
-	
-	
-	if(isSourceNode(g, n) == 1){
-		
-		int prom_id = ((DNA*)thisMol)->promoterId;
-		if(prom_id == -1)
-			return 0;
-
-		PromoterBind* pb = (PromoterBind*)(*i)[g->arcFromId(prom_id)];
-		Molecule* repressor = (*m)[g->source(g->arcFromId(prom_id))];
-		float f = pb->kf;
-		return -1 * f * oppositeMol->rkApprox(rkIter, rkStep) * repressor->rkApprox(rkIter, rkStep);
-	}
-	else if(isTargetNode(g, n) == 1)
-	{
-		return oppositeMol->rkApprox(rkIter, rkStep) * rate;
-	/*	
-		PromoterBind* pb = (PromoterBind*)(*i)[g->arcFromId(prom_id)];
-		Molecule* repressor = (*m)[g->source(g->arcFromId(prom_id))];
-
-		float f = pb->kf;
-		float r = pb->kr;
-		int h = ((DNA*)oppositeMol)->hill;
-		t.trace("hill","f:%f r:%f h:%d value:%f\n",f,r,h,(1/(1+pow(f/r,h))));
-		return (1/(1+(f/r)*pow(repressor->rkApprox(rkIter,rkStep),h))) * oppositeMol->rkApprox(rkIter, rkStep) * rate;
-	*/
-	}
-	else{
-		t.trace("error", "%s getEffect reached error case, not source or target (%p)\n", name, this);
-		return 0;
-	}	
-	
-}
+Interaction* Transcription::clone(Arena& a){ return new (a) Transcription(*this); }
 
 /**
  * Degradation::Degradation() 
@@ -97,42 +39,10 @@ float Transcription::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>*
  */
 Degradation::Degradation(){
 	name="deg";
+	kind = IK_DEGRADATION;
 }
 Degradation::~Degradation(){}
-
-/**
- * float Degradation::getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float)
- * 
- * Overload of virtual method Interaction::getEffect
- *
- * @param g Reference to the Digraph object. Can be used to make complex effects based on local configuration around the current node
- * @param m Reference to the NodeMap object. Can be used to get the Molecule objects from the graph contaniers.
- * @param i Reference to the ArcMap object. Can be used to get the Interaction objects from the graph containers.
- * @param n The Node being affected by the interaction. Note that this can be the source or target.
- * @param rkIter The current iteration of Runge-Kutta evaluation.
- * @param rkStep The stepsize of the Runge-Kutta evaluation.
- *
- * @return The effect (change) of this interaction has on the concentration of node n at the current iteration of runge-kutta
- */
-float Degradation::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m, ListDigraph::ArcMap<Interaction*>* i, ListDigraph::Node n, int rkIter, float rkStep){	
-	
-	t.trace("efct","Original Node value: %f\n", (*m)[n]->getValue());
-	t.trace("efct","Interaction Rate: %f\n", rate);
-	t.trace("efct","Interaction Dir: %s\n", (g->source(g->arcFromId(arcID)) == n) ? "outgoing" : "incoming");
-	t.trace("efct","Opposite Node value: %f\n", (*m)[g->oppositeNode(n, g->arcFromId(arcID))]->getValue());
-
-	Molecule* thisMol = (*m)[n];
-	Molecule* oppositeMol = (*m)[g->oppositeNode(n, g->arcFromId(arcID))];
-
-	if(isSourceNode(g, n) == 1)	
-		return -1 * thisMol->rkApprox(rkIter, rkStep) * rate;
-	else if(isTargetNode(g, n) == 1)
-		return 0;
-	else{
-		t.trace("error", "%s getEffect reached error case, not source or target (%p)\n", name, this);
-		return 0;
-	}	
-}
+Interaction* Degradation::clone(Arena& a){ return new (a) Degradation(*this); }
 
 /**
  * Translation::Translation()
@@ -150,48 +60,13 @@ Translation::Translation(){
 	t.trace("mloc","Interaction at location %p\n", this);
 	
 	name="tsln";	
+	kind = IK_TRANSLATION;
 
 	t.trace("init","New Interaction created\n");
 }
 
 Translation::~Translation(){}
-
-/**
- * float Translation::getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float)
- * 
- * Overload of virtual method Interaction::getEffect
- *
- * @param g Reference to the Digraph object. Can be used to make complex effects based on local configuration around the current node
- * @param m Reference to the NodeMap object. Can be used to get the Molecule objects from the graph contaniers.
- * @param i Reference to the ArcMap object. Can be used to get the Interaction objects from the graph containers.
- * @param n The Node being affected by the interaction. Note that this can be the source or target.
- * @param rkIter The current iteration of Runge-Kutta evaluation.
- * @param rkStep The stepsize of the Runge-Kutta evaluation.
- *
- * @return The effect (change) of this interaction has on the concentration of node n at the current iteration of runge-kutta
- */
-float Translation::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m, ListDigraph::ArcMap<Interaction*>* i, ListDigraph::Node n, int rkIter, float rkStep){	
-	
-	t.trace("efct","Original Node value: %f\n", (*m)[n]->getValue());
-	t.trace("efct","Interaction Rate: %f\n", rate);
-	t.trace("efct","Interaction Dir: %s\n", (g->source(g->arcFromId(arcID)) == n) ? "outgoing" : "incoming");
-	t.trace("efct","Opposite Node value: %f\n", (*m)[g->oppositeNode(n, g->arcFromId(arcID))]->getValue());
-	t.trace("efct","isSourceNode() == %d\n", isSourceNode(g,n));
-	Molecule* thisMol = (*m)[n];
-	Molecule* oppositeMol = (*m)[g->oppositeNode(n, g->arcFromId(arcID))];
-
-	//if the effect is being calculated for the source node
-	if(isSourceNode(g, n) == 1)
-		return 0;
-	//effect is being calculated for the target node
-	else if(isTargetNode(g, n) == 1)
-		return oppositeMol->rkApprox(rkIter, rkStep) * rate;
-
-	else{ 
-		t.trace("error", "%s getEffect reached error case, not source or target (%p)\n", name, this);
-		return 0;
-	}
-}
+Interaction* Translation::clone(Arena& a){ return new (a) Translation(*this); }
 
 /**
  * ForwardComplexation::ForwardComplexation(int, int)
@@ -202,7 +77,7 @@ float Translation::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m,
  *
  * The NodeID's of the two proteins involved are saved in each ForwardComplexation interaction, because the effect of the interaction is based
  *  on the concentration of both proteins, and each interaction should have the same effect. The NodeID's allow a simple way to retreive these 
- *  proteins during ForwardComplexation::getEffect() 
+ *  proteins when the network is compiled (see Kinetics::compile)
  *
  * P1 >==(ForwardComplexation)==> 
  *                                 Complex
@@ -214,6 +89,7 @@ ForwardComplexation::ForwardComplexation(){
 	t.trace("cust","Custom Interaction type Complexation\n");
 	t.trace("mloc","Interaction at location %p\n", this);
 	name="f_cmplx";
+	kind = IK_FORWARD_COMPLEXATION;
 
 	
 	t.trace("init","New Interaction created\n");
@@ -221,45 +97,7 @@ ForwardComplexation::ForwardComplexation(){
 
 }
 ForwardComplexation::~ForwardComplexation(){}
-
-/**
- * float ForwardComplexation::getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float)
- * 
- * Overload of virtual method Interaction::getEffect
- *
- * @param g Reference to the Digraph object. Can be used to make complex effects based on local configuration around the current node
- * @param m Reference to the NodeMap object. Can be used to get the Molecule objects from the graph contaniers.
- * @param i Reference to the ArcMap object. Can be used to get the Interaction objects from the graph containers.
- * @param n The Node being affected by the interaction. Note that this can be the source or target.
- * @param rkIter The current iteration of Runge-Kutta evaluation.
- * @param rkStep The stepsize of the Runge-Kutta evaluation.
- *
- * @return The effect (change) of this interaction has on the concentration of node n at the current iteration of runge-kutta
- */
-float ForwardComplexation::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m, ListDigraph::ArcMap<Interaction*>* i, ListDigraph::Node n, int rkIter, float rkStep){	
-	
-	t.trace("efct","Original Node value: %f\n", (*m)[n]->getValue());
-	t.trace("efct","Interaction Rate: %f\n", rate);
-	t.trace("efct","Interaction Dir: %s\n", (g->source(g->arcFromId(arcID)) == n) ? "outgoing" : "incoming");
-	t.trace("efct","Opposite Node value: %f\n", (*m)[g->oppositeNode(n, g->arcFromId(arcID))]->getValue());
-
-	Molecule* thisMol = (*m)[n];
-	Molecule* oppositeMol = (*m)[g->oppositeNode(n, g->arcFromId(arcID))];
-	Molecule* pairMol = (*m)[g->source(g->arcFromId(pairArcID))];
-
-
-	//effect on source node
-	if(isSourceNode(g, n) == 1)
-		return -1 * rate * thisMol->rkApprox(rkIter, rkStep) * pairMol->rkApprox(rkIter, rkStep);
-	//effect on target node
-	else if(isTargetNode(g, n) == 1)
-		return .5 * rate * oppositeMol->rkApprox(rkIter, rkStep) * pairMol->rkApprox(rkIter, rkStep);
-	else{
-		t.trace("error", "%s getEffect reached error case, not source or target (%p)\n", name, this);
-		return 0;	
-	}
-
-}
+Interaction* ForwardComplexation::clone(Arena& a){ return new (a) ForwardComplexation(*this); }
 
 /**
  * void ForwardComplexation::setPairArcID(int i)
@@ -273,6 +111,16 @@ void ForwardComplexation::setPairArcID(int i){
 	pairArcID = i;
 }
 
+void ForwardComplexation::save(Snapshot& s){
+	Interaction::save(s);
+	s.putInt(pairArcID);
+}
+
+void ForwardComplexation::load(Snapshot& s){
+	Interaction::load(s);
+	pairArcID = s.getInt();
+}
+
 
 /**
  * ReverseComplexation::ReverseComplexation(int, int)
@@ -283,7 +131,7 @@ void ForwardComplexation::setPairArcID(int i){
  *
  * The NodeID's of the two proteins involved are saved in each ReverseComplexation interaction, because the effect of the interaction is based
  *  on the concentration of both proteins, and each interaction should have the same effect. The NodeID's allow a simple way to retreive these 
- *  proteins during ReverseComplexation::getEffect() 
+ *  proteins when the network is compiled (see Kinetics::compile)
  *
  *       >==(ReverseComplexation)==> P1
  *  Complex                          
@@ -296,50 +144,14 @@ ReverseComplexation::ReverseComplexation(){
 	t.trace("mloc","Interaction at location %p\n", this);
 
 	name="r_cmplx";
+	kind = IK_REVERSE_COMPLEXATION;
 	
 	t.trace("init","New Interaction created\n");
 
 
 }
 ReverseComplexation::~ReverseComplexation(){}
-
-/**
- * float ReverseComplexation::getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float)
- * 
- * Overload of virtual method Interaction::getEffect
- *
- * @param g Reference to the Digraph object. Can be used to make complex effects based on local configuration around the current node
- * @param m Reference to the NodeMap object. Can be used to get the Molecule objects from the graph contaniers.
- * @param i Reference to the ArcMap object. Can be used to get the Interaction objects from the graph containers.
- * @param n The Node being affected by the interaction. Note that this can be the source or target.
- * @param rkIter The current iteration of Runge-Kutta evaluation.
- * @param rkStep The stepsize of the Runge-Kutta evaluation.
- *
- * @return The effect (change) of this interaction has on the concentration of node n at the current iteration of runge-kutta
- */
-float ReverseComplexation::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m, ListDigraph::ArcMap<Interaction*>* i, ListDigraph::Node n, int rkIter, float rkStep){	
-	
-	t.trace("efct","Original Node value: %f\n", (*m)[n]->getValue());
-	t.trace("efct","Interaction Rate: %f\n", rate);
-	t.trace("efct","Interaction Dir: %s\n", (g->source(g->arcFromId(arcID)) == n) ? "outgoing" : "incoming");
-	t.trace("efct","Opposite Node value: %f\n", (*m)[g->oppositeNode(n, g->arcFromId(arcID))]->getValue());
-
-	
-	Molecule* oppositeMol = (*m)[g->oppositeNode(n, g->arcFromId(arcID))];
-	Molecule* pairMol = (*m)[g->source(g->arcFromId(pairArcID))];
-
-	//effect on source node
-	if(isSourceNode(g, n) == 1)
-		return -1 * .5 * rate * (*m)[n]->rkApprox(rkIter, rkStep);
-	//effect on target node
-	else if(isTargetNode(g, n) == 1)
-		return  rate * oppositeMol->rkApprox(rkIter, rkStep); 
-	else{
-		t.trace("error", "%s getEffect reached error case, not source or target (%p)\n", name, this);
-		return 0;	
-	}
-
-}
+Interaction* ReverseComplexation::clone(Arena& a){ return new (a) ReverseComplexation(*this); }
 
 /**
  * void ReverseComplexation::setPairArcID(int i)
@@ -353,6 +165,16 @@ void ReverseComplexation::setPairArcID(int i){
 	pairArcID = i;
 }
 
+void ReverseComplexation::save(Snapshot& s){
+	Interaction::save(s);
+	s.putInt(pairArcID);
+}
+
+void ReverseComplexation::load(Snapshot& s){
+	Interaction::load(s);
+	pairArcID = s.getInt();
+}
+
 /**
  * ForwardPTM::ForwardPTM() 
  * 
@@ -369,11 +191,13 @@ ForwardPTM::ForwardPTM(){
 	t.trace("mloc","Interaction at location %p\n", this);
 	
 	name="f_ptm";	
+	kind = IK_FORWARD_PTM;
 
 	t.trace("init","New Interaction created\n");
 }
 
 ForwardPTM::~ForwardPTM(){}
+Interaction* ForwardPTM::clone(Arena& a){ return new (a) ForwardPTM(*this); }
 
 /**
  * ReversePTM::ReversePTM() 
@@ -391,11 +215,13 @@ ReversePTM::ReversePTM(){
 	t.trace("mloc","Interaction at location %p\n", this);
 	
 	name="r_ptm";	
+	kind = IK_REVERSE_PTM;
 
 	t.trace("init","New Interaction created\n");
 }
 
 ReversePTM::~ReversePTM(){}
+Interaction* ReversePTM::clone(Arena& a){ return new (a) ReversePTM(*this); }
 
 /**
  * PromoterBind::PromoterBind
@@ -413,6 +239,7 @@ ReversePTM::~ReversePTM(){}
  */
 PromoterBind::PromoterBind(float fwdRate, float revRate){
 	name="pro";
+	kind = IK_PROMOTER_BIND;
 	kf = fwdRate;
 	kr = revRate;
 	rate = kf - kr;
@@ -422,41 +249,8 @@ PromoterBind::PromoterBind(float fwdRate, float revRate){
 	promoterType = 0;
 }
 PromoterBind::~PromoterBind(){}
+Interaction* PromoterBind::clone(Arena& a){ return new (a) PromoterBind(*this); }
 
-/**
- * float PromoterBind::getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float)
- * 
- * Overload of virtual method Interaction::getEffect
- *
- * @param g Reference to the Digraph object. Can be used to make complex effects based on local configuration around the current node
- * @param m Reference to the NodeMap object. Can be used to get the Molecule objects from the graph contaniers.
- * @param i Reference to the ArcMap object. Can be used to get the Interaction objects from the graph containers.
- * @param n The Node being affected by the interaction. Note that this can be the source or target.
- * @param rkIter The current iteration of Runge-Kutta evaluation.
- * @param rkStep The stepsize of the Runge-Kutta evaluation.
- *
- * @return The effect (change) of this interaction has on the concentration of node n at the current iteration of runge-kutta
- */
-float PromoterBind::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m, ListDigraph::ArcMap<Interaction*>* i, ListDigraph::Node n, int rkIter, float rkStep){	
-	
-	t.trace("efct","Original Node value: %f\n", (*m)[n]->getValue());
-	t.trace("efct","Interaction Rate: %f\n", rate);
-	t.trace("efct","Interaction Dir: %s\n", (g->source(g->arcFromId(arcID)) == n) ? "outgoing" : "incoming");
-	t.trace("efct","Opposite Node value: %f\n", (*m)[g->oppositeNode(n, g->arcFromId(arcID))]->getValue());
-
-	Molecule* thisMol = (*m)[n];
-	Molecule* oppositeMol = (*m)[g->oppositeNode(n, g->arcFromId(arcID))];
-
-	if(isSourceNode(g, n) == 1)
-		return -1 * oppositeMol->rkApprox(rkIter, rkStep) * (kf-kr);
-	else if(isTargetNode(g, n) == 1)
-		return kr * (1 - thisMol->rkApprox(rkIter, rkStep));
-	else{
-		t.trace("error", "%s getEffect reached error case, not source or target (%p)\n", name, this);
-		return 0;
-	}	
-
-}
 /**
  * Determines if the promoter is repressing the gene it is binding to.
  * 
@@ -486,7 +280,7 @@ int PromoterBind::isActivation(){
 /**
  * Sets the promoter interaction as a repression type. 
  *
- * The concentration of the protein being bound will cause the DNA being bound to to translate at less than it's basal rate (See Transcription::getEffect)
+ * The concentration of the protein being bound will cause the DNA being bound to to translate at less than it's basal rate (see Kinetics::evaluate)
 */
 void PromoterBind::setAsRepression(){
 	promoterType = -1;
@@ -496,9 +290,33 @@ void PromoterBind::setAsRepression(){
 /**
  * Sets the promoter interaction as an activation type. 
  *
- * The concentration of the protein being bound will cause the DNA being bound to to translate at more than it's basal rate (See Transcription::getEffect)
+ * The concentration of the protein being bound will cause the DNA being bound to to translate at more than it's basal rate (see Kinetics::evaluate)
 */
 void PromoterBind::setAsActivation(){
 	name = "act";
 	promoterType = 1;
 }
+
+void PromoterBind::save(Snapshot& s){
+	Interaction::save(s);
+	s.putFloat(kf);
+	s.putFloat(kr);
+	s.putInt(promoterType);
+}
+
+/**
+ * void PromoterBind::load(Snapshot&)
+ *
+ * Restore the rates and the promoter type (and with it the displayed name).
+ */
+void PromoterBind::load(Snapshot& s){
+	Interaction::load(s);
+	kf = s.getFloat();
+	kr = s.getFloat();
+	promoterType = s.getInt();
+
+	if(promoterType == -1)
+		setAsRepression();
+	else if(promoterType == 1)
+		setAsActivation();
+}
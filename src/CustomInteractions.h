@@ -10,7 +10,7 @@ class DerivGraph;
 
 #include "Interaction.h"
 #include <cstdio>
-#include "lemon/list_graph.h"
+#include "lemon/smart_graph.h"
 using namespace lemon;
 
 
@@ -19,14 +19,14 @@ class Transcription : public Interaction{
  public:
 	Transcription();
 	~Transcription();
-	virtual float getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float);
+	Interaction* clone(Arena&);
 };
 
 class Degradation : public Interaction{
  public:
 	Degradation();
 	~Degradation();
-	virtual float getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float);
+	Interaction* clone(Arena&);
 };
 
 
@@ -34,23 +34,27 @@ class Translation : public Interaction{
  public:
 	Translation();
 	~Translation();
-	virtual float getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float);
+	Interaction* clone(Arena&);
 };
 
 class ForwardComplexation : public Interaction{
  public:
 	ForwardComplexation();
 	~ForwardComplexation();
-	virtual float getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float);
+	Interaction* clone(Arena&);
 	void setPairArcID(int);
+	void save(Snapshot&);
+	void load(Snapshot&);
 	int pairArcID;
 };
 class ReverseComplexation : public Interaction{
  public:
 	ReverseComplexation();
 	~ReverseComplexation();
-	virtual float getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float);
+	Interaction* clone(Arena&);
 	void setPairArcID(int);
+	void save(Snapshot&);
+	void load(Snapshot&);
 	int pairArcID;
 
 };
@@ -59,12 +63,14 @@ class ForwardPTM : public Interaction{
  public:
 	ForwardPTM();
 	~ForwardPTM();
+	Interaction* clone(Arena&);
 };
 
 class ReversePTM : public Interaction{
  public:
 	ReversePTM();
 	~ReversePTM();
+	Interaction* clone(Arena&);
 
 };
 
@@ -72,6 +78,7 @@ class PromoterBind : public Interaction{
  public:
 	PromoterBind(float, float);
 	~PromoterBind();
+	Interaction* clone(Arena&);
 	
 	int promoterType; // -1 for repression, 1 activation
 	
@@ -81,8 +88,10 @@ class PromoterBind : public Interaction{
 	int isActivation();
 	void setAsRepression();
 	void setAsActivation();
+
+	void save(Snapshot&);
+	void load(Snapshot&);
 	
-	virtual float getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float);
 };
 
 
@@ -7,6 +7,8 @@
  *
  */
 #include "CustomMolecules.h"
+#include "Checkpoint.h"
+#include "Arena.h"
 #include "ExternTrace.h"
 /**
  * DNA::DNA()
@@ -18,18 +20,19 @@
  *
  */
 
-extern int hillParam;
 DNA::DNA(){
 
 	t.trace("init","Molecule %p type:DNA\n", this);	
 	promoterId = -1;
 	currentConcentration = 1;
-	hill = hillParam;
+	//the hill coefficient of the network, which DerivGraph sets on the DNA it adds
+	hill = 1;
 	histoneModValue = 1;
 	currentDir = 0;
 	prevDir = 0;
 	longName = "DNA";
 	shortName = "g";
+	kind = MK_DNA;
 }
 
 
@@ -66,10 +69,29 @@ float DNA::rkApprox(int rkstep, float step)
 {
 	return currentConcentration * DNA::getValue();
 }
+Molecule* DNA::clone(Arena& a){
+	return new (a) DNA(*this);
+}
 void DNA::setHistoneModValue(float newVal){
 	histoneModValue = newVal;
 }
 
+void DNA::save(Snapshot& s){
+
+	Molecule::save(s);
+	s.putInt(promoterId);
+	s.putInt(hill);
+	s.putFloat(histoneModValue);
+}
+
+void DNA::load(Snapshot& s){
+
+	Molecule::load(s);
+	promoterId = s.getInt();
+	hill = s.getInt();
+	histoneModValue = s.getFloat();
+}
+
 void DNA::setValue(float newValue){
 
 	newValue = 1;
@@ -84,11 +106,15 @@ NullNode::NullNode(){
 	t.trace("init","Molecule %p type:NulNode\n", this);	
 	longName = "NullNode";
 	shortName = "n";
+	kind = MK_NULL;
 	currentDir = 0;
 	currentConcentration = 0;
 	prevDir = 0;
 }
 NullNode::~NullNode(){}
+Molecule* NullNode::clone(Arena& a){
+	return new (a) NullNode(*this);
+}
 float NullNode::getValue(){
 	return 0;
 }
@@ -98,6 +124,7 @@ mRNA::mRNA(){
 	t.trace("init","Molecule %p type:mRNA\n", this);	
 	longName = "mRNA";
 	shortName = "m";
+	kind = MK_MRNA;
 	currentDir = 0;
 	prevDir = 0;
 	currentConcentration = 0;
@@ -105,18 +132,25 @@ mRNA::mRNA(){
 }
 mRNA::~mRNA(){
 }
+Molecule* mRNA::clone(Arena& a){
+	return new (a) mRNA(*this);
+}
 
 Protein::Protein(){
 
 	t.trace("init","Molecule %p type:Protein\n", this);	
 	longName = "Protein";
 	shortName = "p";
+	kind = MK_PROTEIN;
 	currentDir = 0;
 	prevDir = 0;
 	currentConcentration = 0;
 	numChanges = 0;
 }
 Protein::~Protein(){}
+Molecule* Protein::clone(Arena& a){
+	return new (a) Protein(*this);
+}
 
 Complex::Complex(int n1, int n2){
 
@@ -127,6 +161,7 @@ Complex::Complex(int n1, int n2){
 
 	longName="Complex";
 	shortName="c";
+	kind = MK_COMPLEX;
 	id1 = n1;
 	id2 = n2;
 	currentConcentration = 0;
@@ -145,6 +180,29 @@ int Complex::getComponentId(int i){
 
 }
 
+void Complex::setComponentIds(int n1, int n2){
+	id1 = n1;
+	id2 = n2;
+}
+
+Molecule* Complex::clone(Arena& a){
+	return new (a) Complex(*this);
+}
+
+void Complex::save(Snapshot& s){
+
+	Molecule::save(s);
+	s.putInt(id1);
+	s.putInt(id2);
+}
+
+void Complex::load(Snapshot& s){
+
+	Molecule::load(s);
+	id1 = s.getInt();
+	id2 = s.getInt();
+}
+
 
 PTMProtein::PTMProtein(){
 
@@ -152,6 +210,7 @@ PTMProtein::PTMProtein(){
 
 	longName = "PTM";
 	shortName = "ptm";
+	kind = MK_PTM;
 
 	currentDir = 0;
 	prevDir = 0;
@@ -195,5 +254,9 @@ char* PTMProtein::getLongName(){
 PTMProtein::~PTMProtein(){
 }
 
+Molecule* PTMProtein::clone(Arena& a){
+	return new (a) PTMProtein(*this);
+}
+
 
 
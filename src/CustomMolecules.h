@@ -13,6 +13,7 @@ public:
 	PTMProtein(PTMProtein* );
 	
 	~PTMProtein();
+	Molecule* clone(Arena&);
 	char* getLongName();	
 	void addRandPTM(int);
 	
@@ -26,8 +27,11 @@ public:
 	
 	float getValue();
 	float rkApprox(int, float);
+	Molecule* clone(Arena&);
 	void setHistoneModValue(float);
 	virtual	void setValue(float);
+	void save(Snapshot&);
+	void load(Snapshot&);
 	int promoterId;
 	int hill;
 private:
@@ -40,6 +44,7 @@ public:
 	~NullNode();
 
 	virtual float getValue();
+	Molecule* clone(Arena&);
 
 };
 
@@ -47,6 +52,7 @@ class mRNA : public Molecule{
 public:
 	mRNA();
 	~mRNA();
+	Molecule* clone(Arena&);
 
 };
 
@@ -54,6 +60,7 @@ class Protein : public Molecule{
 public:
 	Protein();
 	~Protein();
+	Molecule* clone(Arena&);
 };
 
 class Complex : public Protein{
@@ -62,6 +69,10 @@ public:
 	Complex(int, int);
 	~Complex();
 	int getComponentId(int);
+	void setComponentIds(int, int);
+	Molecule* clone(Arena&);
+	void save(Snapshot&);
+	void load(Snapshot&);
 private:
 
 	int id1;
@@ -0,0 +1,130 @@
+/**
+ * CycleDetector.cpp
+ *
+ * Poincare section limit cycle detection, fed one timestep at a time by DerivGraph::rungeKuttaEvaluate.
+ */
+
+#include <cmath>
+
+#include "CycleDetector.h"
+
+#include "ExternTrace.h"
+
+// relative tolerance on the period and on the state at consecutive crossings
+#define CYCLE_TOLERANCE 1e-3
+
+// standard deviation below which the section molecule is taken as constant, and no cycle is looked for
+#define CYCLE_MIN_DEVIATION 1e-4
+
+/**
+ * CycleDetector::CycleDetector(int, int, int)
+ *
+ * @param numCycles the number of consecutive consistent periods which make the orbit periodic
+ * @param numSteps the number of timesteps of the whole run
+ * @param numNodes the number of molecules observed
+ */
+CycleDetector::CycleDetector(int numCycles, int numSteps, int numNodes)
+	:cycles(numCycles), steps(numSteps), nodes(numNodes){
+
+	section = -1;
+	level = 0;
+	samples = 0;
+	scale = 0;
+	crossingTime = 0;
+	crossings = 0;
+	period = 0;
+	consistent = 0;
+
+	mean.assign(nodes, 0);
+	m2.assign(nodes, 0);
+	previous.assign(nodes, 0);
+	crossing.assign(nodes, 0);
+}
+
+/**
+ * int CycleDetector::observe(int, const float*)
+ *
+ * Take the state after one more timestep.
+ *
+ * @param step the number of timesteps taken so far
+ * @param y the concentration of every molecule
+ *
+ * @return 1 once the orbit is periodic, with the period given by getPeriod(), otherwise 0
+ */
+int CycleDetector::observe(int step, const float* y){
+
+	int quarter = steps / 4;
+	int half = steps / 2;
+
+	if(step <= quarter)
+		return 0;
+
+	//statistics of the second quarter
+	if(step <= half){
+		samples++;
+		for(int n = 0; n < nodes; n++){
+			double d = y[n] - mean[n];
+			mean[n] += d / samples;
+			m2[n] += d * (y[n] - mean[n]);
+		}
+
+		if(step == half){
+			double best = 0;
+			for(int n = 0; n < nodes; n++){
+				double deviation = sqrt(m2[n] / samples);
+				if(deviation > best){
+					best = deviation;
+					section = n;
+				}
+			}
+			if(best < CYCLE_MIN_DEVIATION)
+				section = -1;
+			else{
+				level = mean[section];
+				scale = best;
+				t.trace("rk","Poincare section on node %d at %f, deviation %f\n", section, level, best);
+			}
+		}
+
+		for(int n = 0; n < nodes; n++)
+			previous[n] = y[n];
+		return 0;
+	}
+
+	if(section < 0)
+		return 0;
+
+	int found = 0;
+
+	//an upward crossing of the section during the last timestep
+	if(previous[section] < level && y[section] >= level){
+
+		float f = (level - previous[section]) / (y[section] - previous[section]);
+		float time = step - 1 + f;
+
+		float distance = 0;
+		for(int n = 0; n < nodes; n++){
+			float x = previous[n] + f * (y[n] - previous[n]);
+			float d = fabs(x - crossing[n]);
+			if(d > distance)
+				distance = d;
+			crossing[n] = x;
+		}
+
+		if(crossings > 0){
+			float p = time - crossingTime;
+			int same = crossings > 1 && fabs(p - period) <= CYCLE_TOLERANCE * p && distance <= CYCLE_TOLERANCE * scale;
+			consistent = same ? consistent + 1 : 0;
+			period = p;
+			found = (consistent >= cycles);
+		}
+
+		crossingTime = time;
+		crossings++;
+	}
+
+	for(int n = 0; n < nodes; n++)
+		previous[n] = y[n];
+
+	return found;
+}
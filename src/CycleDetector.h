@@ -0,0 +1,55 @@
+/**
+ * CycleDetector.h
+ *
+ * Detection of a limit cycle while a network is being integrated, so the integration can stop early.
+ *
+ * The second quarter of the run picks the Poincare section: the molecule with the highest variance over that
+ * quarter, crossing its mean upwards. From the middle of the run on, every crossing of the section is located by
+ * linear interpolation between timesteps, together with the state of the whole network at that moment. The orbit is
+ * periodic once the given number of consecutive crossings each return to the state of the previous one, and come
+ * one period after it, within a relative tolerance.
+ *
+ */
+
+#ifndef CYCLEDETECTOR_H_
+#define CYCLEDETECTOR_H_
+
+#include <vector>
+
+using namespace std;
+
+class CycleDetector{
+
+public:
+	CycleDetector(int, int, int);
+
+	int observe(int, const float*);
+
+	float getPeriod(){ return period; };
+
+private:
+	int cycles;
+	int steps;
+	int nodes;
+
+	// the section molecule (-1 until chosen, or if nothing varies), and the value it crosses
+	int section;
+	float level;
+
+	// running mean and variance of every molecule over the second quarter
+	vector<double> mean;
+	vector<double> m2;
+	int samples;
+	double scale;
+
+	// the state at the previous timestep and at the last crossing
+	vector<float> previous;
+	vector<float> crossing;
+	float crossingTime;
+	int crossings;
+
+	float period;
+	int consistent;
+};
+
+#endif
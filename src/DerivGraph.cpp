@@ -10,12 +10,53 @@
  *     Runge-Kutta solving
  */
 
+#include <cmath>
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <sys/time.h>
 #include "DerivGraph.h"
+
+//the LEMON maps the readers use derive from std::iterator, deprecated since C++17
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#include "lemon/lgf_reader.h"
+#include "lemon/lgf_writer.h"
+#pragma GCC diagnostic pop
+
+//the concept checks of the component algorithms (DerivGraph::hasFeedback) leave unused typedefs and variables
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-local-typedefs"
+#pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+#include "lemon/connectivity.h"
+#pragma GCC diagnostic pop
+
+#include "lemon/unionfind.h"
 using namespace std;
 
 #include "ExternTrace.h"
 
+// number of arc visits timed by each method of DerivGraph::benchmark
+#define BENCH_ARC_VISITS 50000000
+
+// DerivGraph::stepBenchmark: reference timestep as a fraction of the shortest step tried, timestep doublings tried,
+// the largest error of an accurate run, relative to 1 + the reference concentration, and the largest concentration
+// of a stable run, relative to 1 + the largest reference concentration
+#define BENCH_STEP_REFINE 16
+#define BENCH_STEP_DOUBLINGS 8
+#define BENCH_STEP_TOLERANCE 1e-2
+#define BENCH_STEP_BOUND 10
+
+// molecules per unit of concentration in the Gillespie simulation
+#define SSA_SYSTEM_SIZE 100
+
+// reactions after which a Gillespie simulation is abandoned, as the network is too fast to simulate stochastically
+#define SSA_MAX_EVENTS 10000000
+
+// weight every rate mutation candidate gets in addition to its relative sensitivity
+#define GUIDED_RATE_FLOOR 0.1
+
 
 
 /**
@@ -23,7 +64,7 @@ using namespace std;
  *
  * DerivGraph constructor.
  *
- * The DerivGraph holds LEMON objects such as ListDigraph, NodeMap, and ArcMap.
+ * The DerivGraph holds LEMON objects such as SmartDigraph, NodeMap, and ArcMap.
  * It also holds the data produced by Runge-Kutta and facilitates plotting using Gnuplot.
  *
  * The derivatives describing the concentration of molecules in the cell can be represented as a directed graph.
@@ -32,9 +73,12 @@ using namespace std;
  * effect on the Nodes which it connects.
  *
  * Allocates:
- *     1 ListDigraph() object
- *     1 ListDigraph::NodeMap objects
- *     1 ListDigraph::ArcMap object
+ *     1 SmartDigraph() object
+ *     1 SmartDigraph::NodeMap objects
+ *     1 SmartDigraph::ArcMap object
+ *     1 ArcTable object
+ *     1 Kinetics object
+ *     1 Arena object
  */
 DerivGraph::DerivGraph(){
     
@@ -42,16 +86,167 @@ DerivGraph::DerivGraph(){
     
     t.trace("mloc","DerivGraph location at %p\n",  this);
 
+    allocate();
+    refs = 1;
+    evaluated = 0;
+    analysed = 0;
+    measured = 0;
+    screened = 0;
+    linearised = 0;
+    rejected = 0;
+    pthread_mutex_init(&mutex, 0);
+
+    t.trace("init","New DerivGraph created\n");
+
+    //the count is used to name new molecules
+    count=0;
+
+    hill = 1;
+
+    //create the null node targeted by degradation interactions
+    nullnode = add(new (*arena) NullNode());
+    (*molecules)[nullnode]->setID(count++);
+
+
+
+}
+
+/**
+ * DerivGraph::DerivGraph(const DerivGraph&)
+ *
+ * DerivGraph copy constructor.
+ *
+ * Builds an independent copy of another network. Nodes and Arcs are added in id order, so they keep their ids, and the
+ * promoterId, pairArcID and complex component cross references stay valid without translation. The type lists are
+ * copied in order, so a random mutation of the copy selects the same members as it would in the original.
+ *
+ * The copied Molecules and Interactions are placed in the Arena of the copy, like the members added by mutations.
+ *
+ * The random generator is copied as well, and should be reseeded if the copy is to evolve independently. The copy
+ * is not shared, and has to be evaluated again before its Runge-Kutta solution is used. A copy of a network rejected by
+ * a screen stays rejected, so it does not take the score the molecules had before.
+ *
+ * Allocates:
+ *     1 SmartDigraph() object
+ *     1 SmartDigraph::NodeMap objects
+ *     1 SmartDigraph::ArcMap object
+ *     1 ArcTable object
+ *     1 Kinetics object
+ *     1 Arena object
+ *
+ * @param other the DerivGraph to copy
+ */
+DerivGraph::DerivGraph(const DerivGraph& other)
+	:r(other.r), minKineticRate(other.minKineticRate), maxKineticRate(other.maxKineticRate), defaultInitialConcentration(other.defaultInitialConcentration),
+	 maxComp(other.maxComp), maxBasic(other.maxBasic), maxProm(other.maxProm), maxPTM(other.maxPTM), hill(other.hill),
+	 rkTimeStep(other.rkTimeStep), rkTimeLimit(other.rkTimeLimit), count(other.count){
+
+    t.trace("init","Copying DerivGraph %p\n", &other);
+
+    allocate();
+    refs = 1;
+    evaluated = 0;
+    analysed = 0;
+    measured = 0;
+    screened = 0;
+    linearised = 0;
+    rejected = other.rejected;
+    pthread_mutex_init(&mutex, 0);
+
+    //the sensitivities of the original guide the mutations of the copy until it is analysed again
+    rateSensitivity = other.rateSensitivity;
+
+    SmartDigraph* g = other.derivs;
+    int numNodes = g->maxNodeId() + 1;
+    int numArcs = g->maxArcId() + 1;
+
+    derivs->reserveNode(numNodes);
+    derivs->reserveArc(numArcs);
+
+    //molecules, in id order. The first one is the null node
+    for(int id = 0; id < numNodes; id++){
+	SmartDigraph::Node n = derivs->addNode();
+	(*molecules)[n] = (*other.molecules)[g->nodeFromId(id)]->clone(*arena);
+    }
+    nullnode = derivs->nodeFromId(g->id(other.nullnode));
+
+    //interactions, in id order
+    for(int id = 0; id < numArcs; id++){
+	SmartDigraph::Arc from = g->arcFromId(id);
+	SmartDigraph::Arc a = derivs->addArc(derivs->nodeFromId(g->id(g->source(from))), derivs->nodeFromId(g->id(g->target(from))));
+	(*interactions)[a] = (*other.interactions)[from]->clone(*arena);
+    }
+
+    copyList(other.MoleculeList, MoleculeList, 1);
+    copyList(other.ProteinList, ProteinList, 1);
+    copyList(other.mRNAList, mRNAList, 1);
+    copyList(other.DNAList, DNAList, 1);
+    copyList(other.ComplexList, ComplexList, 1);
+    copyList(other.PTMList, PTMList, 1);
+
+    copyList(other.InteractionList, InteractionList, 0);
+    copyList(other.TranscriptionList, TranscriptionList, 0);
+    copyList(other.TranslationList, TranslationList, 0);
+    copyList(other.DegradationList, DegradationList, 0);
+    copyList(other.ForwardComplexationList, ForwardComplexationList, 0);
+    copyList(other.ReverseComplexationList, ReverseComplexationList, 0);
+    copyList(other.ForwardPTMList, ForwardPTMList, 0);
+    copyList(other.ReversePTMList, ReversePTMList, 0);
+    copyList(other.PromoterBindList, PromoterBindList, 0);
+
+    t.trace("init","DerivGraph %p copied (%d bytes of arena)\n", this, (int)arena->getSize());
+}
+
+/**
+ * DerivGraph* DerivGraph::share()
+ *
+ * Add a holder to the DerivGraph. Cells hold a shared DerivGraph read only, and replace it with a copy before
+ * changing it (see Cell::makeWritable), so the children of a cell cost nothing until they are mutated.
+ * The count is changed atomically, as cells sharing a network may be mutated on different threads.
+ *
+ * @return this DerivGraph
+ */
+DerivGraph* DerivGraph::share(){
+
+	__sync_fetch_and_add(&refs, 1);
+	return this;
+}
+
+/**
+ * void DerivGraph::release()
+ *
+ * Remove a holder from the DerivGraph, and delete it once nobody holds it. Cells call this instead of delete.
+ */
+void DerivGraph::release(){
+
+	if(__sync_sub_and_fetch(&refs, 1) == 0)
+		delete this;
+}
+
+/**
+ * void DerivGraph::allocate()
+ *
+ * Allocate the arena, the graph structure and the type lists. Used by the constructors.
+ */
+void DerivGraph::allocate(){
+
+    //the molecules and interactions of the network
+    arena = new Arena();
+
     //create the directed graph
-    derivs = new ListDigraph();
-    t.trace("mloc","DerivGraph %p ListDigraph location at %p\n",   this,   derivs);
+    derivs = new SmartDigraph();
+    t.trace("mloc","DerivGraph %p SmartDigraph location at %p\n",   this,   derivs);
+
+    //adjacency table of the graph and the compiled rate laws, built when the network is evaluated
+    arcTable = new ArcTable();
+    kinetics = new Kinetics();
 
     //map molecules onto the nodes
-    molecules = new ListDigraph::NodeMap<Molecule*>(*derivs);
+    molecules = new SmartDigraph::NodeMap<Molecule*>(*derivs);
     t.trace("mloc","DerivGraph %p NodeMap location at %p\n",   this,   molecules);
     
     //map interactions onto the arcs
-    interactions = new ListDigraph::ArcMap<Interaction*>(*derivs);
+    interactions = new SmartDigraph::ArcMap<Interaction*>(*derivs);
     t.trace("mloc","DerivGraph %p ArcMap location at %p\n",   this,   interactions);
   
   /*
@@ -117,17 +312,24 @@ DerivGraph::DerivGraph(){
     t.trace("mloc","DerivGraph %p PromoterBindList vector at %p\n",   this,   PromoterBindList);
 
 
-    t.trace("init","New DerivGraph created\n");
-
-    //the count is used to name new molecules
-    count=0;
-
-    //create the null node targeted by degradation interactions
-    nullnode = add(new NullNode());
-    (*molecules)[nullnode]->setID(count++);
-
-
+}
 
+/**
+ * void DerivGraph::copyList(const vector<T*>*, vector<T*>*, int)
+ *
+ * Fill one of the type lists with the members of this graph which have the same Node ids (isNode = 1) or Arc ids
+ * (isNode = 0) as the members of a list of another graph.
+ */
+template <class T>
+void DerivGraph::copyList(const vector<T*>* from, vector<T*>* to, int isNode){
+
+	to->reserve(from->size());
+	for(unsigned int i = 0; i < from->size(); i++){
+		if(isNode)
+			to->push_back( (T*) (*molecules)[derivs->nodeFromId(((Molecule*)(*from)[i])->nodeID)]);
+		else
+			to->push_back( (T*) (*interactions)[derivs->arcFromId(((Interaction*)(*from)[i])->arcID)]);
+	}
 }
 
 /**
@@ -140,7 +342,10 @@ DerivGraph::DerivGraph(){
  * 	   n contained Molecule objects
  * 	1 ArcMap object
  * 	   m contained Interaction objects
- * 	1 ListDigraph object
+ * 	1 ArcTable object
+ * 	1 Kinetics object
+ * 	1 SmartDigraph object
+ * 	1 Arena object
  */
 DerivGraph::~DerivGraph(){
 
@@ -164,10 +369,25 @@ DerivGraph::~DerivGraph(){
    delete PromoterBindList;
 
 
+   //delete all Interaction objects mapped by Arcs
+   //(before the molecules, their nodes are still needed to find the arcs)
+   t.trace("free","Deleting members of ArcMap at location %p\n", interactions);
+   for(SmartDigraph::ArcIt it(*derivs); it !=INVALID; ++it){
+   	
+	t.trace("free","Deleting ArcMap member at location %p\n", (*interactions)[it]);
+
+	//members live in the arena, which is released below
+	(*interactions)[it]->~Interaction();
+   }
+
+   //delete the Interaction ArcMap
+   t.trace("free","Deleting ArcMap object at location %p\n",interactions);
+   delete interactions;
+
    //delete all Molecule objects mapped by Nodes
    t.trace("free","Deleting members of NodeMap at location %p\n",  molecules);
 
-   for(ListDigraph::NodeIt it(*derivs); it !=INVALID; ++it){
+   for(SmartDigraph::NodeIt it(*derivs); it !=INVALID; ++it){
 	
 	t.trace("free","Deleting NodeMap member at location %p\n",  (*molecules)[it]);
 	
@@ -175,30 +395,23 @@ DerivGraph::~DerivGraph(){
 	t.trace("free","longnname: %s\n", (*molecules)[it]->getLongName());
 	t.trace("free","shortname: %s\n", (*molecules)[it]->getShortName());
 
-	derivs->erase(it);
-
+	(*molecules)[it]->~Molecule();
    }
 
-
    //delete the Molecule NodeMap
    t.trace("free","Deleting NodeMap object at location %p\n",molecules);
    delete molecules;
 
-   //delete all Interaction objects mapped by Arcs
-   t.trace("free","Deleting members of ArcMap at location %p\n", interactions);
-   for(ListDigraph::ArcIt it(*derivs); it !=INVALID; ++it){
-   	
-	t.trace("free","Deleting ArcMap member at location %p\n", (*interactions)[it]);
-	delete (*interactions)[it];
-   }
+   //release the memory of the members
+   delete arena;
 
-   //delete the Interaction ArcMap
-   t.trace("free","Deleting ArcMap object at location %p\n",interactions);
-   delete interactions;
+   pthread_mutex_destroy(&mutex);
 
+   delete kinetics;
+   delete arcTable;
 
-   //delete the ListDigraph
-   t.trace("free","Deleting ListDigraph object at location %p\n",derivs);
+   //delete the SmartDigraph
+   t.trace("free","Deleting SmartDigraph object at location %p\n",derivs);
    delete derivs;
 }
 
@@ -206,9 +419,9 @@ DerivGraph::~DerivGraph(){
 void DerivGraph::test(){
 	
 	
-	ListDigraph::Node A = add(new Protein());
-	ListDigraph::Node B = add(new Protein());
-	ListDigraph::Node C = add(new Protein());
+	SmartDigraph::Node A = add(new (*arena) Protein());
+	SmartDigraph::Node B = add(new (*arena) Protein());
+	SmartDigraph::Node C = add(new (*arena) Protein());
 	(*molecules)[A]->setID(count++);
 	(*molecules)[B]->setID(count++);
 	(*molecules)[C]->setID(count++);
@@ -217,253 +430,479 @@ void DerivGraph::test(){
 	(*molecules)[B]->setValue(4);
 	(*molecules)[C]->setValue(1);
 
-	ListDigraph::Arc AB = add(new ForwardPTM(), A, B);
-	ListDigraph::Arc AC = add(new ForwardPTM(), A, C);
-	ListDigraph::Arc BC = add(new ForwardPTM(), B, C);
-	ListDigraph::Arc CB = add(new ForwardPTM(), C, B);
+	SmartDigraph::Arc AB = add(new (*arena) ForwardPTM(), A, B);
+	SmartDigraph::Arc AC = add(new (*arena) ForwardPTM(), A, C);
+	SmartDigraph::Arc BC = add(new (*arena) ForwardPTM(), B, C);
+	SmartDigraph::Arc CB = add(new (*arena) ForwardPTM(), C, B);
 
 	(*interactions)[AB]->setRate(.01);
 	(*interactions)[AC]->setRate(.03);
 	(*interactions)[BC]->setRate(.07);
 	(*interactions)[CB]->setRate(.09);
 
-	rungeKuttaEvaluate(rkTimeStep, rkTimeLimit);
+	rungeKuttaEvaluate(rkTimeStep, rkTimeLimit, 0, INTEGRATE_RK4, 0, 1, 0);
 
 return;
 
 }
 
+/**
+ * static float getStateScale(Molecule*)
+ *
+ * @return the factor the concentration of a molecule is multiplied by before the rate laws see it. As in
+ *         Runge-Kutta, DNA is seen through its histone modification and the null node is always empty
+ */
+static float getStateScale(Molecule* m){
+
+	if(m->kind == MK_DNA)
+		return m->getValue();
+	if(m->kind == MK_NULL)
+		return 0;
+	return 1;
+}
+
 /**
  * Uses the Runge-Kutta fourth order method to approximate the solutions to the system of differential equations
  *
  * The result of this algorithm is the vector rungeKuttaSolution within each Molecule object containing the approximation of
  * the concentration at each timestep.
  *
+ * With cycle detection, the integration stops once the network is on a limit cycle (see CycleDetector), and the rest
+ * of the solution repeats the last period. The direction changes of the repeated points are counted as well, so the
+ * scores match those of a full run.
+ *
+ * The Lawson integrator solves the linear reactions exactly, so long timesteps stay stable at high kinetic rates (see
+ * Integrator). Its points are added to the same solution vectors.
+ *
+ * Given a pool of threads, the run is integrated in parallel in time (see Parareal), with the chosen integrator as
+ * the fine propagator. The run is then always integrated to rkLimit, without cycle detection.
+ *
+ * Runge-Kutta only integrates the molecules no conservation law gives (see Conservation), and sets the others from
+ * them at every stage and timestep.
+ *
+ * Without cycle detection, Runge-Kutta integrates each part of the network no reaction links to the others on its own,
+ * and takes the solution of the parts integrated before from the cache instead (see ComponentCache).
+ *
+ * Runge-Kutta shares the evaluation of the rate laws of large networks among a team of threads (see KineticsTeam),
+ * one for every KINETICS_TEAM_ARCS arcs, up to the given number. The solution is the same as without the team.
+ *
  * @param rkStep the timestep (precision) between calculated points
+ * @param rkLimit the length of the run
+ * @param cycles the number of consistent periods which stop the integration, 0 to always integrate to rkLimit
+ * @param integrator the IntegratorMethod
+ * @param slices the pool the time slices of a Parareal run are integrated on, 0 to integrate serially
+ * @param threads the largest number of threads evaluating the rate laws of a Runge-Kutta stage
+ * @param components the solutions of parts of networks integrated before, 0 to integrate every part
  */
-void DerivGraph::rungeKuttaEvaluate(float rkStep, float rkLimit){
-
-	//reset the runge-kutta internal variables for all molecules
-	for(ListDigraph::NodeIt it(*derivs); it != INVALID; ++it)
-		(*molecules)[it]->reset();
-
-	
-
-	//time loop
-	for(float i = 0; i< rkLimit; i+=rkStep){
+void DerivGraph::rungeKuttaEvaluate(float rkStep, float rkLimit, int cycles, int integrator, ThreadPool* slices, int threads, ComponentCache* components){
 
-		//each iteration of this loop refines the approximation based on the previous calculations	
-		for(int k = 0; k<4; k++){
-			
-			//for every interaction in the graph
-			for(ListDigraph::ArcIt it(*derivs); it != INVALID; ++it){
-				
-				//calculate the effect this interaction has on the source molecule
-				(*molecules)[derivs->source(it)]->updateRkVal(k, getEffect(derivs->source(it), it, k, rkStep));
+	//the network has not changed since the last evaluation (it may be shared with cells evaluated earlier)
+	if(evaluated)
+		return;
 
-				//calculate the effect this interaction has on the target molecule
-				(*molecules)[derivs->target(it)]->updateRkVal(k, getEffect(derivs->target(it), it, k, rkStep));
+	arcTable->update(*derivs, *molecules, *interactions);
+	kinetics->compile(*arcTable);
+	int numNodes = arcTable->getNodeCount();
 
-			}
-		}
+	//concentrations of the molecules at the current stage, and the sum of the effects on them
+	vector<float> x(numNodes), dx(numNodes);
 
-		//after the four rkVals are calcualted for all molecules, the next point can be computed
-		for(ListDigraph::NodeIt it(*derivs); it != INVALID; ++it){
-			(*molecules)[it]->nextPoint(rkStep);
-		}
+	//reset the runge-kutta internal variables for all molecules
+	for(int n = 0; n < numNodes; n++)
+		arcTable->nodeFromId(n)->reset();
+
+	//the concentrations the other integrators advance, which the rate laws see scaled
+	vector<float> c(numNodes), scale(numNodes);
+	for(int n = 0; n < numNodes; n++){
+		c[n] = arcTable->nodeFromId(n)->getRungeKuttaSolution()->back();
+		scale[n] = getStateScale(arcTable->nodeFromId(n));
 	}
+	Integrator split(*kinetics, scale, integrator);
 
-	//test output, display the values calculated by runge kutta for each molecule to stdout
-	//for(ListDigraph::NodeIt it(*derivs); it != INVALID; ++it){
-	//	(*molecules)[it]->outputRK();	
-	//}
-}
 
-/*
- * void DerivGraph::gillespieEvaluate()
- *
- * Simulate the cell using the stochastic model given by the gillespie algorithm.
- *
- */
-void DerivGraph::gillespieEvaluate(float timeLimit){
+	//number of timesteps, counted the way the time loop runs
+	int steps = 0;
+	for(float i = 0; i< rkLimit; i+=rkStep)
+		steps++;
 
+	if(slices){
+		vector<float> points;
+		Parareal parareal(*kinetics, scale, integrator, slices);
+		int converged = parareal.run(c, rkStep, steps, points);
+		for(int s = 0; s < steps; s++)
+			for(int n = 0; n < numNodes; n++)
+				arcTable->nodeFromId(n)->addPoint(points[s * numNodes + n]);
 
-	int num = 0;
-	float total = 0.0;
-	float currentTime = 0.0;
-	float randompick;
-
-
-	//TODO: some of the variables from runge kutta should be renamed to be more generic
-	
-	while(currentTime < timeLimit){
-	//the amount of time between interactions occurring is randomly selected
-	//TODO: gillespie papers usually use some kind of term here involving a logarithm to skew the distribution
-	float elapsedTime = r.rand(.05);
-	currentTime += elapsedTime;
+		t.trace("parareal","%d slices %s after %d iterations, speedup %.2f\n", parareal.getSliceCount(), converged ? "converged" : "exact", parareal.getIterations(), parareal.getSpeedup());
+		evaluated = 1;
+		return;
+	}
 
-	//iterate the arcs in the graph and add them to our vector
-	for(ListDigraph::ArcIt it(*derivs); it != INVALID; ++it){
+	//the parts of the network solved before are taken from the cache, and only the reactions of the others compiled
+	Kinetics* rates = kinetics;
+	Kinetics remaining;
+	vector<int> active(numNodes, 1);
+	vector<string> keys;
+	vector< vector<int> > parts;
+	if(components && integrator == INTEGRATE_RK4 && cycles <= 0)
+		if(findComponents(components, rkStep, steps, c, scale, active, keys, parts)){
+			remaining.compile(*arcTable, &active);
+			rates = &remaining;
+		}
 
+	KineticsTeam* team = 0;
+	if(integrator == INTEGRATE_RK4 && KineticsTeam::getTeamSize(arcTable->getArcCount(), threads) > 1)
+		team = new KineticsTeam(*rates, KineticsTeam::getTeamSize(arcTable->getArcCount(), threads));
 
-		Propensities.push_back(it);
+	//the molecules given by conservation laws are not integrated, and the rest are seen as concentrations by the laws
+	Conservation conservation;
+	conservation.analyze(*rates, c, &active);
+	int moieties = conservation.getLawCount() > conservation.getConstantCount();
 
-		//get the rate of the interaction
-		float rate = (*interactions)[Propensities.back()]->getRate();
-		//get the number of molecules from the reaction source
-		int numMols = (*molecules)[derivs->source(Propensities.back())]->stoch_numMols;
+	vector<int> integrated;
+	for(int n = 0; n < numNodes; n++)
+		if(active[n] && !conservation.isDependent(n))
+			integrated.push_back(n);
+	int numIntegrated = integrated.size();
 
-		//update the total propensity
-		total += rate*numMols;
+	CycleDetector detector(cycles, steps, numNodes);
+	int step = 0;
 
-	}
+	//time loop
+	for(float i = 0; i< rkLimit; i+=rkStep){
 
+		if(integrator != INTEGRATE_RK4){
+			split.step(&c[0], rkStep);
+			for(int n = 0; n < numNodes; n++)
+				arcTable->nodeFromId(n)->addPoint(c[n]);
+			step++;
+		}
+		else{
+			//each iteration of this loop refines the approximation based on the previous calculations	
+			for(int k = 0; k<4; k++){
+				
+				for(int j = 0; j < numIntegrated; j++)
+					x[integrated[j]] = arcTable->nodeFromId(integrated[j])->rkApprox(k, rkStep);
+
+				if(moieties)
+					for(int j = 0; j < numIntegrated; j++){
+						int n = integrated[j];
+						c[n] = scale[n] != 0 ? x[n] / scale[n] : arcTable->nodeFromId(n)->getRungeKuttaSolution()->back();
+					}
+				for(int l = 0; l < conservation.getLawCount(); l++)
+					x[conservation.getNode(l)] = scale[conservation.getNode(l)] * conservation.reconstruct(l, &c[0]);
+
+				//the effects of every interaction in the graph
+				if(team)
+					team->evaluate(&x[0], &dx[0]);
+				else
+					rates->evaluate(&x[0], &dx[0]);
+
+				for(int j = 0; j < numIntegrated; j++)
+					arcTable->nodeFromId(integrated[j])->updateRkVal(k, dx[integrated[j]]);
+			}
 
-	//get a random number between 0 and the total propensity
-	randompick = r.rand(total);
+			//after the four rkVals are calcualted for all molecules, the next point can be computed
+			for(int j = 0; j < numIntegrated; j++){
+				Molecule* m = arcTable->nodeFromId(integrated[j]);
+				m->nextPoint(rkStep);
+				c[integrated[j]] = m->getRungeKuttaSolution()->back();
+			}
+			for(int l = 0; l < conservation.getLawCount(); l++)
+				arcTable->nodeFromId(conservation.getNode(l))->addPoint(conservation.reconstruct(l, &c[0]));
+			step++;
+		}
 
-	t.trace("stoch", "time to next reaction is: %f\n", elapsedTime);
-	t.trace("stoch", "total propensity is %f\n", total);
-	t.trace("stoch", "rand: %f\n", randompick);
+		if(cycles <= 0)
+			continue;
 
-	//use this random number to pick an interaction from the propensity list
-	float current = 0.0;
+		for(int n = 0; n < numNodes; n++)
+			x[n] = arcTable->nodeFromId(n)->getRungeKuttaSolution()->back();
 
+		if(detector.observe(step, &x[0])){
+			int period = (int)(detector.getPeriod() + .5);
+			t.trace("rk","Limit cycle of period %f found after %d of %d steps\n", detector.getPeriod() * rkStep, step, steps);
 
-	int flag = 0;
-	for(int i = 0; i < Propensities.size(); i++)
-	{
+			for(; step < steps; step++)
+				for(int n = 0; n < numNodes; n++)
+					arcTable->nodeFromId(n)->repeat(period);
+			break;
+		}
+	}
 
-		float rate = (*interactions)[Propensities[i]]->getRate();
-		int numMols = (*molecules)[derivs->source(Propensities[i])]->stoch_numMols;
+	delete team;
 
-		//add the interactions propensity to a running total
-		current += (rate*numMols);
-		t.trace("stoch", "%d - rate = %f mols = %d total= %f runningtotal=%f\n", i, rate, numMols, rate * numMols,current);
+	//the solutions of the parts integrated, for the networks which share them
+	for(unsigned int p = 0; p < parts.size(); p++){
+		vector<float> points;
+		for(unsigned int j = 0; j < parts[p].size(); j++){
+			vector<float>* solution = arcTable->nodeFromId(parts[p][j])->getRungeKuttaSolution();
+			points.insert(points.end(), solution->end() - steps, solution->end());
+		}
+		components->store(keys[p], points);
+	}
 
-		//if the current running total overcomes the random number, we have our interaction
-		if( current > randompick && flag == 0){
-	
-			flag = 1;
-			
-			char buf[10];
-			memset(buf, '\0', 10);
-			strncpy(buf,(*interactions)[Propensities[i]]->name,  strlen((*interactions)[Propensities[i]]->name));
+	evaluated = 1;
 
-			t.trace("stoch","reaction %d selected (%s)\n", i, buf);
+	//test output, display the values calculated by runge kutta for each molecule to stdout
+	//for(SmartDigraph::NodeIt it(*derivs); it != INVALID; ++it){
+	//	(*molecules)[it]->outputRK();	
+	//}
+}
 
-			//ignore interactions with no coded effect
-			// TODO: probably a better way to do this but it works for now 
-			if( !strcmp(buf, "tsln") + !strcmp(buf, "txn") + !strcmp(buf, "deg") + !strcmp(buf, "f_ptm") + !strcmp(buf, "r_ptm") == 0){
-				t.trace("error", "The interaction class picked by the gillespie algorithm has no implemented effect (%s)\n", buf);
-			}
+/**
+ * int DerivGraph::findComponents(ComponentCache*, float, int, const vector<float>&, const vector<float>&, vector<int>&, vector<string>&, vector< vector<int> >&)
+ *
+ * Split the network into its weakly connected components, by union-find over the arcs, leaving out the null node
+ * every degradation leads to, and look up the solution of each in the cache (see ComponentCache). The solutions found
+ * are added to the molecules of their components, which are then left out of the integration.
+ *
+ * @param components the cache
+ * @param rkStep the timestep
+ * @param steps the number of timesteps
+ * @param initial the concentration of every node at the start, by node id
+ * @param scale the factor the concentration of every node is multiplied by before the rate laws see it, by node id
+ * @param active set to 0 for the nodes of the components found
+ * @param keys filled with the key of every component not found
+ * @param parts filled with the nodes of every component not found, in the order of their points in its solution
+ *
+ * @return the number of components found
+ */
+int DerivGraph::findComponents(ComponentCache* components, float rkStep, int steps, const vector<float>& initial, const vector<float>& scale, vector<int>& active, vector<string>& keys, vector< vector<int> >& parts){
+
+	//the nodes joined by the arcs, in either direction
+	SmartDigraph::NodeMap<int> index(*derivs);
+	UnionFind<SmartDigraph::NodeMap<int> > sets(index);
+	for(SmartDigraph::NodeIt n(*derivs); n != INVALID; ++n)
+		if(n != nullnode)
+			sets.insert(n);
+	for(SmartDigraph::ArcIt a(*derivs); a != INVALID; ++a)
+		if(derivs->source(a) != nullnode && derivs->target(a) != nullnode)
+			sets.join(derivs->source(a), derivs->target(a));
+
+	//the members of each component in id order, the components in the order of their first member
+	vector<int> component(arcTable->getNodeCount(), -1);
+	vector< vector<int> > members;
+	for(int n = 0; n < arcTable->getNodeCount(); n++){
+		SmartDigraph::Node node = derivs->nodeFromId(n);
+		if(node == nullnode)
+			continue;
+		int root = sets.find(node);
+		if(component[root] < 0){
+			component[root] = members.size();
+			members.push_back(vector<int>());
+		}
+		members[component[root]].push_back(n);
+	}
+	int count = members.size();
+
+	vector<int> local(arcTable->getNodeCount(), -1);
+	vector<float> points;
+	int found = 0;
+
+	for(int p = 0; p < count; p++){
+
+		//the run, then the molecules of the component and its reactions, with the nodes numbered within it
+		string key;
+		key.append((const char*)&rkStep, sizeof(rkStep));
+		key.append((const char*)&steps, sizeof(steps));
+		for(unsigned int j = 0; j < members[p].size(); j++){
+			int n = members[p][j];
+			local[n] = j;
+			key.append((const char*)&arcTable->nodeFromId(n)->kind, sizeof(int));
+			key.append((const char*)&initial[n], sizeof(float));
+			key.append((const char*)&scale[n], sizeof(float));
+		}
+		kinetics->getSignature(local, key);
+		for(unsigned int j = 0; j < members[p].size(); j++)
+			local[members[p][j]] = -1;
 
-			// translation
-			if (strcmp(buf, "tsln")){
+		if(!components->find(key, points)){
+			keys.push_back(key);
+			parts.push_back(members[p]);
+			continue;
+		}
 
-				//update the numbers of molecules
-				(*molecules)[derivs->source(Propensities[i])]->stoch_numMols -= 1;
-				(*molecules)[derivs->target(Propensities[i])]->stoch_numMols += 1; 
+		for(unsigned int j = 0; j < members[p].size(); j++){
+			Molecule* m = arcTable->nodeFromId(members[p][j]);
+			for(int s = 0; s < steps; s++)
+				m->addPoint(points[j * steps + s]);
+			active[members[p][j]] = 0;
+		}
+		found++;
+	}
 
-				//update the internal data vectors with the new (stoch_numMols, currentTime) pair
-				(*molecules)[derivs->source(Propensities[i])]->nextPoint( (*molecules)[derivs->source(Propensities[i])]->stoch_numMols, currentTime);
-				(*molecules)[derivs->target(Propensities[i])]->nextPoint( (*molecules)[derivs->target(Propensities[i])]->stoch_numMols, currentTime);
-				
-			}
+	t.trace("components","%d components, %d of them found in the cache\n", count, found);
+	return found;
+}
 
-			// transcription
-			// 	 only the target is affected in transcription
-			if (strcmp(buf, "txn")){
+/**
+ * void DerivGraph::gillespieEvaluate(float, float)
+ *
+ * Simulate the cell using the stochastic model given by the gillespie algorithm (direct method).
+ *
+ * The reactions and rate laws are those compiled for Runge-Kutta (see Kinetics). A concentration c stands for
+ * SSA_SYSTEM_SIZE * c molecules, and the propensity of a reaction is its flux at the current counts, scaled the same
+ * way. Reactions with a negative net flux (promoter binding with kr > kf) occur in reverse.
+ *
+ * The molecule counts are recorded with Molecule::nextPoint(float, float) at every timestep, and stoch_numMols
+ * holds the final counts.
+ *
+ * @param step the timestep between recorded points
+ * @param limit the length of the simulation
+ */
+void DerivGraph::gillespieEvaluate(float step, float limit){
 
-				(*molecules)[derivs->target(Propensities[i])]->stoch_numMols += 1;
+	arcTable->update(*derivs, *molecules, *interactions);
+	kinetics->compile(*arcTable);
+	int numNodes = arcTable->getNodeCount();
+	int numReactions = kinetics->getReactionCount();
 
-				(*molecules)[derivs->target(Propensities[i])]->nextPoint( (*molecules)[derivs->target(Propensities[i])]->stoch_numMols, currentTime);
-			}
+	//molecule counts, the concentrations the rate laws see, and the flux of every reaction at those concentrations
+	vector<float> count(numNodes), scale(numNodes), x(numNodes), v(numReactions + 1);
 
-			// degradation
-			//   only the source is affected in degradation
-			if (strcmp(buf, "deg")){
+	for(int n = 0; n < numNodes; n++){
+		Molecule* m = arcTable->nodeFromId(n);
+		m->reset();
+		count[n] = floor(m->getInitialValue() * SSA_SYSTEM_SIZE + .5);
 
-				(*molecules)[derivs->source(Propensities[i])]->stoch_numMols -= 1;
+		scale[n] = getStateScale(m) / SSA_SYSTEM_SIZE;
+	}
 
-				(*molecules)[derivs->source(Propensities[i])]->nextPoint( (*molecules)[derivs->source(Propensities[i])]->stoch_numMols, currentTime);
+	double time = 0;
+	int points = 0;
+	int events = 0;
 
-			}
+	while(1){
 
-			// forward ptm
-			if(strcmp(buf, "f_ptm")){
-	
-				(*molecules)[derivs->source(Propensities[i])]->stoch_numMols -= 1;
-				(*molecules)[derivs->target(Propensities[i])]->stoch_numMols += 1;
+		for(int n = 0; n < numNodes; n++)
+			x[n] = count[n] * scale[n];
 
+		kinetics->getFlux(&x[0], &v[0]);
 
-				(*molecules)[derivs->source(Propensities[i])]->nextPoint( (*molecules)[derivs->source(Propensities[i])]->stoch_numMols, currentTime);
-				(*molecules)[derivs->target(Propensities[i])]->nextPoint( (*molecules)[derivs->target(Propensities[i])]->stoch_numMols, currentTime);
-			}
+		double total = 0;
+		for(int k = 0; k < numReactions; k++)
+			total += fabs(v[k]);
+		total *= SSA_SYSTEM_SIZE;
 
+		//time to the next reaction, exponentially distributed. Nothing happens any more if no reaction can occur
+		double next = limit;
+		if(total > 0)
+			next = time - log(r.randDblExc()) / total;
 
-			//reverse ptm
-			if(strcmp(buf, "r_ptm")){
+		//the counts hold until then
+		for(; points * step <= next && points * step <= limit; points++)
+			for(int n = 0; n < numNodes; n++)
+				arcTable->nodeFromId(n)->nextPoint(count[n], points * step);
 
-				(*molecules)[derivs->source(Propensities[i])]->stoch_numMols -= 1;
-				(*molecules)[derivs->target(Propensities[i])]->stoch_numMols += 1;
+		if(next >= limit)
+			break;
 
+		if(++events > SSA_MAX_EVENTS){
+			t.trace("error","Gillespie simulation stopped after %d reactions at time %f\n", SSA_MAX_EVENTS, next);
+			break;
+		}
 
-				(*molecules)[derivs->source(Propensities[i])]->nextPoint( (*molecules)[derivs->source(Propensities[i])]->stoch_numMols, currentTime);
-				(*molecules)[derivs->target(Propensities[i])]->nextPoint( (*molecules)[derivs->target(Propensities[i])]->stoch_numMols, currentTime);
+		//pick a reaction with probability proportional to its propensity
+		double pick = r.rand(total / SSA_SYSTEM_SIZE);
+		int chosen = numReactions - 1;
+		for(int k = 0; k < numReactions; k++){
+			pick -= fabs(v[k]);
+			if(pick <= 0){
+				chosen = k;
+				break;
 			}
-
-
 		}
-	}
-	
-	
-	//reset the vector	
-	total = 0;
-	Propensities.clear();
 
-	t.trace("stoch","\n");
+		kinetics->fire(chosen, v[chosen] < 0 ? -1 : 1, &count[0]);
+		for(int n = 0; n < numNodes; n++)
+			if(count[n] < 0)
+				count[n] = 0;
+
+		t.trace("stoch","reaction %d at time %f, total propensity %f\n", chosen, next, total);
+		time = next;
 	}
 
+	for(int n = 0; n < numNodes; n++)
+		arcTable->nodeFromId(n)->stoch_numMols = (int)count[n];
 }
 
 /**
- * float DerivGraph::getEffect(ListDigraph::Node, ListDigraph::Arc)
+ * void DerivGraph::compile(vector<float>&, vector<float>&)
  *
- * Get the effect that a particular interaction will have on another node.
+ * Bring the arc table and the reactions up to date with the network.
  *
+ * @param initial filled with the initial concentration of every node, by node id
+ * @param scale filled with the factor the concentration of every node is multiplied by before the rate laws see it
+ */
+void DerivGraph::compile(vector<float>& initial, vector<float>& scale){
+
+	arcTable->update(*derivs, *molecules, *interactions);
+	kinetics->compile(*arcTable);
+	int numNodes = arcTable->getNodeCount();
+
+	initial.resize(numNodes);
+	scale.resize(numNodes);
+	for(int n = 0; n < numNodes; n++){
+		Molecule* m = arcTable->nodeFromId(n);
+		initial[n] = m->getInitialValue();
+		scale[n] = getStateScale(m);
+	}
+}
+
+/**
+ * void DerivGraph::sensitivityEvaluate(Molecule*, float, float)
  *
- * The effect of an Interaction is defined by the Interaction::getEffect method.
- * The result of this method will be a positive or negative change in concentration.
- *
- * @param m The Node containing the Molecule being affected
- * @param i The Arc containing the Interaction taking place
- * @param rkIteration The current iteration of the Runge-Kutta algorithm
- * @param rkStep The timestep advanced by Runge-Kutta
- *
- * @return  the effect a particular Arc (Interaction) will have on a Node (Molecule)
+ * Rank the rates of the network by how much they affect the oscillation amplitude of a molecule (see Sensitivity).
+ * The relative sensitivity of every arc is kept in rateSensitivity, where the rate mutations use it to choose which
+ * rate to change. Both arcs of a complexation pair get the sensitivity of their shared reaction.
  *
+ * @param target the molecule whose amplitude is analysed, normally the best scoring one
+ * @param step the Runge-Kutta timestep
+ * @param limit the length of the run
  */
-float DerivGraph::getEffect(ListDigraph::Node m, ListDigraph::Arc i, int rkIteration, float rkStep){
+void DerivGraph::sensitivityEvaluate(Molecule* target, float step, float limit){
 
-	//get the effect the chosen interaction will have on the chosen molecule
-	return (*interactions)[i]->getEffect(derivs, molecules, interactions, m, rkIteration, rkStep);
+	//the sensitivities are up to date with the network (it may be shared with cells analysed earlier)
+	if(analysed)
+		return;
 
+	vector<float> initial, scale;
+	compile(initial, scale);
+
+	Sensitivity sensitivity;
+	sensitivity.evaluate(*kinetics, initial, scale, target->nodeID, step, limit);
+
+	rateSensitivity.assign(arcTable->getArcCount(), 0);
+	for(int p = 0; p < kinetics->getReactionCount(); p++){
+		float s = sensitivity.get(p);
+		rateSensitivity[kinetics->getReactionArc(p)] += s;
+		if(kinetics->getReactionPair(p) >= 0)
+			rateSensitivity[kinetics->getReactionPair(p)] += s;
+	}
+
+	t.trace("sens","%s amplitude %f\n", target->getShortName(), sensitivity.getAmplitude());
+	for(int id = 0; id < arcTable->getArcCount(); id++){
+		ArcRecord& a = arcTable->arcFromId(id);
+		t.trace("sens","%s -> %s %s rate %f: %f\n", a.sourceMol->getShortName(), a.targetMol->getShortName(), a.interaction->getName(), a.interaction->getRate(), rateSensitivity[id]);
+	}
+
+	analysed = 1;
 }
 
 /**
- * ListDigraph::Node DerivGraph::add(Molecule*)
+ * SmartDigraph::Node DerivGraph::add(Molecule*)
  *
- * Add a molecule to the ListDigraph and set up the NodeMaps for the new Molecule.
+ * Add a molecule to the SmartDigraph and set up the NodeMaps for the new Molecule.
  *
  * @param newMolecule The new molecule being added.
  *
- * @return the Node object in the ListDigraph containing the new Molecule.
+ * @return the Node object in the SmartDigraph containing the new Molecule.
  */
-ListDigraph::Node DerivGraph::add(Molecule * newMolecule){
+SmartDigraph::Node DerivGraph::add(Molecule * newMolecule){
 
 	//add a new Node to the graph
-	ListDigraph::Node newNode = derivs->addNode();
+	SmartDigraph::Node newNode = derivs->addNode();
 	
 	//map the new Node to the Molecule 
 	(*molecules)[newNode] = newMolecule;
@@ -479,20 +918,20 @@ ListDigraph::Node DerivGraph::add(Molecule * newMolecule){
 }
 
 /**
- * ListDigraph::Arc DerivGraph::add(Interaction*, ListDigraph::Node, ListDigraph::Node)
+ * SmartDigraph::Arc DerivGraph::add(Interaction*, SmartDigraph::Node, SmartDigraph::Node)
  *
- * Add a new Interaction to the ListDigraph, between the two supplied Nodes
+ * Add a new Interaction to the SmartDigraph, between the two supplied Nodes
  * 
  * @param newInteraction The new Interaction being added
  * @param from The source node for the new Interaction
  * @param to The target Node for the new Interaction
  *
- * @return the Arc object in the ListDigraph containing the new Interaction.
+ * @return the Arc object in the SmartDigraph containing the new Interaction.
  */
-ListDigraph::Arc DerivGraph::add(Interaction * newInteraction, ListDigraph::Node from, ListDigraph::Node to){
+SmartDigraph::Arc DerivGraph::add(Interaction * newInteraction, SmartDigraph::Node from, SmartDigraph::Node to){
 
 	//add a new arc to the graph
-	ListDigraph::Arc newArc = derivs->addArc(from, to);
+	SmartDigraph::Arc newArc = derivs->addArc(from, to);
 	
 	//map the new Arc to the Interaction 
 	(*interactions)[newArc] = newInteraction;
@@ -506,6 +945,35 @@ ListDigraph::Arc DerivGraph::add(Interaction * newInteraction, ListDigraph::Node
 	return newArc;
 }
 
+/**
+ * int DerivGraph::isLimited(int)
+ *
+ * Check whether a mutation would stop at one of its limit checks, before drawing any random numbers or changing the
+ * network. Such a mutation can be skipped without copying a shared DerivGraph.
+ *
+ * @param type the MutationType
+ *
+ * @return 1 if the mutation would leave the DerivGraph unchanged, 0 otherwise
+ */
+int DerivGraph::isLimited(int type){
+
+	switch(type){
+	case MUT_NULL:
+		return 1;
+	case MUT_REVERSE_RATE:
+		return ReverseComplexationList->size() + ReversePTMList->size() < 1;
+	case MUT_NEW_PTM:
+		return (int)PTMList->size() >= maxPTM;
+	case MUT_NEW_COMPLEX:
+		return (int)ComplexList->size() >= maxComp || ProteinList->size() + ComplexList->size() < 2;
+	case MUT_NEW_BASIC:
+		return (int)DNAList->size() >= maxBasic;
+	case MUT_NEW_PROMOTER:
+		return (int)PromoterBindList->size() >= maxProm;
+	}
+	return 0;
+}
+
 /**
  * DerivGraph::newBasic()
  *
@@ -528,15 +996,16 @@ void DerivGraph::newBasic(){
 		return;
 	}
 	//create a new DNA, MRNA, and Protein
-	ListDigraph::Node d = add(new DNA());
-	ListDigraph::Node m = add(new mRNA());
-	ListDigraph::Node p = add(new Protein());
+	SmartDigraph::Node d = add(new (*arena) DNA());
+	SmartDigraph::Node m = add(new (*arena) mRNA());
+	SmartDigraph::Node p = add(new (*arena) Protein());
+	((DNA*)(*molecules)[d])->hill = hill;
 
 	//create the interactions between the newly created basic system
-	ListDigraph::Arc txn = add(new Transcription(), d, m);
-	ListDigraph::Arc tsln = add(new Translation(), m, p);
-	ListDigraph::Arc mdeg = add(new Degradation(), m, nullnode);
-	ListDigraph::Arc pdeg = add(new Degradation(), p, nullnode);
+	SmartDigraph::Arc txn = add(new (*arena) Transcription(), d, m);
+	SmartDigraph::Arc tsln = add(new (*arena) Translation(), m, p);
+	SmartDigraph::Arc mdeg = add(new (*arena) Degradation(), m, nullnode);
+	SmartDigraph::Arc pdeg = add(new (*arena) Degradation(), p, nullnode);
 	
 	
 	//give the DNA the next unique ID, and assign the same ID to the rest of the system
@@ -575,6 +1044,53 @@ void DerivGraph::newBasic(){
 
 }
 
+/**
+ * int DerivGraph::pickRate(const vector<int>&)
+ *
+ * Choose the interaction whose rate a rate mutation changes. Without sensitivities every candidate is equally likely,
+ * otherwise a candidate is chosen with probability proportional to GUIDED_RATE_FLOOR plus the magnitude of its
+ * sensitivity, so rates with no known effect can still be chosen.
+ *
+ * @param arcs the arc ids of the candidates
+ *
+ * @return the index of the chosen candidate in arcs
+ */
+int DerivGraph::pickRate(const vector<int>& arcs){
+
+	if(rateSensitivity.empty())
+		return r.randInt(arcs.size() - 1);
+
+	vector<double> weight(arcs.size());
+	double total = 0;
+	for(unsigned int i = 0; i < arcs.size(); i++){
+		weight[i] = GUIDED_RATE_FLOOR;
+		//arcs added since the last analysis have no sensitivity yet
+		if(arcs[i] < (int)rateSensitivity.size())
+			weight[i] += fabs(rateSensitivity[arcs[i]]);
+		total += weight[i];
+	}
+
+	double pick = r.rand(total);
+	for(unsigned int i = 0; i < arcs.size(); i++){
+		pick -= weight[i];
+		if(pick <= 0)
+			return i;
+	}
+	return arcs.size() - 1;
+}
+
+/**
+ * static void appendArcs(vector<int>&, const vector<T*>*)
+ *
+ * Add the arc ids of the interactions of a type list to a list of rate mutation candidates.
+ */
+template <class T>
+static void appendArcs(vector<int>& arcs, const vector<T*>* list){
+
+	for(unsigned int i = 0; i < list->size(); i++)
+		arcs.push_back(((Interaction*)(*list)[i])->arcID);
+}
+
 /**
  * void DerivGraph::forwardRateChange()
  *
@@ -591,7 +1107,7 @@ void DerivGraph::newBasic(){
  * Implicitly: [0 1 2 3|0 1 2|0 1] (totalSize = 9)
  *(subscripts)  0 1 2 3 4 5 6 7 8
  *
- * 1. Select random number between 0 and totalSize-1
+ * 1. Select random number between 0 and totalSize-1 (see pickRate)
  *
  * 2. Is number >= 0 and < Arr1.size? 
  *     (yes) Select Arr1[number]
@@ -622,8 +1138,13 @@ void DerivGraph::forwardRateChange(){
 	int complexInteractionPairID = 0;
 
 	
-	//select a random integer between 0 and the total number of forward interactions
-	unsigned int randIndex = r.randInt(totalSize - 1);
+	vector<int> arcs;
+	appendArcs(arcs, TranslationList);
+	appendArcs(arcs, ForwardComplexationList);
+	appendArcs(arcs, ForwardPTMList);
+
+	//select an integer between 0 and the total number of forward interactions
+	unsigned int randIndex = pickRate(arcs);
 	t.trace("mutate","randIndex = %d\n", randIndex);
 
 	//index falls within the TranslationList
@@ -647,7 +1168,7 @@ void DerivGraph::forwardRateChange(){
 	}
 		
 	//get the arc which holds the interaction
-	ListDigraph::Arc selectedArc= derivs->arcFromId(selectedInteraction->arcID);
+	SmartDigraph::Arc selectedArc= derivs->arcFromId(selectedInteraction->arcID);
 
 	Molecule* source = (*molecules)[derivs->source(selectedArc)];
 	Molecule* target = (*molecules)[derivs->target(selectedArc)];
@@ -696,8 +1217,12 @@ void DerivGraph::reverseRateChange(){
 
 	int complexInteractionPairID = 0;
 
-	//get a random number between 1 and the total number of reverse reactions
-	unsigned int randIndex = r.randInt(totalSize - 1);
+	vector<int> arcs;
+	appendArcs(arcs, ReverseComplexationList);
+	appendArcs(arcs, ReversePTMList);
+
+	//get a number between 0 and the total number of reverse reactions
+	unsigned int randIndex = pickRate(arcs);
 	t.trace("mutate","randIndex = %d\n", randIndex);
 
 	//if the index falls within the ReverseComplexationList	
@@ -715,7 +1240,7 @@ void DerivGraph::reverseRateChange(){
 	}
 	
 	//get the Arc holding the interaction
-	ListDigraph::Arc selectedArc= derivs->arcFromId(selectedInteraction->arcID);
+	SmartDigraph::Arc selectedArc= derivs->arcFromId(selectedInteraction->arcID);
 	//get the source and target molecules
 	Molecule* source = (*molecules)[derivs->source(selectedArc)];
 	Molecule* target = (*molecules)[derivs->target(selectedArc)];
@@ -744,12 +1269,15 @@ void DerivGraph::reverseRateChange(){
  */
 void DerivGraph::degradationRateChange(){
 	
-	int selectedIndex = r.randInt(DegradationList->size()-1);
+	vector<int> arcs;
+	appendArcs(arcs, DegradationList);
+
+	int selectedIndex = pickRate(arcs);
 	float newRate = minKineticRate + r.rand(maxKineticRate - minKineticRate);
 
 	Interaction* selectedInteraction = (*DegradationList)[selectedIndex];
 
-	ListDigraph::Arc selectedArc= derivs->arcFromId(selectedInteraction->arcID);
+	SmartDigraph::Arc selectedArc= derivs->arcFromId(selectedInteraction->arcID);
 
 	Molecule* source = (*molecules)[derivs->source(selectedArc)];
 	Molecule* target = (*molecules)[derivs->target(selectedArc)];
@@ -827,11 +1355,11 @@ void DerivGraph::newPTM(){
 	}
 
 
-	ListDigraph::Node selectedNode = derivs->nodeFromId(selectedMolecule->nodeID);
+	SmartDigraph::Node selectedNode = derivs->nodeFromId(selectedMolecule->nodeID);
 	
-	ListDigraph::Node newPTM;
+	SmartDigraph::Node newPTM;
 	
-	newPTM = add(new PTMProtein());
+	newPTM = add(new (*arena) PTMProtein());
 	
 	//copy the ptm counts to the new PTMProtein
 	for(int i = 0; i< 4; i++)
@@ -845,9 +1373,9 @@ void DerivGraph::newPTM(){
 	
 	((PTMProtein*)(*molecules)[newPTM])->addRandPTM(r.randInt(3));
 	
-	ListDigraph::Arc PTM_f = add(new ForwardPTM(), selectedNode, newPTM);
-	ListDigraph::Arc PTM_r = add(new ReversePTM(), newPTM, selectedNode);
-	ListDigraph::Arc PTM_d = add(new Degradation(), newPTM, nullnode);
+	SmartDigraph::Arc PTM_f = add(new (*arena) ForwardPTM(), selectedNode, newPTM);
+	SmartDigraph::Arc PTM_r = add(new (*arena) ReversePTM(), newPTM, selectedNode);
+	SmartDigraph::Arc PTM_d = add(new (*arena) Degradation(), newPTM, nullnode);
 
 	DegradationList->push_back( (Degradation*) (*interactions)[PTM_d]);
 	ForwardPTMList->push_back( (ForwardPTM*) (*interactions)[PTM_f]);
@@ -931,8 +1459,8 @@ void DerivGraph::newComplex(){
 	int id1 = p1->nodeID;
 	int id2 = p2->nodeID;
 	//get the Node references from the nodeIDS
-	ListDigraph::Node n1 = derivs->nodeFromId(id1);
-	ListDigraph::Node n2 = derivs->nodeFromId(id2);
+	SmartDigraph::Node n1 = derivs->nodeFromId(id1);
+	SmartDigraph::Node n2 = derivs->nodeFromId(id2);
 
 
 	int a = 0;
@@ -951,7 +1479,7 @@ void DerivGraph::newComplex(){
 
 
 	// add the new complex. Pass in the nodeIDs to the constructor, so it has a reference of its constituent molecules
-	ListDigraph::Node comp = add(new Complex(id1, id2));
+	SmartDigraph::Node comp = add(new (*arena) Complex(id1, id2));
 	(*molecules)[comp]->setID(count++);
 
 	//create rates for the forward and reverse interactions
@@ -959,8 +1487,8 @@ void DerivGraph::newComplex(){
         float k_rev = minKineticRate + r.rand(maxKineticRate - minKineticRate);
 
 	//create the pair forward complexation interactions
-	ListDigraph::Arc f1 = add(new ForwardComplexation(), n1, comp); 
-	ListDigraph::Arc f2 = add(new ForwardComplexation(), n2, comp); 
+	SmartDigraph::Arc f1 = add(new (*arena) ForwardComplexation(), n1, comp); 
+	SmartDigraph::Arc f2 = add(new (*arena) ForwardComplexation(), n2, comp); 
 
 	//set the same rate for the forward interactions
         (*interactions)[f1]->setRate(k_fwd);
@@ -975,8 +1503,8 @@ void DerivGraph::newComplex(){
 	t.trace("mutate","f1 pair arc: %d, f2 pair arc: %d\n", ((ForwardComplexation*)(*interactions)[f1])->pairArcID, ((ForwardComplexation*)(*interactions)[f2])->pairArcID);
 
 	//create the pair of reverse complexation interactions
-	ListDigraph::Arc r1 = add(new ReverseComplexation(), comp, n1); 
-	ListDigraph::Arc r2 = add(new ReverseComplexation(), comp, n2); 
+	SmartDigraph::Arc r1 = add(new (*arena) ReverseComplexation(), comp, n1); 
+	SmartDigraph::Arc r2 = add(new (*arena) ReverseComplexation(), comp, n2); 
 
 	//set the same rate for the reverse interactions
         (*interactions)[r1]->setRate(k_rev);
@@ -991,7 +1519,7 @@ void DerivGraph::newComplex(){
 	t.trace("mutate","r1 pair arc: %d, r2 pair arc: %d\n", ((ReverseComplexation*)(*interactions)[r1])->pairArcID, ((ReverseComplexation*)(*interactions)[r2])->pairArcID);
 
 	
-	ListDigraph::Arc deg = add(new Degradation(), comp, nullnode);	
+	SmartDigraph::Arc deg = add(new (*arena) Degradation(), comp, nullnode);	
 
 	ComplexList->push_back( (Complex*) (*molecules)[comp]);
 	MoleculeList->push_back((*molecules)[comp]);
@@ -1056,8 +1584,8 @@ void DerivGraph::newPromoter(){
 
 	}	
 	
-	ListDigraph::Node dnaNode = derivs->nodeFromId(dnaMolecule->nodeID);
-	ListDigraph::Node repressionNode = derivs->nodeFromId(repressionMolecule->nodeID);
+	SmartDigraph::Node dnaNode = derivs->nodeFromId(dnaMolecule->nodeID);
+	SmartDigraph::Node repressionNode = derivs->nodeFromId(repressionMolecule->nodeID);
 	
 	float fwd = 0;
 	float rev = 1;
@@ -1071,7 +1599,7 @@ void DerivGraph::newPromoter(){
 	t.trace("mutate","gene: %s protein: %s kf: %f kr: %f\n",dnaMolecule->getShortName(),repressionMolecule->getShortName(), fwd, rev);
 
 	//create a new promoter binding interaction from the repressor to the DNA
-	ListDigraph::Arc a = add(new PromoterBind(fwd, rev), repressionNode, dnaNode);
+	SmartDigraph::Arc a = add(new (*arena) PromoterBind(fwd, rev), repressionNode, dnaNode);
 	
 	//update the DNA with the arcID of its promoter interaction
 	dnaMolecule->promoterId = derivs->id(a);
@@ -1084,7 +1612,15 @@ void DerivGraph::newPromoter(){
 
 }
 
-Molecule* DerivGraph::getBestMolecule(int CellID){
+/**
+ * Molecule* DerivGraph::getBestMolecule(int, int)
+ *
+ * @param CellID the cell holding the network, for tracing
+ * @param method one of SCORE_COUNT or SCORE_FFT
+ *
+ * @return the molecule with the highest score
+ */
+Molecule* DerivGraph::getBestMolecule(int CellID, int method){
 
 
 	//rungeKuttaEvaluate(rkTimeStep, rkTimeLimit);
@@ -1095,7 +1631,7 @@ Molecule* DerivGraph::getBestMolecule(int CellID){
 
 
 	for(unsigned int i =  0; i < MoleculeList->size(); i++){
-		s = (*MoleculeList)[i]->getScore();
+		s = getMoleculeScore((*MoleculeList)[i], method);
 		if(s > maxScore){
 			maxScore = s;
 			bestMolecule = (*MoleculeList)[i];
@@ -1106,6 +1642,138 @@ Molecule* DerivGraph::getBestMolecule(int CellID){
 	return bestMolecule;
 }
 
+/**
+ * int DerivGraph::getMoleculeScore(Molecule*, int)
+ *
+ * Score the oscillation of a molecule in the Runge-Kutta solution, either by its count of direction changes
+ * (Molecule::getScore) or by its autocorrelation (see Spectrum).
+ *
+ * @param m the molecule
+ * @param method one of SCORE_COUNT or SCORE_FFT
+ *
+ * @return the score of the molecule
+ */
+int DerivGraph::getMoleculeScore(Molecule* m, int method){
+
+	if(method != SCORE_FFT)
+		return m->getScore();
+
+	spectralEvaluate();
+
+	//molecules added since the last evaluation have no solution yet
+	if(m->nodeID >= (int)oscillations.size())
+		return 0;
+	return oscillations[m->nodeID].score;
+}
+
+/**
+ * void DerivGraph::spectralEvaluate()
+ *
+ * Measure the oscillation of every molecule in the Runge-Kutta solution, in one batch. The network has to be
+ * evaluated first.
+ */
+void DerivGraph::spectralEvaluate(){
+
+	//the measurements are up to date with the solution (it may be shared with cells scored earlier)
+	if(measured)
+		return;
+
+	vector<vector<float>*> trajectories(arcTable->getNodeCount());
+	for(int n = 0; n < arcTable->getNodeCount(); n++)
+		trajectories[n] = arcTable->nodeFromId(n)->getRungeKuttaSolution();
+
+	Spectrum spectrum;
+	spectrum.analyse(trajectories, rkTimeStep, oscillations);
+
+	for(int n = 0; n < arcTable->getNodeCount(); n++){
+		Oscillation& o = oscillations[n];
+		t.trace("score","%s period %f amplitude %f regularity %f damping %f score %d\n", arcTable->nodeFromId(n)->getShortName(), o.period, o.amplitude, o.regularity, o.damping, o.score);
+	}
+
+	measured = 1;
+}
+
+/**
+ * int DerivGraph::hasFeedback()
+ *
+ * Check whether the network can oscillate at all. The only interaction which slows the production of a molecule is
+ * the repression of a DNA by its promoter, so an oscillation needs a loop of interactions through a promoter binding:
+ * the repressor has to be made, directly or through complexes and modifications, from the DNA it represses. That is,
+ * the repressor and the DNA are in the same strongly connected component of the graph.
+ *
+ * @return 1 if some promoter binding is part of a loop, 0 if the network has no feedback
+ */
+int DerivGraph::hasFeedback(){
+
+	//the result is up to date with the network (it may be shared with cells screened earlier)
+	if(screened)
+		return feedback;
+
+	SmartDigraph::NodeMap<int> component(*derivs);
+	stronglyConnectedComponents(*derivs, component);
+
+	feedback = 0;
+	for(SmartDigraph::ArcIt a(*derivs); a != INVALID && !feedback; ++a)
+		if((*interactions)[a]->kind == IK_PROMOTER_BIND && component[derivs->source(a)] == component[derivs->target(a)])
+			feedback = 1;
+
+	t.trace("score","DerivGraph %p %s a feedback loop\n", this, feedback ? "has" : "does not have");
+
+	screened = 1;
+	return feedback;
+}
+
+/**
+ * int DerivGraph::isStable()
+ *
+ * Check whether the network settles to a steady state, without integrating it (see SteadyState). Networks whose
+ * steady state could not be found, or whose Jacobian has an eigenvalue on or right of the imaginary axis, may
+ * oscillate. This looks only at the steady state reached from the initial concentrations, so a limit cycle around a
+ * second steady state is missed.
+ *
+ * @return 1 if the steady state was found and is stable, 0 otherwise
+ */
+int DerivGraph::isStable(){
+
+	//the result is up to date with the network (it may be shared with cells screened earlier)
+	if(linearised)
+		return stable;
+
+	vector<float> initial, scale;
+	compile(initial, scale);
+
+	SteadyState steady;
+	if(steady.solve(*kinetics, initial, scale)){
+		stable = steady.isStable();
+		t.trace("score","DerivGraph %p steady state is %s, spectral abscissa %g\n", this, stable ? "stable" : "unstable", steady.getAbscissa());
+	}
+	else{
+		stable = 0;
+		t.trace("score","DerivGraph %p has no steady state\n", this);
+	}
+
+	linearised = 1;
+	return stable;
+}
+
+/**
+ * int DerivGraph::getNodeCount()
+ *
+ * @return the number of Nodes (molecules) in the graph, including the null node
+ */
+int DerivGraph::getNodeCount(){
+	return countNodes(*derivs);
+}
+
+/**
+ * int DerivGraph::getArcCount()
+ *
+ * @return the number of Arcs (interactions) in the graph
+ */
+int DerivGraph::getArcCount(){
+	return countArcs(*derivs);
+}
+
 /**
  * void DerivGraph::outputDotImage(int, int)
  *
@@ -1140,7 +1808,7 @@ void DerivGraph::outputDotImage(const char* prefix, int pid, int cellNum, int ge
 	fflush(dot);
 
 	//iterate all of the Arcs and add them to the visualization. Nodes are implicitly defined by the source and target of the interactions.
-	for(ListDigraph::ArcIt it(*derivs); it != INVALID; ++it){
+	for(SmartDigraph::ArcIt it(*derivs); it != INVALID; ++it){
 		fprintf(dot, "\"%s (%d)\" -> \"%s (%d)\" [ label = \"%s (%f)\",  penwidth= %f];\n",(*molecules)[derivs->source(it)]->getShortName(),(*molecules)[derivs->source(it)]->getScore(), (*molecules)[derivs->target(it)]->getShortName(),(*molecules)[derivs->target(it)]->getScore(), (*interactions)[it]->getName(), (*interactions)[it]->getRate(), 0.5 + 2*(*interactions)[it]->getRate()/maxKineticRate);
 		fflush(dot);
 }	
@@ -1271,7 +1939,7 @@ void DerivGraph::outputInteractionCsv(const char* prefix, int pid, int cellNum,
 	char buf[200];
 	sprintf(buf, "%s/%d/cell%d/csv/Cell%dGen%d.csv", prefix, pid, cellNum, cellNum, gen);
 	outFile = fopen(buf, "w");
-	for(ListDigraph::ArcIt it(*derivs); it != INVALID; ++it){
+	for(SmartDigraph::ArcIt it(*derivs); it != INVALID; ++it){
 		fprintf(outFile, "%s, %s, %s, %f\n", (*interactions)[it]->getName(), (*molecules)[derivs->source(it)]->getShortName(), (*molecules)[derivs->target(it)]->getShortName(), (*interactions)[it]->getRate());
 
 	}	
@@ -1279,6 +1947,576 @@ void DerivGraph::outputInteractionCsv(const char* prefix, int pid, int cellNum,
 
 }
 
+/**
+ * Molecule* DerivGraph::newMolecule(int)
+ *
+ * Create an empty molecule of the given kind in the arena, to be filled in by Molecule::load.
+ *
+ * @param kind the MoleculeKind
+ *
+ * @return the new molecule
+ */
+Molecule* DerivGraph::newMolecule(int kind){
+
+	switch(kind){
+	case MK_NULL:
+		return new (*arena) NullNode();
+	case MK_DNA:
+		return new (*arena) DNA();
+	case MK_MRNA:
+		return new (*arena) mRNA();
+	case MK_PROTEIN:
+		return new (*arena) Protein();
+	case MK_COMPLEX:
+		return new (*arena) Complex(-1, -1);
+	case MK_PTM:
+		return new (*arena) PTMProtein();
+	}
+	return new (*arena) Molecule();
+}
+
+/**
+ * Interaction* DerivGraph::newInteraction(int)
+ *
+ * Create an empty interaction of the given kind in the arena, to be filled in by Interaction::load.
+ *
+ * @param kind the InteractionKind
+ *
+ * @return the new interaction
+ */
+Interaction* DerivGraph::newInteraction(int kind){
+
+	switch(kind){
+	case IK_TRANSCRIPTION:
+		return new (*arena) Transcription();
+	case IK_TRANSLATION:
+		return new (*arena) Translation();
+	case IK_DEGRADATION:
+		return new (*arena) Degradation();
+	case IK_FORWARD_COMPLEXATION:
+		return new (*arena) ForwardComplexation();
+	case IK_REVERSE_COMPLEXATION:
+		return new (*arena) ReverseComplexation();
+	case IK_FORWARD_PTM:
+		return new (*arena) ForwardPTM();
+	case IK_REVERSE_PTM:
+		return new (*arena) ReversePTM();
+	case IK_PROMOTER_BIND:
+		return new (*arena) PromoterBind(0, 0);
+	}
+	return new (*arena) Interaction();
+}
+
+/**
+ * void DerivGraph::saveList(Snapshot&, vector<T*>*, int)
+ *
+ * Write one of the type lists as the Node ids (isNode = 1) or Arc ids (isNode = 0) of its members.
+ * The lists are saved explicitly because their order decides which member a random mutation selects.
+ */
+template <class T>
+void DerivGraph::saveList(Snapshot& s, vector<T*>* list, int isNode){
+
+	s.putInt(list->size());
+	for(unsigned int i = 0; i < list->size(); i++)
+		s.putInt(isNode ? ((Molecule*)(*list)[i])->nodeID : ((Interaction*)(*list)[i])->arcID);
+}
+
+/**
+ * void DerivGraph::loadList(Snapshot&, vector<T*>*, int)
+ *
+ * Rebuild a type list written by saveList.
+ */
+template <class T>
+void DerivGraph::loadList(Snapshot& s, vector<T*>* list, int isNode){
+
+	int size = s.getInt();
+	list->clear();
+	for(int i = 0; i < size && !s.failed(); i++){
+		int id = s.getInt();
+		if(isNode)
+			list->push_back( (T*) (*molecules)[derivs->nodeFromId(id)]);
+		else
+			list->push_back( (T*) (*interactions)[derivs->arcFromId(id)]);
+	}
+}
+
+/**
+ * void DerivGraph::save(Snapshot&)
+ *
+ * Serialize the complete network: settings, random generator state, every Node and Arc in id order, the type lists,
+ * the rate sensitivities and the result of the last screen.
+ * Ids are never reused during evolution, so rebuilding the graph in id order reproduces the same Node and Arc ids, and
+ * with them the promoterId and pairArcID cross references.
+ *
+ * @param s the snapshot to append to
+ */
+void DerivGraph::save(Snapshot& s){
+
+	s.putInt(count);
+	s.putInt(maxBasic);
+	s.putInt(maxPTM);
+	s.putInt(maxComp);
+	s.putInt(maxProm);
+	s.putInt(hill);
+	s.putFloat(minKineticRate);
+	s.putFloat(maxKineticRate);
+	s.putFloat(defaultInitialConcentration);
+	s.putFloat(rkTimeStep);
+	s.putFloat(rkTimeLimit);
+
+	s.putRandom(r);
+
+	//molecules
+	s.putInt(derivs->maxNodeId() + 1);
+	for(int id = 0; id <= derivs->maxNodeId(); id++){
+		Molecule* m = (*molecules)[derivs->nodeFromId(id)];
+		s.putInt(m->kind);
+		m->save(s);
+	}
+
+	//interactions
+	s.putInt(derivs->maxArcId() + 1);
+	for(int id = 0; id <= derivs->maxArcId(); id++){
+		SmartDigraph::Arc a = derivs->arcFromId(id);
+		s.putInt((*interactions)[a]->kind);
+		s.putInt(derivs->id(derivs->source(a)));
+		s.putInt(derivs->id(derivs->target(a)));
+		(*interactions)[a]->save(s);
+	}
+
+	saveList(s, MoleculeList, 1);
+	saveList(s, ProteinList, 1);
+	saveList(s, mRNAList, 1);
+	saveList(s, DNAList, 1);
+	saveList(s, ComplexList, 1);
+	saveList(s, PTMList, 1);
+
+	saveList(s, InteractionList, 0);
+	saveList(s, TranscriptionList, 0);
+	saveList(s, TranslationList, 0);
+	saveList(s, DegradationList, 0);
+	saveList(s, ForwardComplexationList, 0);
+	saveList(s, ReverseComplexationList, 0);
+	saveList(s, ForwardPTMList, 0);
+	saveList(s, ReversePTMList, 0);
+	saveList(s, PromoterBindList, 0);
+
+	s.putInt(rateSensitivity.size());
+	for(unsigned int id = 0; id < rateSensitivity.size(); id++)
+		s.putFloat(rateSensitivity[id]);
+
+	//a rejected network scores 0 until it is screened again, which may be generations after a resume
+	s.putInt(rejected);
+}
+
+/**
+ * int DerivGraph::load(Snapshot&)
+ *
+ * Rebuild a network written by DerivGraph::save. The DerivGraph must be newly constructed (holding only the null node).
+ *
+ * @param s the snapshot to read from
+ *
+ * @return 1 on success, 0 if the snapshot was truncated
+ */
+int DerivGraph::load(Snapshot& s){
+
+	count = s.getInt();
+	maxBasic = s.getInt();
+	maxPTM = s.getInt();
+	maxComp = s.getInt();
+	maxProm = s.getInt();
+	hill = s.getInt();
+	minKineticRate = s.getFloat();
+	maxKineticRate = s.getFloat();
+	defaultInitialConcentration = s.getFloat();
+	rkTimeStep = s.getFloat();
+	rkTimeLimit = s.getFloat();
+
+	s.getRandom(r);
+
+	//molecules. Node 0 is the null node created by the constructor
+	int numNodes = s.getInt();
+	for(int id = 0; id < numNodes && !s.failed(); id++){
+
+		int kind = s.getInt();
+		SmartDigraph::Node n;
+
+		if(id == 0)
+			n = nullnode;
+		else{
+			n = derivs->addNode();
+			(*molecules)[n] = newMolecule(kind);
+			(*molecules)[n]->nodeID = derivs->id(n);
+		}
+		(*molecules)[n]->load(s);
+	}
+
+	//interactions. add() is not used, since it would draw a random rate
+	int numArcs = s.getInt();
+	for(int id = 0; id < numArcs && !s.failed(); id++){
+
+		int kind = s.getInt();
+		int from = s.getInt();
+		int to = s.getInt();
+
+		SmartDigraph::Arc a = derivs->addArc(derivs->nodeFromId(from), derivs->nodeFromId(to));
+		(*interactions)[a] = newInteraction(kind);
+		(*interactions)[a]->arcID = derivs->id(a);
+		(*interactions)[a]->load(s);
+	}
+
+	loadList(s, MoleculeList, 1);
+	loadList(s, ProteinList, 1);
+	loadList(s, mRNAList, 1);
+	loadList(s, DNAList, 1);
+	loadList(s, ComplexList, 1);
+	loadList(s, PTMList, 1);
+
+	loadList(s, InteractionList, 0);
+	loadList(s, TranscriptionList, 0);
+	loadList(s, TranslationList, 0);
+	loadList(s, DegradationList, 0);
+	loadList(s, ForwardComplexationList, 0);
+	loadList(s, ReverseComplexationList, 0);
+	loadList(s, ForwardPTMList, 0);
+	loadList(s, ReversePTMList, 0);
+	loadList(s, PromoterBindList, 0);
+
+	int numSensitivities = s.getInt();
+	for(int id = 0; id < numSensitivities && !s.failed(); id++)
+		rateSensitivity.push_back(s.getFloat());
+
+	rejected = s.getInt();
+
+	if(s.failed()){
+		t.trace("error","DerivGraph %p: snapshot is truncated\n", this);
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * void DerivGraph::copySettings(DerivGraph*)
+ *
+ * Copy the mutation limits, kinetic rate bounds, Runge-Kutta parameters, default concentration and hill coefficient
+ * from another DerivGraph.
+ *
+ * @param other the DerivGraph to copy the settings from
+ */
+void DerivGraph::copySettings(DerivGraph* other){
+
+	maxBasic = other->maxBasic;
+	maxPTM = other->maxPTM;
+	maxComp = other->maxComp;
+	maxProm = other->maxProm;
+	hill = other->hill;
+	minKineticRate = other->minKineticRate;
+	maxKineticRate = other->maxKineticRate;
+	rkTimeStep = other->rkTimeStep;
+	rkTimeLimit = other->rkTimeLimit;
+	defaultInitialConcentration = other->defaultInitialConcentration;
+}
+
+// names of the molecule kinds in LGF files, indexed by MoleculeKind
+static const char* lgfKindNames[] = { "molecule", "null", "dna", "mrna", "protein", "complex", "ptm" };
+
+/**
+ * void DerivGraph::outputLgf(const char*, int, int, int)
+ *
+ * Output the network of the cell in LEMON Graph Format, in the same directory as the other per-cell output.
+ *
+ * @param prefix the prefix of the output folder
+ * @param pid the process id used for the output folder
+ * @param cellNum the cell number to put in the filename
+ * @param gen the generation number to put in the filename
+ */
+void DerivGraph::outputLgf(const char* prefix, int pid, int cellNum, int gen){
+
+	char buf[200];
+	sprintf(buf, "%s/%d/cell%d/Cell%dGen%d.lgf", prefix, pid, cellNum, cellNum, gen);
+	exportLgf(buf);
+}
+
+/**
+ * int DerivGraph::exportLgf(const char*)
+ *
+ * Write the network in LEMON Graph Format. Each node has the columns
+ *
+ *   label kind mid conc histone ptm
+ *
+ * (molecule kind name, molecule ID, initial concentration, histone value for DNA, and the PTM counts), and each arc
+ *
+ *   label type rate kf kr pair
+ *
+ * (the Interaction name as printed by the other output methods, its rate, the promoter binding rates, and the
+ * label of the paired complexation arc or -1). Rates are written with full float precision.
+ *
+ * @param file the file to write
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int DerivGraph::exportLgf(const char* file){
+
+	char buf[100];
+
+	SmartDigraph::NodeMap<string> kind(*derivs), mid(*derivs), conc(*derivs), histone(*derivs), ptm(*derivs);
+	SmartDigraph::ArcMap<string> type(*derivs), rate(*derivs), kf(*derivs), kr(*derivs), pair(*derivs);
+
+	for(SmartDigraph::NodeIt it(*derivs); it != INVALID; ++it){
+
+		Molecule* m = (*molecules)[it];
+		kind[it] = lgfKindNames[m->kind];
+
+		sprintf(buf, "%d", m->getID());
+		mid[it] = buf;
+
+		sprintf(buf, "%.9g", m->getInitialValue());
+		conc[it] = buf;
+
+		sprintf(buf, "%.9g", m->kind == MK_DNA ? ((DNA*)m)->getValue() : 1.0);
+		histone[it] = buf;
+
+		sprintf(buf, "%d,%d,%d,%d", m->PTMArray[0], m->PTMArray[1], m->PTMArray[2], m->PTMArray[3]);
+		ptm[it] = buf;
+	}
+
+	for(SmartDigraph::ArcIt it(*derivs); it != INVALID; ++it){
+
+		Interaction* i = (*interactions)[it];
+		type[it] = i->getName();
+
+		sprintf(buf, "%.9g", i->getRate());
+		rate[it] = buf;
+
+		float f = 0, r = 0;
+		int p = -1;
+		if(i->kind == IK_PROMOTER_BIND){
+			f = ((PromoterBind*)i)->kf;
+			r = ((PromoterBind*)i)->kr;
+		}
+		else if(i->kind == IK_FORWARD_COMPLEXATION)
+			p = ((ForwardComplexation*)i)->pairArcID;
+		else if(i->kind == IK_REVERSE_COMPLEXATION)
+			p = ((ReverseComplexation*)i)->pairArcID;
+
+		sprintf(buf, "%.9g", f);
+		kf[it] = buf;
+		sprintf(buf, "%.9g", r);
+		kr[it] = buf;
+		sprintf(buf, "%d", p);
+		pair[it] = buf;
+	}
+
+	try{
+		digraphWriter(*derivs, file).
+			nodeMap("kind", kind).nodeMap("mid", mid).nodeMap("conc", conc).nodeMap("histone", histone).nodeMap("ptm", ptm).
+			arcMap("type", type).arcMap("rate", rate).arcMap("kf", kf).arcMap("kr", kr).arcMap("pair", pair).
+			run();
+	}
+	catch(lemon::Exception& e){
+		t.trace("error","Could not write %s: %s\n", file, e.what());
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * int DerivGraph::importLgf(const char*)
+ *
+ * Build the network from a file in the format written by exportLgf. The DerivGraph must be newly constructed (holding only
+ * the null node), and the file's null node is mapped onto it.
+ *
+ * Node and arc labels in the file do not have to be contiguous. Arc labels used by the pair column are translated to the
+ * new arc ids, and DNA promoter ids and complex component ids are recovered from the arcs. The type lists are rebuilt in
+ * label order.
+ *
+ * @param file the file to read
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int DerivGraph::importLgf(const char* file){
+
+	SmartDigraph g;
+	SmartDigraph::NodeMap<string> kind(g), ptm(g);
+	SmartDigraph::NodeMap<int> mid(g);
+	SmartDigraph::NodeMap<float> conc(g), histone(g);
+	SmartDigraph::ArcMap<string> type(g);
+	SmartDigraph::ArcMap<int> label(g), pair(g);
+	SmartDigraph::ArcMap<float> rate(g), kf(g), kr(g);
+
+	try{
+		digraphReader(g, file).
+			nodeMap("kind", kind).nodeMap("mid", mid).nodeMap("conc", conc).nodeMap("histone", histone).nodeMap("ptm", ptm).
+			arcMap("label", label).arcMap("type", type).arcMap("rate", rate).arcMap("kf", kf).arcMap("kr", kr).arcMap("pair", pair).
+			run();
+	}
+	catch(lemon::Exception& e){
+		t.trace("error","Could not read %s: %s\n", file, e.what());
+		return 0;
+	}
+
+	//molecules, in the order they appear in the file
+	SmartDigraph::NodeMap<SmartDigraph::Node> nodeOf(g);
+	int nullSeen = 0;
+
+	for(int id = 0; id <= g.maxNodeId(); id++){
+
+		SmartDigraph::Node fn = g.nodeFromId(id);
+
+		int k = -1;
+		for(int i = 0; i <= MK_PTM; i++)
+			if(kind[fn] == lgfKindNames[i])
+				k = i;
+
+		if(k == -1){
+			t.trace("error","%s: unknown molecule kind '%s'\n", file, kind[fn].c_str());
+			return 0;
+		}
+
+		if(k == MK_NULL && !nullSeen){
+			nodeOf[fn] = nullnode;
+			nullSeen = 1;
+			continue;
+		}
+
+		SmartDigraph::Node n = derivs->addNode();
+		Molecule* m = newMolecule(k);
+		(*molecules)[n] = m;
+		m->nodeID = derivs->id(n);
+		m->setID(mid[fn]);
+		m->setValue(conc[fn]);
+		sscanf(ptm[fn].c_str(), "%d,%d,%d,%d", &m->PTMArray[0], &m->PTMArray[1], &m->PTMArray[2], &m->PTMArray[3]);
+		nodeOf[fn] = n;
+
+		if(mid[fn] >= count)
+			count = mid[fn] + 1;
+
+		if(k != MK_NULL)
+			MoleculeList->push_back(m);
+
+		switch(k){
+		case MK_DNA:
+			((DNA*)m)->setHistoneModValue(histone[fn]);
+			((DNA*)m)->hill = hill;
+			DNAList->push_back((DNA*)m);
+			break;
+		case MK_MRNA:
+			mRNAList->push_back((mRNA*)m);
+			break;
+		case MK_PROTEIN:
+			ProteinList->push_back((Protein*)m);
+			break;
+		case MK_COMPLEX:
+			ComplexList->push_back((Complex*)m);
+			break;
+		case MK_PTM:
+			PTMList->push_back((PTMProtein*)m);
+			break;
+		}
+	}
+
+	//interactions, in the order they appear in the file
+	map<int, int> arcOfLabel;
+	vector<Interaction*> paired;
+	vector<int> pairLabels;
+
+	for(int id = 0; id <= g.maxArcId(); id++){
+
+		SmartDigraph::Arc fa = g.arcFromId(id);
+		const string& name = type[fa];
+		Interaction* i;
+
+		if(name == "txn")
+			i = new (*arena) Transcription();
+		else if(name == "tsln")
+			i = new (*arena) Translation();
+		else if(name == "deg")
+			i = new (*arena) Degradation();
+		else if(name == "f_cmplx")
+			i = new (*arena) ForwardComplexation();
+		else if(name == "r_cmplx")
+			i = new (*arena) ReverseComplexation();
+		else if(name == "f_ptm")
+			i = new (*arena) ForwardPTM();
+		else if(name == "r_ptm")
+			i = new (*arena) ReversePTM();
+		else if(name == "rep" || name == "act" || name == "pro")
+			i = new (*arena) PromoterBind(kf[fa], kr[fa]);
+		else{
+			t.trace("error","%s: unknown interaction type '%s'\n", file, name.c_str());
+			return 0;
+		}
+
+		SmartDigraph::Node from = nodeOf[g.source(fa)];
+		SmartDigraph::Node to = nodeOf[g.target(fa)];
+		SmartDigraph::Arc a = derivs->addArc(from, to);
+		(*interactions)[a] = i;
+		i->arcID = derivs->id(a);
+		i->setRate(rate[fa]);
+		arcOfLabel[label[fa]] = i->arcID;
+
+		switch(i->kind){
+		case IK_TRANSCRIPTION:
+			TranscriptionList->push_back((Transcription*)i);
+			break;
+		case IK_TRANSLATION:
+			TranslationList->push_back((Translation*)i);
+			break;
+		case IK_DEGRADATION:
+			DegradationList->push_back((Degradation*)i);
+			break;
+		case IK_FORWARD_COMPLEXATION:
+			ForwardComplexationList->push_back((ForwardComplexation*)i);
+			paired.push_back(i);
+			pairLabels.push_back(pair[fa]);
+			break;
+		case IK_REVERSE_COMPLEXATION:
+			ReverseComplexationList->push_back((ReverseComplexation*)i);
+			paired.push_back(i);
+			pairLabels.push_back(pair[fa]);
+			break;
+		case IK_FORWARD_PTM:
+			ForwardPTMList->push_back((ForwardPTM*)i);
+			break;
+		case IK_REVERSE_PTM:
+			ReversePTMList->push_back((ReversePTM*)i);
+			break;
+		case IK_PROMOTER_BIND:
+			if(name == "act")
+				((PromoterBind*)i)->setAsActivation();
+			else
+				((PromoterBind*)i)->setAsRepression();
+			((DNA*)(*molecules)[to])->promoterId = i->arcID;
+			PromoterBindList->push_back((PromoterBind*)i);
+			break;
+		}
+
+		//the components of a complex are the sources of its forward complexations
+		if(i->kind == IK_FORWARD_COMPLEXATION){
+			Complex* c = (Complex*)(*molecules)[to];
+			if(c->getComponentId(1) == -1)
+				c->setComponentIds(derivs->id(from), -1);
+			else
+				c->setComponentIds(c->getComponentId(1), derivs->id(from));
+		}
+	}
+
+	//translate the pair labels into the new arc ids
+	for(unsigned int p = 0; p < paired.size(); p++){
+
+		int pairID = arcOfLabel.count(pairLabels[p]) ? arcOfLabel[pairLabels[p]] : 0;
+
+		if(paired[p]->kind == IK_FORWARD_COMPLEXATION)
+			((ForwardComplexation*)paired[p])->setPairArcID(pairID);
+		else
+			((ReverseComplexation*)paired[p])->setPairArcID(pairID);
+	}
+
+	t.trace("init","DerivGraph %p imported %d molecules and %d interactions from %s\n", this, (int)MoleculeList->size(), countArcs(*derivs), file);
+	return 1;
+}
+
 /**
  * DerivGraph::setLimits(int, int, int, int)
  *
@@ -1299,6 +2537,15 @@ void DerivGraph::setLimits(int max_basic, int max_ptm, int max_comp, int max_pro
 	t.trace("args","Max Complex: %d\n", maxComp);
 	t.trace("args","Max Promoters: %d\n", maxProm);
 
+	//room for a network grown to the limits, so mutations do not reallocate the graph or the lists.
+	//A basic protein adds 3 nodes and 4 arcs, a PTM 1 node and 3 arcs, a complex 1 node and 5 arcs, a promoter 1 arc
+	int nodes = 1 + 3 * maxBasic + maxPTM + maxComp;
+	int arcs = 4 * maxBasic + 3 * maxPTM + 5 * maxComp + maxProm;
+
+	derivs->reserveNode(nodes);
+	derivs->reserveArc(arcs);
+	MoleculeList->reserve(nodes);
+	InteractionList->reserve(arcs);
 }
 /**
  * DerivGraph::setRungeKuttaEval(float, float)
@@ -1327,6 +2574,17 @@ void DerivGraph::setKineticRateLimits(float min_kinetic_rate, float max_kinetic_
 
 }
 
+/**
+ * void DerivGraph::setHill(int)
+ *
+ * Set the hill coefficient given to new DNA molecules (see Kinetics::evaluate)
+ *
+ * @param h the hill coefficient
+ */
+void DerivGraph::setHill(int h){
+	hill = h;
+}
+
 /**
  * DerivGraph::setDefaultInitialConcentration(float)
  *
@@ -1339,3 +2597,217 @@ void DerivGraph::setDefaultInitialConc(float initial_conc){
 	defaultInitialConcentration = initial_conc;
 
 }
+
+/**
+ * int DerivGraph::continuation(FILE*, const char*, float, float, float)
+ *
+ * Follow the steady state of the network over a range of hill coefficients and write its bifurcation table (see
+ * Continuation). The hill coefficients of the DNA molecules are not changed.
+ *
+ * @param out the stream to write the table to
+ * @param name the name of the network in the table
+ * @param from the first hill coefficient
+ * @param to the last hill coefficient
+ * @param step the spacing of the rows of the table
+ *
+ * @return the number of Hopf points found
+ */
+int DerivGraph::continuation(FILE* out, const char* name, float from, float to, float step){
+
+	vector<float> initial, scale;
+	compile(initial, scale);
+
+	Continuation c(out, name);
+	c.run(*kinetics, initial, scale, from, to, step);
+
+	//the rate laws go back to the hill coefficients of the DNA
+	kinetics->compile(*arcTable);
+	invalidate();
+
+	return c.getHopfCount();
+}
+
+/**
+ * static double benchTime()
+ *
+ * @return the wall clock time in seconds
+ */
+static double benchTime(){
+
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * void DerivGraph::grow()
+ *
+ * Grow the network by the mutation methods until no mutation adds anything.
+ */
+void DerivGraph::grow(){
+
+	for(int round = 0; round < 10000; round++){
+		int before = derivs->maxArcId();
+		if(!isLimited(MUT_NEW_BASIC))
+			newBasic();
+		if(!isLimited(MUT_NEW_PTM))
+			newPTM();
+		if(!isLimited(MUT_NEW_COMPLEX))
+			newComplex();
+		if(!isLimited(MUT_NEW_PROMOTER))
+			newPromoter();
+		if(derivs->maxArcId() == before)
+			break;
+	}
+}
+
+/**
+ * void DerivGraph::benchmark(FILE*)
+ *
+ * Micro-benchmark of arc iteration. The network is grown to its limits by the mutation methods, and then every arc
+ * is visited repeatedly, reading the kind of its interaction and the ids of the nodes at both ends:
+ *   graph   SmartDigraph::ArcIt, with the molecules and interactions looked up in the NodeMap and ArcMap
+ *   out     SmartDigraph::OutArcIt of every node
+ *   table   the ArcTable records, in order
+ *   in      the ArcTable ranges of the arcs entering every node
+ *
+ * @param out the stream to write the results to
+ */
+void DerivGraph::benchmark(FILE* out){
+
+	grow();
+
+	arcTable->update(*derivs, *molecules, *interactions);
+
+	int numNodes = arcTable->getNodeCount();
+	int numArcs = arcTable->getArcCount();
+	int passes = 1 + BENCH_ARC_VISITS / (numArcs > 0 ? numArcs : 1);
+
+	fprintf(out, "Arc iteration benchmark: %d nodes, %d arcs, %d passes\n", numNodes, numArcs, passes);
+
+	const char* names[4] = { "graph", "out", "table", "in" };
+	for(int method = 0; method < 4; method++){
+
+		long sum = 0;
+		double start = benchTime();
+
+		for(int pass = 0; pass < passes; pass++){
+			switch(method){
+			case 0:
+				for(SmartDigraph::ArcIt it(*derivs); it != INVALID; ++it)
+					sum += (*interactions)[it]->kind + derivs->id(derivs->source(it)) + derivs->id(derivs->target(it));
+				break;
+			case 1:
+				for(SmartDigraph::NodeIt n(*derivs); n != INVALID; ++n)
+					for(SmartDigraph::OutArcIt it(*derivs, n); it != INVALID; ++it)
+						sum += (*interactions)[it]->kind + derivs->id(n) + derivs->id(derivs->target(it));
+				break;
+			case 2:
+				for(int n = 0; n < numNodes; n++)
+					for(ArcRecord* a = arcTable->outBegin(n); a != arcTable->outEnd(n); ++a)
+						sum += a->kind + a->source + a->target;
+				break;
+			case 3:
+				for(int n = 0; n < numNodes; n++)
+					for(const int* p = arcTable->inBegin(n); p != arcTable->inEnd(n); ++p){
+						ArcRecord& a = arcTable->at(*p);
+						sum += a.kind + a.source + a.target;
+					}
+				break;
+			}
+		}
+
+		double elapsed = benchTime() - start;
+		fprintf(out, "  %-6s %8.2f ns/arc  (checksum %ld)\n", names[method], 1e9 * elapsed / ((double)passes * (numArcs > 0 ? numArcs : 1)), sum);
+	}
+}
+
+/**
+ * void DerivGraph::stepBenchmark(FILE*, float, float)
+ *
+ * Find the longest timesteps each integrator (see Integrator) copes with on this network, grown to its limits. The
+ * reference is Runge-Kutta with a timestep BENCH_STEP_REFINE times shorter than the shortest one tried, and the
+ * timestep is doubled from the given one until the run is neither accurate (within BENCH_STEP_TOLERANCE of the
+ * reference everywhere) nor stable (within BENCH_STEP_BOUND times the largest reference concentration). Writes one
+ * row: the nodes, reactions and fastest decay rate of the network, then for rk4, lawson and qssa the longest accurate
+ * timestep, the time taken by a run with it in milliseconds, and the longest stable timestep (0 if even the given
+ * timestep fails), and last the number of molecules the quasi-steady-state reduction holds and its error at the
+ * given timestep.
+ *
+ * @param out the stream to write the row to
+ * @param step the shortest timestep tried
+ * @param limit the length of the run
+ */
+void DerivGraph::stepBenchmark(FILE* out, float step, float limit){
+
+	grow();
+
+	vector<float> initial, scale;
+	compile(initial, scale);
+	int numNodes = initial.size();
+
+	//the reference concentrations at every multiple of step
+	int samples = (int)(limit / step + .5);
+	vector<float> reference((samples + 1) * numNodes);
+	vector<float> c = initial;
+
+	Integrator exact(*kinetics, scale, INTEGRATE_RK4);
+	copy(c.begin(), c.end(), reference.begin());
+	for(int i = 1; i <= samples; i++){
+		for(int k = 0; k < BENCH_STEP_REFINE; k++)
+			exact.step(&c[0], step / BENCH_STEP_REFINE);
+		copy(c.begin(), c.end(), reference.begin() + i * numNodes);
+	}
+	float bound = BENCH_STEP_BOUND * (1 + *max_element(reference.begin(), reference.end()));
+
+	fprintf(out, "%5d %9d %9.3g", numNodes, kinetics->getReactionCount(), exact.getFastestDecay());
+
+	int fastCount = 0;
+	double reductionError = 0;
+
+	int methods[3] = { INTEGRATE_RK4, INTEGRATE_LAWSON, INTEGRATE_QSSA };
+	for(int m = 0; m < 3; m++){
+
+		float accurateStep = 0, stableStep = 0;
+		int accurate = 1, stable = 1;
+		double elapsed = 0;
+
+		for(int d = 0; d <= BENCH_STEP_DOUBLINGS && (1 << d) <= samples && (accurate || stable); d++){
+			int stride = 1 << d;
+			float h = step * stride;
+
+			Integrator integrator(*kinetics, scale, methods[m]);
+			c = initial;
+
+			double error = 0;
+			double start = benchTime();
+			for(int i = stride; i <= samples && c[0] <= bound; i += stride){
+				integrator.step(&c[0], h);
+				for(int n = 0; n < numNodes; n++){
+					double e = fabs(c[n] - reference[i * numNodes + n]) / (1 + fabs(reference[i * numNodes + n]));
+					if(!(e <= error))
+						error = e;
+					if(!(c[n] <= bound))
+						c[0] = HUGE_VAL;
+				}
+			}
+
+			if(methods[m] == INTEGRATE_QSSA && d == 0){
+				fastCount = integrator.getFastCount();
+				reductionError = error;
+			}
+
+			accurate = accurate && error <= BENCH_STEP_TOLERANCE;
+			stable = stable && c[0] <= bound;
+			if(accurate){
+				accurateStep = h;
+				elapsed = benchTime() - start;
+			}
+			if(stable)
+				stableStep = h;
+		}
+
+		fprintf(out, "   %7.3g %6.2f %7.3g", accurateStep, 1e3 * elapsed, stableStep);
+	}
+	fprintf(out, "  %5d %9.3g\n", fastCount, reductionError);
+}
@@ -1,7 +1,7 @@
 #ifndef DERIVGRAPH_H_
 #define DERIVGRAPH_H_
 
-#include "lemon/list_graph.h"
+#include "lemon/smart_graph.h"
 #include "lemon/concepts/maps.h"
 #include <cstdio>
 #include <vector>
@@ -16,26 +16,65 @@
 
 #include "CustomInteractions.h"
 #include "CustomMolecules.h"
+#include "Checkpoint.h"
+#include "Arena.h"
+#include "ArcTable.h"
+#include "Kinetics.h"
+#include "Sensitivity.h"
+#include "Spectrum.h"
+#include "CycleDetector.h"
+#include "SteadyState.h"
+#include "Continuation.h"
+#include "Integrator.h"
+#include "Parareal.h"
+#include "KineticsTeam.h"
+#include "Conservation.h"
+#include "ComponentCache.h"
+#include <pthread.h>
 
 using namespace std;
 using namespace lemon;
 
-struct prop_entry{
-	float pe_propensity;
-	Interaction* pe_interaction;
+// mutation types, one for each DerivGraph mutation method (returned by Cell::mutate())
+enum MutationType{
+	MUT_NULL = 0,
+	MUT_FORWARD_RATE,
+	MUT_REVERSE_RATE,
+	MUT_DEGRADATION_RATE,
+	MUT_NEW_PTM,
+	MUT_HISTONE,
+	MUT_NEW_COMPLEX,
+	MUT_NEW_BASIC,
+	MUT_NEW_PROMOTER,
+	MUT_TYPE_COUNT
+};
+
+// ways of scoring the oscillation of a molecule (Experiment::setScoring)
+enum ScoreMethod{
+	SCORE_COUNT = 0,
+	SCORE_FFT
 };
 
 class DerivGraph{
 
 public:
 	DerivGraph();
+	DerivGraph(const DerivGraph&);
 	~DerivGraph();
 	
 	MTRand r;
 	
 	void test();
-	void rungeKuttaEvaluate(float, float);
-	void gillespieEvaluate(float);
+	void rungeKuttaEvaluate(float, float, int, int, ThreadPool*, int, ComponentCache*);
+	void gillespieEvaluate(float, float);
+	void sensitivityEvaluate(Molecule*, float, float);
+	void spectralEvaluate();
+	int hasFeedback();
+	int isStable();
+
+	// set by the screens of Experiment::processCell, the score is then 0 whatever the molecules last counted
+	void setRejected(int r){ rejected = r; };
+	int isRejected(){ return rejected; };
 
 	void outputDotImage(const char*, int, int, int);
 	void outputDataPlot(const char*, int, int, int, float);
@@ -44,20 +83,50 @@ public:
 
 	void gillespieOutputDataCsv(const char*, int, int, int, float);
 
-	Molecule* getBestMolecule(int);
+	Molecule* getBestMolecule(int, int);
+	int getMoleculeScore(Molecule*, int);
+
+	int getNodeCount();
+	int getArcCount();
 
 	void setLimits(int, int, int, int);
 	void setKineticRateLimits(float, float);
 	void setRungeKuttaEval(float, float);
 	void setDefaultInitialConc(float);
+	void setHill(int);
+
+	void benchmark(FILE*);
+	void stepBenchmark(FILE*, float, float);
+	int continuation(FILE*, const char*, float, float, float);
+
+	// serialization
+	void save(Snapshot&);
+	int load(Snapshot&);
+	void copySettings(DerivGraph*);
+
+	// LEMON Graph Format import / export
+	void outputLgf(const char*, int, int, int);
+	int exportLgf(const char*);
+	int importLgf(const char*);
 
 
 	//deprecated?
-	ListDigraph* getListDigraph();
-	ListDigraph::NodeMap<Molecule*>* getNodeMap();
-	ListDigraph::ArcMap<Interaction*>* getArcMap();
+	SmartDigraph* getSmartDigraph();
+	SmartDigraph::NodeMap<Molecule*>* getNodeMap();
+	SmartDigraph::ArcMap<Interaction*>* getArcMap();
 	
+	// copy on write sharing between cells
+	DerivGraph* share();
+	void release();
+	int isShared(){ return __sync_fetch_and_add(&refs, 0) > 1; };
+	void invalidate(){ evaluated = 0; analysed = 0; measured = 0; screened = 0; linearised = 0; };
+
+	// held while a cell evaluates, scores, copies or outputs the network, which may be shared with cells on other threads
+	void lock(){ pthread_mutex_lock(&mutex); };
+	void unlock(){ pthread_mutex_unlock(&mutex); };
+
 	//mutation methods
+	int isLimited(int);
 	void newBasic();
 	void forwardRateChange();
 	void reverseRateChange();
@@ -68,6 +137,11 @@ public:
 	void newPTM();	
 
 private:
+	// the tests in tests/ compare the graphs and the solutions of networks directly
+	friend class LgfRoundTrip;
+	friend class IntegratorAgreement;
+	friend class ConservationLaws;
+	friend class CachedComponents;
 
 	float minKineticRate;
 	float maxKineticRate;
@@ -79,13 +153,20 @@ private:
 	int maxProm;
 	int maxPTM;
 
+	// hill coefficient of new DNA molecules
+	int hill;
+
 	float rkTimeStep;
 	float rkTimeLimit;
 
 	//graph structure
-	ListDigraph* derivs;
-	ListDigraph::NodeMap<Molecule*>* molecules;
-	ListDigraph::ArcMap<Interaction*>* interactions;
+	SmartDigraph* derivs;
+	SmartDigraph::NodeMap<Molecule*>* molecules;
+	SmartDigraph::ArcMap<Interaction*>* interactions;
+
+	//contiguous copy of the arcs, and the rate laws compiled from it, for the solvers
+	ArcTable* arcTable;
+	Kinetics* kinetics;
 
 	// molecule lists
 	vector<Molecule*>* MoleculeList;
@@ -106,17 +187,62 @@ private:
 	vector<ReversePTM*>* ReversePTMList;
 	vector<PromoterBind*>* PromoterBindList;
 
-	//stochastic
-	vector<ListDigraph::Arc> Propensities;
-
 	//null node
-	ListDigraph::Node nullnode;
+	SmartDigraph::Node nullnode;
+
+	//storage of the molecules and interactions
+	Arena* arena;
+
+	//number of cells holding this DerivGraph, changed atomically
+	int refs;
+	pthread_mutex_t mutex;
+
+	//set once the Runge-Kutta solution is up to date with the network
+	int evaluated;
+
+	//set once the sensitivities are up to date with the network
+	int analysed;
+
+	//oscillation of every molecule in the Runge-Kutta solution, by node id, once measured is set
+	int measured;
+	vector<Oscillation> oscillations;
+
+	//whether a repression is part of a feedback loop, once screened is set
+	int screened;
+	int feedback;
+
+	//whether the steady state is certainly stable, once linearised is set
+	int linearised;
+	int stable;
+
+	//whether the last screen found the network can not oscillate. Kept by mutations and copies, as the
+	//counts of the molecules are, until the next scoring generation screens or evaluates the network again
+	int rejected;
+
+	//relative sensitivity of the oscillation amplitude to the rate of each arc, by arc id (empty until analysed)
+	vector<float> rateSensitivity;
+	int pickRate(const vector<int>&);
+
+	//compile the network, with the initial concentrations and state scales of its nodes, for the solvers
+	void compile(vector<float>&, vector<float>&);
+
+	//the components of the network, and their solutions where the cache has them
+	int findComponents(ComponentCache*, float, int, const vector<float>&, const vector<float>&, vector<int>&, vector<string>&, vector< vector<int> >&);
+
+	//grow the network to its limits, for the benchmarks
+	void grow();
 
-	//helper method
-	float getEffect(ListDigraph::Node, ListDigraph::Arc, int, float);
 	//utility method
-	ListDigraph::Node add(Molecule*);
-	ListDigraph::Arc add(Interaction*, ListDigraph::Node, ListDigraph::Node);
+	void allocate();
+	template <class T> void copyList(const vector<T*>*, vector<T*>*, int);
+	SmartDigraph::Node add(Molecule*);
+	SmartDigraph::Arc add(Interaction*, SmartDigraph::Node, SmartDigraph::Node);
+
+	//snapshot helpers
+	Molecule* newMolecule(int);
+	Interaction* newInteraction(int);
+	template <class T> void saveList(Snapshot&, vector<T*>*, int);
+	template <class T> void loadList(Snapshot&, vector<T*>*, int);
 	int count;
 };
 
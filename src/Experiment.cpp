@@ -6,10 +6,12 @@
  *
  */
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 #include <vector>
 
 #include "Experiment.h"
@@ -37,9 +39,10 @@ using namespace std;
  * @param rk_time_limit the stopping condition for runge-kutta iteration
  * @param rk_time_step how much time to advance each iteration
  * @param initial_conc the initial concentration for molecules
+ * @param hill_coefficient the hill coefficient of the genes
  */
-Experiment::Experiment(int ncells, int generations, int max_basic, int max_ptm, int max_comp, int max_prom, float min_kinetic_rate, float max_kinetic_rate, float rk_time_limit, float rk_time_step, float initial_conc, int rk_enabled, int gillespie_enabled)
-	   :maxBasic(max_basic), maxPTM(max_ptm), maxComp(max_comp), maxProm(max_prom), minKineticRate(min_kinetic_rate), maxKineticRate(max_kinetic_rate), rkTimeLimit(rk_time_limit), rkTimeStep(rk_time_step), initialConc(initial_conc), rungeKutta(rk_enabled), gillespie(gillespie_enabled){
+Experiment::Experiment(int ncells, int generations, int max_basic, int max_ptm, int max_comp, int max_prom, float min_kinetic_rate, float max_kinetic_rate, float rk_time_limit, float rk_time_step, float initial_conc, int hill_coefficient, int rk_enabled, int gillespie_enabled)
+	   :maxBasic(max_basic), maxPTM(max_ptm), maxComp(max_comp), maxProm(max_prom), minKineticRate(min_kinetic_rate), maxKineticRate(max_kinetic_rate), rkTimeLimit(rk_time_limit), rkTimeStep(rk_time_step), initialConc(initial_conc), hill(hill_coefficient), rungeKutta(rk_enabled), gillespie(gillespie_enabled){
 
 	
 	t.trace("init","Creating new Experiment\n");
@@ -50,6 +53,31 @@ Experiment::Experiment(int ncells, int generations, int max_basic, int max_ptm,
 	t.trace("args","%d Generations\n", generations);
 
 	maxGenerations = generations;
+	startGeneration = 1;
+
+	summary = 0;
+	checkpoint = 0;
+	checkpointInterval = 0;
+
+	selectionMode = SELECT_NONE;
+	elitism = 0;
+	tournamentSize = 2;
+	guided = 0;
+	scoring = SCORE_COUNT;
+	cycleDetection = 0;
+	integrator = INTEGRATE_RK4;
+	slicePool = 0;
+	networkThreads = 1;
+	componentCache = 0;
+	prefilter = 0;
+	hopf = 0;
+
+	transport = 0;
+	migrationInterval = 0;
+	migrants = 0;
+	topology = TOPOLOGY_RING;
+
+	pool = 0;
 
 	char buf[200];
 	pid = getpid();
@@ -63,15 +91,12 @@ Experiment::Experiment(int ncells, int generations, int max_basic, int max_ptm,
 	//create the cell objects and add them to our cells vector
 	for (int i = 0; i < ncells; i++){
 		t.trace("init","Creating Cell (%d)\n",i);
-		cells.push_back(new Cell(maxBasic, maxPTM, maxComp, maxProm,minKineticRate,maxKineticRate, rkTimeStep, rkTimeLimit, initialConc));
-		
-		//set up directory for the new cell in output folder		
-		sprintf(buf, "%s/%d/cell%d", prefix, pid, cells.back()->getID());
-		mkdir(buf, S_IRWXU | S_IRWXG | S_IRWXO); 
-		sprintf(buf, "%s/%d/cell%d/csv", prefix, pid, cells.back()->getID());
-		mkdir(buf, S_IRWXU | S_IRWXG | S_IRWXO); 
+		cells.push_back(new Cell(maxBasic, maxPTM, maxComp, maxProm,minKineticRate,maxKineticRate, rkTimeStep, rkTimeLimit, initialConc, hill));
 	}
 
+	//the cell directories are made when a cell first writes output
+	madeDirectory.assign(cells.size(), 0);
+
 	t.trace("init","New Experiment created\n");
 }
 
@@ -94,12 +119,51 @@ Experiment::~Experiment() {
 	t.trace("free","Deleting Cell[] object at location %p\n", &cells);
 	cells.clear();
 
+	//flushes any buffered summary records
+	delete summary;
+
+	//waits for an outstanding checkpoint write
+	delete checkpoint;
+
+
+
+}
+
+/**
+ * void Experiment::makeCellDirectory(int)
+ *
+ * Create the output directories for a cell (prefix/pid/cell<id>/csv), unless they were already made. Cells keep their
+ * CellID when their network is replaced, so the directories of a cell only have to be made once.
+ *
+ * @param c the index of the cell
+ */
+void Experiment::makeCellDirectory(int c){
 
+	if(madeDirectory[c])
+		return;
 
+	char buf[200];
+	sprintf(buf, "%s/%d/cell%d", prefix, pid, cells[c]->getID());
+	mkdir(buf, S_IRWXU | S_IRWXG | S_IRWXO); 
+	sprintf(buf, "%s/%d/cell%d/csv", prefix, pid, cells[c]->getID());
+	mkdir(buf, S_IRWXU | S_IRWXG | S_IRWXO); 
+
+	madeDirectory[c] = 1;
 }
 
 /**
- * Experiment::setOutputOptions(int, int, int, int, int, int)
+ * void Experiment::getOutputPath(const char*, char*, size_t)
+ *
+ * @param name a file name
+ * @param buf filled with the path of the file in the output directory of the experiment (prefix/pid/name)
+ * @param size the size of buf
+ */
+void Experiment::getOutputPath(const char* name, char* buf, size_t size){
+	snprintf(buf, size, "%s/%d/%s", prefix, pid, name);
+}
+
+/**
+ * Experiment::setOutputOptions(int, int, int, int, int, int, int, int)
  * 
  * Set options received from the command line parameters which deal with output files or formats
  * A value of 1 enables the option, and 0 disables it. 
@@ -110,18 +174,580 @@ Experiment::~Experiment() {
  * @param csv_cell Triggers output of csv files which contain the interactions and rates within a cell
  * @param csv_data Triggers output of csv files which contain concentration data of molecules over time at a given generation
  * @param scoring_interval How many generations should occur between scoring and output
+ * @param summary_flag Triggers output of a per-generation population summary stream (prefix/pid/summary.ndjson)
+ * @param lgf_flag Triggers output of LEMON Graph Format files of the cell networks, which can be used with --init-from
  *
  */
-void Experiment::setOutputOptions(int gv_flag, int gp_flag, int eachgen_flag, int csv_cell, int csv_data, int scoring_interval){
+void Experiment::setOutputOptions(int gv_flag, int gp_flag, int eachgen_flag, int csv_cell, int csv_data, int scoring_interval, int summary_flag, int lgf_flag){
 
 	graphviz_enabled = gv_flag;
 	gnuplot_enabled = gp_flag;
 	output_each_gen = eachgen_flag;
         output_csv_interactions = csv_cell;
 	output_csv_data = csv_data;	
+	output_lgf = lgf_flag;
 	scoringInterval = scoring_interval;
+
+	if(summary_flag && !summary){
+		char buf[200];
+		getOutputPath("summary.ndjson", buf, sizeof(buf));
+		summary = new Summary(buf);
+	}
 	
 }
+
+/**
+ * void Experiment::setSummaryStream(FILE*, const char*)
+ *
+ * Write the per-generation summary records to a stream shared with other experiments, such as the points of a
+ * parameter sweep, instead of summary.ndjson. The stream is not closed by the experiment.
+ *
+ * @param stream the shared stream
+ * @param label JSON members identifying the experiment, added to the start of every record
+ */
+void Experiment::setSummaryStream(FILE* stream, const char* label){
+
+	delete summary;
+	summary = new Summary(stream, label);
+}
+
+/**
+ * int Experiment::seedFrom(const char*, float)
+ *
+ * Replace the networks of some or all of the cells with a network read from a LEMON Graph Format file, so the experiment
+ * can start near a known solution instead of from a single basic protein. The remaining cells keep their initial network.
+ *
+ * @param file the LGF file
+ * @param fraction the fraction of the population to seed, between 0 and 1
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int Experiment::seedFrom(const char* file, float fraction){
+
+	int n = (int)(fraction * cells.size() + 0.5);
+	if(n > (int)cells.size())
+		n = cells.size();
+
+	for(int c = 0; c < n; c++){
+		if(!cells[c]->loadNetwork(file))
+			return 0;
+	}
+
+	t.trace("args","Seeded %d of %d Cells from %s\n", n, (int)cells.size(), file);
+	return 1;
+}
+
+/**
+ * void Experiment::setCheckpointInterval(int)
+ *
+ * Enable periodic checkpoints. Every interval generations the whole population is serialized to prefix/pid/checkpoint.bin.
+ * Serialization happens in memory, and the file is written by a background thread.
+ *
+ * @param interval the number of generations between checkpoints (0 disables checkpoints)
+ */
+void Experiment::setCheckpointInterval(int interval){
+
+	checkpointInterval = interval;
+
+	if(interval > 0 && !checkpoint){
+		char buf[200];
+		sprintf(buf, "%s/%d/checkpoint.bin", prefix, pid);
+		checkpoint = new Checkpoint(buf);
+	}
+}
+
+/**
+ * void Experiment::saveCheckpoint(int)
+ *
+ * Serialize the experiment at the end of a generation and hand it to the checkpoint writer.
+ *
+ * @param gen the generation which just finished
+ */
+void Experiment::saveCheckpoint(int gen){
+
+	Snapshot* s = checkpoint->getBuffer();
+
+	s->putInt(SNAPSHOT_MAGIC);
+	s->putInt(SNAPSHOT_VERSION);
+	s->putInt(gen);
+	s->putInt(hill);
+	s->putInt(Cell::getCellCounter());
+
+	s->putInt(maxBasic);
+	s->putInt(maxPTM);
+	s->putInt(maxComp);
+	s->putInt(maxProm);
+	s->putFloat(minKineticRate);
+	s->putFloat(maxKineticRate);
+	s->putFloat(rkTimeLimit);
+	s->putFloat(rkTimeStep);
+	s->putFloat(initialConc);
+
+	s->putRandom(r);
+
+	s->putInt(cells.size());
+	for(unsigned int c = 0; c < cells.size(); c++)
+		cells[c]->save(*s);
+
+	checkpoint->write();
+	t.trace("gens","Checkpoint of generation %d queued (%d bytes)\n", gen, (int)s->data.size());
+}
+
+/**
+ * int Experiment::resume(const char*)
+ *
+ * Replace the population with the one saved in a checkpoint file. The generational loop continues with the generation
+ * after the one that was saved, and the cell parameters and random generator states are taken from the checkpoint,
+ * so the run continues exactly as it would have without the interruption.
+ *
+ * @param file the checkpoint file
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int Experiment::resume(const char* file){
+
+	Snapshot s;
+	if(!s.readFile(file)){
+		t.trace("error","Could not read checkpoint %s\n", file);
+		return 0;
+	}
+
+	if(s.getInt() != SNAPSHOT_MAGIC || s.getInt() != SNAPSHOT_VERSION){
+		t.trace("error","%s is not a checkpoint file\n", file);
+		return 0;
+	}
+
+	int gen = s.getInt();
+	hill = s.getInt();
+	int counter = s.getInt();
+
+	maxBasic = s.getInt();
+	maxPTM = s.getInt();
+	maxComp = s.getInt();
+	maxProm = s.getInt();
+	minKineticRate = s.getFloat();
+	maxKineticRate = s.getFloat();
+	rkTimeLimit = s.getFloat();
+	rkTimeStep = s.getFloat();
+	initialConc = s.getFloat();
+
+	s.getRandom(r);
+
+	vector<Cell*> restored;
+	int ncells = s.getInt();
+	for(int i = 0; i < ncells && !s.failed(); i++)
+		restored.push_back(new Cell(s));
+
+	if(s.failed()){
+		t.trace("error","Checkpoint %s is truncated\n", file);
+		for(unsigned int i = 0; i < restored.size(); i++)
+			delete restored[i];
+		return 0;
+	}
+
+	for(unsigned int i = 0; i < cells.size(); i++)
+		delete cells[i];
+	cells = restored;
+
+	for(unsigned int i = 0; i < cells.size(); i++){
+		cells[i]->setScoring(scoring);
+		cells[i]->setCycleDetection(cycleDetection);
+		cells[i]->setIntegrator(integrator);
+		cells[i]->setParareal(slicePool);
+		cells[i]->setNetworkThreads(networkThreads);
+		cells[i]->setComponentCache(componentCache);
+	}
+
+	Cell::setCellCounter(counter);
+	startGeneration = gen + 1;
+
+	madeDirectory.assign(cells.size(), 0);
+
+	t.trace("args","Resumed %d Cells from %s at generation %d\n", (int)cells.size(), file, startGeneration);
+	return 1;
+}
+
+/**
+ * void Experiment::setSelection(int, int, int)
+ *
+ * Enable selection. After each scoring generation, cells which are not selected are replaced by copies of cells
+ * which are. The copies keep the CellID of the cell they replace.
+ *
+ * @param mode one of SELECT_NONE, SELECT_TOURNAMENT, SELECT_TRUNCATION or SELECT_PROPORTIONAL
+ * @param elite the number of best cells which are always kept unchanged
+ * @param tournament the number of cells competing in each tournament (SELECT_TOURNAMENT only)
+ */
+void Experiment::setSelection(int mode, int elite, int tournament){
+
+	selectionMode = mode;
+	elitism = elite > 0 ? elite : 0;
+	tournamentSize = tournament > 0 ? tournament : 1;
+}
+
+/**
+ * void Experiment::setGuidedMutation(int)
+ *
+ * Enable guided rate mutations. On scoring generations the rates of every cell are ranked by their effect on the
+ * oscillation amplitude of its best molecule, and the rate mutations until the next scoring generation favor the
+ * rates with the largest effect. Only the Runge-Kutta solution is analysed.
+ *
+ * @param enabled 1 to guide the rate mutations, 0 to choose the rates uniformly
+ */
+void Experiment::setGuidedMutation(int enabled){
+
+	guided = enabled;
+}
+
+/**
+ * void Experiment::setScoring(int)
+ *
+ * Choose how the oscillations of the molecules are scored.
+ *
+ * @param method SCORE_COUNT to count the direction changes of each molecule, SCORE_FFT to measure the period and
+ *        regularity of each molecule from its autocorrelation
+ */
+void Experiment::setScoring(int method){
+
+	scoring = method;
+	for(unsigned int c = 0; c < cells.size(); c++)
+		cells[c]->setScoring(method);
+}
+
+/**
+ * void Experiment::setCycleDetection(int)
+ *
+ * Stop the Runge-Kutta integration of a cell once it is on a limit cycle, repeating the last period for the rest of
+ * the run instead (see CycleDetector).
+ *
+ * @param cycles the number of consistent periods needed, 0 to always integrate the whole run
+ */
+void Experiment::setCycleDetection(int cycles){
+
+	cycleDetection = cycles > 0 ? cycles : 0;
+	for(unsigned int c = 0; c < cells.size(); c++)
+		cells[c]->setCycleDetection(cycleDetection);
+}
+
+/**
+ * void Experiment::setPrefilter(int)
+ *
+ * Screen the networks before evaluating them. A network without a feedback loop through a repression can not
+ * oscillate, so it is given a score of 0 without being solved (see DerivGraph::hasFeedback). The number of cells
+ * screened out is added to the summary.
+ *
+ * @param enabled 1 to screen the networks, 0 to evaluate every network
+ */
+void Experiment::setPrefilter(int enabled){
+
+	prefilter = enabled;
+}
+
+/**
+ * void Experiment::setHopfScreen(int)
+ *
+ * Screen the networks by the linear stability of their steady state before evaluating them. A network whose steady
+ * state is stable decays to it, so it is given a score of 0 without being solved (see DerivGraph::isStable). Only
+ * networks with an unstable steady state, or none, are evaluated. Cells screened out are counted in the summary,
+ * together with those of the structural screen, which runs first if both are enabled.
+ *
+ * @param enabled 1 to screen the networks, 0 to evaluate every network
+ */
+void Experiment::setHopfScreen(int enabled){
+
+	hopf = enabled;
+}
+
+/**
+ * void Experiment::setIntegrator(int)
+ *
+ * Choose how the cells are integrated. The Lawson integrator stays stable with timesteps longer than the fastest
+ * decays of the network allow Runge-Kutta (see Integrator).
+ *
+ * @param method the IntegratorMethod
+ */
+void Experiment::setIntegrator(int method){
+
+	integrator = method;
+	for(unsigned int c = 0; c < cells.size(); c++)
+		cells[c]->setIntegrator(integrator);
+}
+
+/**
+ * int Experiment::pickParent(vector<int>&, vector<int>&, int)
+ *
+ * Choose the cell whose network fills a slot in the next generation.
+ *
+ *   Tournament:    the best of tournamentSize randomly chosen cells
+ *   Truncation:    cells ranked in the better half keep their network, the others get a random one from the better half
+ *   Proportional:  a cell chosen with probability proportional to its score (uniformly if all scores are 0)
+ *
+ * @param scores the score of each cell
+ * @param ranking the cell indexes, best first
+ * @param rank the position of the slot being filled in the ranking
+ *
+ * @return the index of the parent cell
+ */
+int Experiment::pickParent(vector<int>& scores, vector<int>& ranking, int rank){
+
+	int n = cells.size();
+	int slot = ranking[rank];
+
+	if(selectionMode == SELECT_TOURNAMENT){
+		int best = r.randInt(n - 1);
+		for(int k = 1; k < tournamentSize; k++){
+			int c = r.randInt(n - 1);
+			if(scores[c] > scores[best])
+				best = c;
+		}
+		return best;
+	}
+
+	if(selectionMode == SELECT_TRUNCATION){
+		int survivors = (n + 1) / 2;
+		if(rank < survivors)
+			return slot;
+		return ranking[r.randInt(survivors - 1)];
+	}
+
+	if(selectionMode == SELECT_PROPORTIONAL){
+		double total = 0;
+		for(int c = 0; c < n; c++)
+			total += scores[c] > 0 ? scores[c] : 0;
+		if(total <= 0)
+			return r.randInt(n - 1);
+
+		double pick = r.rand(total);
+		for(int c = 0; c < n; c++){
+			pick -= scores[c] > 0 ? scores[c] : 0;
+			if(pick < 0)
+				return c;
+		}
+		return ranking[0];
+	}
+
+	return slot;
+}
+
+/**
+ * void Experiment::rankCells(vector<int>&, vector<int>&)
+ *
+ * Rank the cells by their current score, best first. Ties keep the population order. Cells whose network was rejected
+ * by a screen score 0, not the score the network they were mutated from had (see Cell::setRejected).
+ *
+ * @param scores filled with the score of each cell
+ * @param ranking filled with the cell indexes, best first
+ */
+void Experiment::rankCells(vector<int>& scores, vector<int>& ranking){
+
+	int n = cells.size();
+	vector<pair<int, int> > order(n);
+
+	scores.resize(n);
+	for(int c = 0; c < n; c++){
+		scores[c] = cells[c]->getScore();
+		order[c] = make_pair(-scores[c], c);
+	}
+	sort(order.begin(), order.end());
+
+	ranking.resize(n);
+	for(int k = 0; k < n; k++)
+		ranking[k] = order[k].second;
+}
+
+/**
+ * void Experiment::select()
+ *
+ * Selection and reproduction stage, run after the cells have been scored. The elitism best cells are kept, and every
+ * other cell gets the network of the parent chosen by pickParent. The networks are shared, and only copied when a
+ * cell changes its network. All parents are shared before any cell is replaced, so a cell can be the parent of another
+ * cell in the same generation even if its own network is replaced.
+ */
+void Experiment::select(){
+
+	int n = cells.size();
+	if(n == 0)
+		return;
+
+	vector<int> scores, ranking;
+	rankCells(scores, ranking);
+
+	//choose the parents
+	vector<int> parent(n);
+	for(int k = 0; k < n; k++)
+		parent[ranking[k]] = k < elitism ? ranking[k] : pickParent(scores, ranking, k);
+
+	//share the parents, then replace the children
+	vector<DerivGraph*> copies(n, (DerivGraph*)0);
+	for(int c = 0; c < n; c++)
+		if(parent[c] != c)
+			copies[c] = cells[parent[c]]->shareNetwork();
+
+	int replaced = 0;
+	for(int c = 0; c < n; c++){
+		if(copies[c]){
+			t.trace("score","Cell %d replaced by a copy of cell %d (score %d -> %d)\n", cells[c]->getID(), cells[parent[c]]->getID(), scores[c], scores[parent[c]]);
+			cells[c]->replaceNetwork(copies[c]);
+			replaced++;
+		}
+	}
+
+	t.trace("gens","Selection replaced %d of %d Cells\n", replaced, n);
+}
+
+/**
+ * void Experiment::setMigration(Transport*, int, int, int)
+ *
+ * Make the experiment one island of an island model. Every interval generations the best cells of this island are
+ * sent to the neighbouring islands, and the networks received from them replace the worst cells of this island.
+ *
+ * @param tr the transport connecting the islands
+ * @param interval the number of generations between migrations
+ * @param count the number of cells sent to each neighbour
+ * @param top TOPOLOGY_RING or TOPOLOGY_FULL
+ */
+void Experiment::setMigration(Transport* tr, int interval, int count, int top){
+
+	transport = tr;
+	migrationInterval = interval;
+	migrants = count;
+	topology = top;
+}
+
+/**
+ * void Experiment::migrate()
+ *
+ * Exchange networks with the neighbouring islands. The networks of the best cells are sent, and every network received
+ * replaces one of the worst cells. The cells which were sent are never replaced, so an island keeps its own best
+ * networks. Islands which exited are left out (see SocketTransport::exchange). If the exchange fails otherwise,
+ * migration is switched off.
+ */
+void Experiment::migrate(){
+
+	vector<int> dests, sources;
+	transport->getNeighbours(topology, dests, sources);
+	if(dests.empty() && sources.empty())
+		return;
+
+	int n = cells.size();
+	vector<int> scores, ranking;
+	rankCells(scores, ranking);
+
+	int sending = migrants < n ? migrants : n;
+
+	Snapshot out;
+	out.putInt(sending);
+	for(int k = 0; k < sending; k++)
+		cells[ranking[k]]->saveNetwork(out);
+
+	vector<Snapshot> in;
+	if(!transport->exchange(dests, out, sources, in)){
+		t.trace("error","Island %d: migration failed, continuing without it\n", transport->getIsland());
+		transport = 0;
+		return;
+	}
+
+	//the worst cells are replaced first
+	int slot = n - 1;
+	int accepted = 0;
+	for(unsigned int m = 0; m < in.size(); m++){
+		int count = in[m].getInt();
+		for(int k = 0; k < count && slot >= sending; k++){
+			if(!cells[ranking[slot]]->loadNetwork(in[m])){
+				t.trace("error","Island %d: truncated migrants from island %d\n", transport->getIsland(), sources[m]);
+				break;
+			}
+			slot--;
+			accepted++;
+		}
+	}
+
+	t.trace("gens","Island %d sent %d Cells to %d islands and accepted %d\n", transport->getIsland(), sending, (int)dests.size(), accepted);
+}
+
+/**
+ * void Experiment::setThreadPool(ThreadPool*)
+ *
+ * Process the cells of each generation as tasks of a thread pool. The results are the same as without the pool.
+ *
+ * @param p the pool, which must outlive the experiment's run (null to process the cells on the calling thread)
+ */
+void Experiment::setThreadPool(ThreadPool* p){
+	pool = p;
+}
+
+/**
+ * void Experiment::setParareal(ThreadPool*)
+ *
+ * Integrate every cell in parallel in time, one time slice on each thread of the pool (see Parareal), so that a few
+ * expensive cells still use every core. The cells themselves are then processed one after the other.
+ *
+ * @param p the pool, which must outlive the experiment's run (null to integrate the cells serially)
+ */
+void Experiment::setParareal(ThreadPool* p){
+
+	slicePool = p;
+	for(unsigned int c = 0; c < cells.size(); c++)
+		cells[c]->setParareal(slicePool);
+}
+
+/**
+ * void Experiment::setNetworkThreads(int)
+ *
+ * Let the cells share the evaluation of the rate laws of their network among threads, where the network is large
+ * enough to gain from it (see KineticsTeam). The teams are started for each integration, next to the threads
+ * processing the cells, so a few cells with large networks can use every core.
+ *
+ * @param n the largest number of threads evaluating one network
+ */
+void Experiment::setNetworkThreads(int n){
+
+	networkThreads = n;
+	for(unsigned int c = 0; c < cells.size(); c++)
+		cells[c]->setNetworkThreads(networkThreads);
+}
+
+/**
+ * void Experiment::setComponentCache(ComponentCache*)
+ *
+ * Let the cells take the solution of every part of their network which a cell integrated before from the cache, and
+ * integrate only the parts a mutation changed (see ComponentCache). The solutions are the same as without the cache.
+ *
+ * @param c the cache, which must outlive the experiment's run (null to integrate every part)
+ */
+void Experiment::setComponentCache(ComponentCache* c){
+
+	componentCache = c;
+	for(unsigned int i = 0; i < cells.size(); i++)
+		cells[i]->setComponentCache(componentCache);
+}
+
+/**
+ * int Experiment::getCellCost(int)
+ *
+ * Estimate the cost of processing a cell. Evaluation dominates, and each Runge-Kutta step visits every interaction,
+ * so the number of interactions of the network before the mutation is used.
+ *
+ * @param c the index of the cell
+ *
+ * @return the estimated cost, in interactions
+ */
+int Experiment::getCellCost(int c){
+	return cells[c]->getArcCount();
+}
+
+/**
+ * void Experiment::processCellTask(void*, int)
+ *
+ * Task body for the thread pool: process one cell. Also used by sweeps, whose batches hold the cells of several
+ * experiments.
+ *
+ * @param experiment the Experiment
+ * @param c the index of the cell
+ */
+void Experiment::processCellTask(void* experiment, int c){
+	((Experiment*)experiment)->processCell(c);
+}
+
 /**
  * Experiment::start()
  *
@@ -136,104 +762,44 @@ void Experiment::start()
 	t.trace("args","Graphviz: %d\n",graphviz_enabled);
 	t.trace("args","Gnuplot: %d\n", gnuplot_enabled);
 
-	int bestScore = -1;
-	Cell* bestCell = 0;
+	vector<Task> tasks;
+	vector<double> busy, util;
 
 	//generational loop
-	for(int i = 1; i <= maxGenerations; i++)
+	for(int i = startGeneration; i <= maxGenerations; i++)
 	{
-		bestScore = -1;
-		bestCell = 0;
-		
-		t.trace("gens","Generation %d started (max %d)\n",i, maxGenerations);
-		for(unsigned int c = 0; c < cells.size(); c++)
-		{
-			t.trace("mutate","Gen %-3d Cell loc %p\n", i, cells[c]);
-			//mutate
-			cells[c]->mutate();
-			
-			//find the best cell
-			//if scoring interval is 5, this runs every 5 generations
-			if(i % scoringInterval == 0){
-				
-					
-			if(rungeKutta)	
-				cells[c]->rk();
+		beginGeneration(i);
 
-			if(gillespie)
-				cells[c]->stochasticSim();
-				
-				
-				
-				
-				if(cells[c]->getScore() < -1  ){
-					cells[c]->outputDataPlot(prefix, pid);
-					cells[c]->outputDotImage(prefix, pid);
-				}	
-
-				//keep track of the cell with the highest score so far
-				if(cells[c]->getScore() > bestScore){
-					bestCell = cells[c];
-					bestScore = bestCell->getScore();
-					t.trace("score","Best cell is cell %d with score %d\n",bestCell->getID(), bestCell->getScore());
-				}		
-			}	
-
-			//if the flag is set, generate output for every cell during every generation
-			//this will significantly increase the runtime of the simulation
-			if(output_each_gen){
-				
-				
-				// if the flag is set to perform deterministic calculations, simulate the cell using runge kutta	
-				if(rungeKutta){
-					cells[c]->rk();
-
-					if(graphviz_enabled)
-						cells[c]->outputDotImage(prefix, pid);
-					if(gnuplot_enabled)
-						cells[c]->outputDataPlot(prefix, pid);
-					if(output_csv_data)
-						cells[c]->outputDataCsv(prefix, pid);
-					if(output_csv_interactions)
-						cells[c]->outputInteractionCsv(prefix, pid);
-				}
-	
+		if(pool){
+			//the largest networks are started first
+			tasks.clear();
+			for(unsigned int c = 0; c < cells.size(); c++){
+				Task task = { processCellTask, this, (int)c, getCellCost(c) };
+				tasks.push_back(task);
+			}
 
-				// if the flag is set to perform stochastic calculatoins, simulate the cell using gillepsie algorithm
-				if(gillespie){
-					cells[c]->stochasticSim();
-
-					if(graphviz_enabled)
-						cells[c]->outputDotImage(prefix, pid);
-					if(gnuplot_enabled)
-						cells[c]->outputDataPlot(prefix, pid);
-					if(output_csv_data)
-						cells[c]->outputDataCsv(prefix, pid);
-					if(output_csv_interactions)
-						cells[c]->outputInteractionCsv(prefix, pid);
-				}
-		}
-	}
-		//TODO: fix this if gillespie and rk are both being used
-		
+			int n = pool->getThreadCount();
+			busy.resize(n);
+			for(int w = 0; w < n; w++)
+				busy[w] = pool->getBusyTime(w);
+			double wall = pool->getRunTime();
 
-		//if the scoring interval is 5, this runs every 5 generations
-		if(i % scoringInterval == 0){
-			
-			//all cells have been checked, so the bestCell variable holds the cell with the highest score
-			t.trace("score","Best cell at end of Generation %d is cell %d with score %d\n", i, bestCell->getID(), bestCell->getScore());
-			
-			//output the best cell
-			if(graphviz_enabled)
-				bestCell->outputDotImage(prefix, pid);
-			if(gnuplot_enabled)
-				bestCell->outputDataPlot(prefix, pid);
-			if(output_csv_data)	
-				bestCell->outputDataCsv(prefix, pid);
-			if(output_csv_interactions)
-				bestCell->outputInteractionCsv(prefix, pid);
+			pool->run(tasks);
+
+			//fraction of the generation each worker spent processing cells
+			wall = pool->getRunTime() - wall;
+			util.resize(n);
+			for(int w = 0; w < n; w++)
+				util[w] = wall > 0 ? (pool->getBusyTime(w) - busy[w]) / wall : 0;
+			if(summary)
+				summary->setUtilization(util);
 		}
-		t.trace("gens","Generation %d finished (max %d)\n",i, maxGenerations);
+		else{
+			for(unsigned int c = 0; c < cells.size(); c++)
+				processCell(c);
+		}
+
+		endGeneration(i);
 	}
 	
 	return;
@@ -250,3 +816,220 @@ void Experiment::start()
 
 }
 
+/**
+ * void Experiment::beginGeneration(int)
+ *
+ * Start a generation. processCell must then be called once for every cell.
+ *
+ * @param gen the generation number
+ */
+void Experiment::beginGeneration(int gen){
+
+	t.trace("gens","Generation %d started (max %d)\n",gen, maxGenerations);
+
+	currentGeneration = gen;
+	results.resize(cells.size());
+
+	if(summary)
+		summary->beginGeneration(gen);
+}
+
+/**
+ * void Experiment::processCell(int)
+ *
+ * Mutate a single cell, and on scoring generations evaluate and score it. Per-cell output is written if enabled.
+ *
+ * Only the cell itself and its entry in the results are changed, so different cells can be processed on different
+ * threads at the same time. Networks shared by several cells are locked by the cells while they use them.
+ *
+ * @param c the index of the cell
+ */
+void Experiment::processCell(int c){
+
+	CellResult& res = results[c];
+	double timer;
+
+	t.trace("mutate","Gen %-3d Cell loc %p\n", currentGeneration, cells[c]);
+
+	//mutate
+	timer = Summary::now();
+	res.mutation = cells[c]->mutate();
+	res.mutateTime = Summary::now() - timer;
+	res.nodes = cells[c]->getNodeCount();
+	res.arcs = cells[c]->getArcCount();
+
+	res.score = -1;
+	res.screened = 0;
+	res.evalTime = 0;
+
+	//if scoring interval is 5, this runs every 5 generations
+	if(currentGeneration % scoringInterval == 0){
+
+		timer = Summary::now();
+
+		if(prefilter)
+			res.screened = !cells[c]->hasFeedback();
+		if(hopf && !res.screened)
+			res.screened = cells[c]->isStable();
+		cells[c]->setRejected(res.screened);
+
+		if(rungeKutta && !res.screened){
+			cells[c]->rk();
+			if(guided)
+				cells[c]->sensitivityAnalysis();
+		}
+
+		if(gillespie && !res.screened)
+			cells[c]->stochasticSim();
+
+		res.evalTime = Summary::now() - timer;
+		res.score = cells[c]->getScore();
+
+		if(res.score < -1){
+			makeCellDirectory(c);
+			cells[c]->outputDataPlot(prefix, pid);
+			cells[c]->outputDotImage(prefix, pid);
+		}
+	}
+
+	//if the flag is set, generate output for every cell during every generation
+	//this will significantly increase the runtime of the simulation
+	if(output_each_gen){
+
+		makeCellDirectory(c);
+
+		// if the flag is set to perform deterministic calculations, simulate the cell using runge kutta	
+		if(rungeKutta){
+			cells[c]->rk();
+
+			if(graphviz_enabled)
+				cells[c]->outputDotImage(prefix, pid);
+			if(gnuplot_enabled)
+				cells[c]->outputDataPlot(prefix, pid);
+			if(output_csv_data)
+				cells[c]->outputDataCsv(prefix, pid);
+			if(output_csv_interactions)
+				cells[c]->outputInteractionCsv(prefix, pid);
+			if(output_lgf)
+				cells[c]->outputLgf(prefix, pid);
+		}
+
+		// if the flag is set to perform stochastic calculatoins, simulate the cell using gillepsie algorithm
+		if(gillespie){
+			cells[c]->stochasticSim();
+
+			if(graphviz_enabled)
+				cells[c]->outputDotImage(prefix, pid);
+			if(gnuplot_enabled)
+				cells[c]->outputDataPlot(prefix, pid);
+			if(output_csv_data)
+				cells[c]->outputDataCsv(prefix, pid);
+			if(output_csv_interactions)
+				cells[c]->outputInteractionCsv(prefix, pid);
+		}
+	}
+}
+
+/**
+ * void Experiment::endGeneration(int)
+ *
+ * Finish a generation once every cell has been processed. The results of the cells are added to the summary in
+ * population order, so the records do not depend on the order the cells were processed in. On scoring generations
+ * the best cell is output and selection is run. Migration and checkpoints follow.
+ *
+ * @param gen the generation number
+ */
+void Experiment::endGeneration(int gen){
+
+	int bestScore = -1;
+	int best = -1;
+	double timer = 0;
+
+	int scoring = (gen % scoringInterval == 0);
+
+	for(unsigned int c = 0; c < cells.size(); c++){
+
+		CellResult& res = results[c];
+
+		if(summary){
+			summary->addMutation(res.mutation);
+			summary->addTime(Summary::TIME_MUTATE, res.mutateTime);
+			summary->addNetwork(res.nodes, res.arcs);
+			if(scoring){
+				summary->addTime(Summary::TIME_EVAL, res.evalTime);
+				summary->addScore(cells[c]->getID(), res.score);
+				if(prefilter || hopf)
+					summary->addScreened(res.screened);
+			}
+		}
+
+		//keep track of the cell with the highest score so far
+		if(scoring && res.score > bestScore){
+			best = c;
+			bestScore = res.score;
+			t.trace("score","Best cell is cell %d with score %d\n",cells[c]->getID(), bestScore);
+		}
+	}
+
+	//TODO: fix this if gillespie and rk are both being used
+
+	//if the scoring interval is 5, this runs every 5 generations
+	if(scoring && best >= 0){
+
+		Cell* bestCell = cells[best];
+		
+		//all cells have been checked, so the bestCell variable holds the cell with the highest score
+		t.trace("score","Best cell at end of Generation %d is cell %d with score %d\n", gen, bestCell->getID(), bestScore);
+		
+		if(summary)
+			timer = Summary::now();
+
+		if(graphviz_enabled || gnuplot_enabled || output_csv_data || output_csv_interactions || output_lgf)
+			makeCellDirectory(best);
+
+		//a screened cell was not solved, which the output needs
+		if(results[best].screened && (gnuplot_enabled || output_csv_data)){
+			if(rungeKutta)
+				bestCell->rk();
+			if(gillespie)
+				bestCell->stochasticSim();
+		}
+
+		//output the best cell
+		if(graphviz_enabled)
+			bestCell->outputDotImage(prefix, pid);
+		if(gnuplot_enabled)
+			bestCell->outputDataPlot(prefix, pid);
+		if(output_csv_data)	
+			bestCell->outputDataCsv(prefix, pid);
+		if(output_csv_interactions)
+			bestCell->outputInteractionCsv(prefix, pid);
+		if(output_lgf)
+			bestCell->outputLgf(prefix, pid);
+
+		if(summary)
+			summary->addTime(Summary::TIME_OUTPUT, Summary::now() - timer);
+
+		//replace low scoring cells with copies of high scoring ones
+		if(selectionMode != SELECT_NONE){
+			if(summary)
+				timer = Summary::now();
+
+			select();
+
+			if(summary)
+				summary->addTime(Summary::TIME_SELECT, Summary::now() - timer);
+		}
+	}
+
+	if(summary)
+		summary->endGeneration();
+
+	if(transport && migrationInterval > 0 && gen % migrationInterval == 0)
+		migrate();
+
+	if(checkpoint && gen % checkpointInterval == 0)
+		saveCheckpoint(gen);
+
+	t.trace("gens","Generation %d finished (max %d)\n",gen, maxGenerations);
+}
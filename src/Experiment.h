@@ -17,24 +17,112 @@
 #include <vector>
 #include <fstream>
 #include "Cell.h"
+#include "Summary.h"
+#include "Checkpoint.h"
+#include "Island.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
+// selection modes for Experiment::setSelection
+enum SelectionMode{
+	SELECT_NONE = 0,
+	SELECT_TOURNAMENT,
+	SELECT_TRUNCATION,
+	SELECT_PROPORTIONAL
+};
 
 class Experiment {
 public:
-	Experiment(int ncells, int generations, int max_basic, int max_ptm, int max_comp, int max_prom, float min_kinetic_rate, float max_kinetic_rate, float rk_time_limit, float rk_time_step, float initial_conc, int rk_enabled, int gillespie_enabled);
+	Experiment(int ncells, int generations, int max_basic, int max_ptm, int max_comp, int max_prom, float min_kinetic_rate, float max_kinetic_rate, float rk_time_limit, float rk_time_step, float initial_conc, int hill_coefficient, int rk_enabled, int gillespie_enabled);
 	~Experiment();
 
 	void start();
+
+	// the phases of one generation, run by start(). Cells can be processed in any order and on any thread,
+	// between beginGeneration and endGeneration
+	void beginGeneration(int);
+	void processCell(int);
+	void endGeneration(int);
+
+	// ThreadPool task body calling processCell, with the Experiment as data and the cell as index
+	static void processCellTask(void*, int);
+
+	int getCellCount(){ return cells.size(); };
+	int getCellCost(int);
+	int getStartGeneration(){ return startGeneration; };
+	int getMaxGenerations(){ return maxGenerations; };
+	void getOutputPath(const char*, char*, size_t);
 	
 	//set commandline output options
-	void setOutputOptions(int, int, int, int, int, int);
+	void setOutputOptions(int, int, int, int, int, int, int, int);
+
+	// write the summary records to a stream shared with other experiments
+	void setSummaryStream(FILE*, const char*);
+
+	// seed the population with a known network
+	int seedFrom(const char*, float);
+
+	// checkpoint / restart
+	void setCheckpointInterval(int);
+	int resume(const char*);
+
+	// selection and reproduction
+	void setSelection(int, int, int);
+	void setGuidedMutation(int);
+	void setScoring(int);
+	void setCycleDetection(int);
+	void setIntegrator(int);
+	void setPrefilter(int);
+	void setHopfScreen(int);
+
+	// island model
+	void setMigration(Transport*, int, int, int);
+
+	// process the cells of each generation on a pool of threads
+	void setThreadPool(ThreadPool*);
+
+	// integrate each cell in parallel in time on a pool of threads
+	void setParareal(ThreadPool*);
+
+	// share the evaluation of the rate laws of large networks among threads
+	void setNetworkThreads(int);
+
+	// look up the solutions of parts of networks integrated before
+	void setComponentCache(ComponentCache*);
 private:
+	// the tests in tests/ rank, select and compare the cells directly
+	friend class ScreenedSelection;
+	friend class ResumeCheckpoint;
+
+	void saveCheckpoint(int);
+	void rankCells(vector<int>&, vector<int>&);
+	int pickParent(vector<int>&, vector<int>&, int);
+	void select();
+	void migrate();
+	void makeCellDirectory(int);
+
 	vector<Cell*> cells;
 
+	// results of processCell, collected by endGeneration
+	struct CellResult{
+		int mutation;
+		int score;
+		int screened;
+		int nodes;
+		int arcs;
+		double mutateTime;
+		double evalTime;
+	};
+	vector<CellResult> results;
+	int currentGeneration;
+
+	// output directories are only created for cells which write output
+	vector<char> madeDirectory;
+
 	// default cell properties
 	int maxGenerations;
+	int startGeneration;
 	int numCells;
 	int maxBasic;
 	int maxPTM;
@@ -52,6 +140,7 @@ private:
 
 	// default molecule properties
 	float initialConc;
+	int hill;
 
 	// output directory prefix (prefix/pid/<outputgoeshere>)
 	const char* prefix;
@@ -63,10 +152,62 @@ private:
         int output_each_gen;
 	int output_csv_interactions;
 	int output_csv_data;
+	int output_lgf;
+
+	// per-generation population summary stream (null if disabled)
+	Summary* summary;
+
+	// periodic checkpoints (null if disabled)
+	Checkpoint* checkpoint;
+	int checkpointInterval;
 	
 	int rungeKutta;
 	int gillespie;
 
+	// selection options
+	int selectionMode;
+	int elitism;
+	int tournamentSize;
+
+	// rate mutations favor the rates the amplitude of the best molecule is most sensitive to
+	int guided;
+
+	// ScoreMethod of the cells
+	int scoring;
+
+	// consistent periods which stop the integration of a cell early (0 if disabled)
+	int cycleDetection;
+
+	// IntegratorMethod of the cells
+	int integrator;
+
+	// cells without a feedback loop are given a score of 0 without being evaluated
+	int prefilter;
+
+	// cells settling to a stable steady state are given a score of 0 without being evaluated
+	int hopf;
+
+	// random generator used by selection, saved with checkpoints
+	MTRand r;
+
+	// island model migration (transport is null if this is the only island)
+	Transport* transport;
+	int migrationInterval;
+	int migrants;
+	int topology;
+
+	// threads processing the cells (null to process them on the calling thread)
+	ThreadPool* pool;
+
+	// threads integrating the time slices of each cell (null to integrate the cells serially)
+	ThreadPool* slicePool;
+
+	// threads evaluating the rate laws of a large network together
+	int networkThreads;
+
+	// solutions of parts of networks shared by the cells (null to integrate every part)
+	ComponentCache* componentCache;
+
 	// unused ?
 	int numHighScores;
 };
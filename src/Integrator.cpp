@@ -0,0 +1,443 @@
+/**
+ * Integrator.cpp
+ *
+ * Runge-Kutta and Lawson timesteps of the rate equations compiled by Kinetics.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "Integrator.h"
+#include "SteadyState.h"
+
+#include "ExternTrace.h"
+
+// terms of the Taylor series of the matrix exponential, after scaling the matrix below a norm of 1/2
+#define EXPONENTIAL_TERMS 12
+
+// smallest ratio between the decay rates of the fast and the slow molecules of the quasi-steady-state reduction
+#define QSSA_SEPARATION 10
+
+// Newton iterations solving for the quasi-steady state, and the relative change at which they stop
+#define QSSA_ITERATIONS 20
+#define QSSA_TOLERANCE 1e-6
+
+/**
+ * Integrator::Integrator(Kinetics&, const vector<float>&, int)
+ *
+ * @param k the compiled reactions of the network
+ * @param nodeScale the factor each concentration is multiplied by before the rate laws see it
+ * @param m the IntegratorMethod
+ */
+Integrator::Integrator(Kinetics& k, const vector<float>& nodeScale, int m){
+
+	kinetics = &k;
+	method = m;
+	nodes = k.getNodeCount();
+	scale = nodeScale;
+
+	//the linear part of the rate laws, in terms of the concentrations they see
+	linear.resize(nodes * nodes);
+	if(nodes > 0)
+		kinetics->getLinearPart(&linear[0]);
+	for(int i = 0; i < nodes; i++)
+		for(int j = 0; j < nodes; j++)
+			linear[i * nodes + j] *= scale[j];
+
+	factorStep = 0;
+
+	x.resize(nodes);
+	flux.resize(k.getReactionCount() + 1);
+	stage.resize(nodes);
+	sum.resize(nodes);
+	product.resize(nodes);
+	k1.resize(nodes);
+	k2.resize(nodes);
+	k3.resize(nodes);
+	k4.resize(nodes);
+
+	if(method == INTEGRATE_QSSA)
+		selectFast();
+}
+
+/**
+ * float Integrator::getFastestDecay()
+ *
+ * @return the largest rate at which a molecule is used up by the linear reactions
+ */
+float Integrator::getFastestDecay(){
+
+	double fastest = 0;
+	for(int n = 0; n < nodes; n++)
+		if(-linear[n * nodes + n] > fastest)
+			fastest = -linear[n * nodes + n];
+	return fastest;
+}
+
+/**
+ * void Integrator::selectFast()
+ *
+ * Choose the fast molecules of the quasi-steady-state reduction. Sorting the decay rates from the fastest, every gap
+ * of at least QSSA_SEPARATION is a candidate, the widest first. The molecules above it are fast if they also relax
+ * together QSSA_SEPARATION times faster than the slow ones decay: the fast molecules feeding each other (a complex
+ * breaking up into the proteins it is made of) may relax much slower than each of them decays. 1 / |L_FF^-1| bounds
+ * the slowest relaxation rate from below. Molecules which the linear reactions do not use up are slow.
+ */
+void Integrator::selectFast(){
+
+	vector<pair<double, int> > decay;
+	for(int n = 0; n < nodes; n++)
+		if(linear[n * nodes + n] < 0)
+			decay.push_back(make_pair(-linear[n * nodes + n], n));
+	sort(decay.rbegin(), decay.rend());
+
+	//the gaps, by the number of molecules above them
+	vector<pair<double, int> > gaps;
+	for(unsigned int i = 0; i + 1 < decay.size(); i++)
+		if(decay[i].first >= QSSA_SEPARATION * decay[i + 1].first)
+			gaps.push_back(make_pair(decay[i].first / decay[i + 1].first, i + 1));
+	sort(gaps.rbegin(), gaps.rend());
+
+	for(unsigned int g = 0; g < gaps.size(); g++){
+
+		fast.clear();
+		for(int i = 0; i < gaps[g].second; i++)
+			fast.push_back(decay[i].second);
+		sort(fast.begin(), fast.end());
+
+		if(invertFast() >= QSSA_SEPARATION * decay[gaps[g].second].first)
+			return;
+	}
+
+	fast.clear();
+	fastInverse.clear();
+}
+
+/**
+ * double Integrator::invertFast()
+ *
+ * Invert L restricted to the fast molecules, column by column.
+ *
+ * @return the lower bound 1 / |L_FF^-1| (infinity norm) on the slowest relaxation rate of the fast molecules, 0 if
+ * L_FF is singular
+ */
+double Integrator::invertFast(){
+
+	int m = fast.size();
+	fastInverse.assign(m * m, 0);
+
+	for(int j = 0; j < m; j++){
+		vector<double> a(m * m), b(m, 0);
+		for(int r = 0; r < m; r++)
+			for(int c = 0; c < m; c++)
+				a[r * m + c] = linear[fast[r] * nodes + fast[c]];
+		b[j] = 1;
+
+		if(!SteadyState::linearSolve(a, b, m))
+			return 0;
+		for(int r = 0; r < m; r++)
+			fastInverse[r * m + j] = b[r];
+	}
+
+	double norm = 0;
+	for(int r = 0; r < m; r++){
+		double row = 0;
+		for(int c = 0; c < m; c++)
+			row += fabs(fastInverse[r * m + c]);
+		if(row > norm)
+			norm = row;
+	}
+	return norm > 0 ? 1 / norm : 0;
+}
+
+/**
+ * void Integrator::quasiSteady(float*)
+ *
+ * Solve for the concentrations of the fast molecules at which they stop changing, given the slow ones. The Newton
+ * iterations use L restricted to the fast molecules as the Jacobian, which misses only the nonlinear reactions, and
+ * start from the current concentrations, the quasi-steady state of the last stage.
+ *
+ * @param c the concentration of every node, by node id, of which the fast ones are replaced
+ */
+void Integrator::quasiSteady(float* c){
+
+	int m = fast.size();
+	if(m == 0)
+		return;
+
+	for(int i = 0; i < QSSA_ITERATIONS; i++){
+
+		rate(c, &product[0]);
+
+		double change = 0;
+		for(int r = 0; r < m; r++){
+			double d = 0;
+			for(int j = 0; j < m; j++)
+				d -= fastInverse[r * m + j] * product[fast[j]];
+			sum[r] = d;
+		}
+		for(int r = 0; r < m; r++){
+			float next = c[fast[r]] + sum[r];
+			if(next < 0)
+				next = 0;
+			double e = fabs(next - c[fast[r]]) / (1 + fabs(c[fast[r]]));
+			if(e > change)
+				change = e;
+			c[fast[r]] = next;
+		}
+
+		if(change <= QSSA_TOLERANCE)
+			break;
+	}
+}
+
+/**
+ * void Integrator::reduced(float*, float*)
+ *
+ * The rate of change of the reduced system: the fast molecules are moved to their quasi-steady state first, and
+ * do not change.
+ *
+ * @param c the concentration of every node, by node id, of which the fast ones are replaced
+ * @param dc filled with the rate of change of every node
+ */
+void Integrator::reduced(float* c, float* dc){
+
+	quasiSteady(c);
+	rate(c, dc);
+	for(unsigned int r = 0; r < fast.size(); r++)
+		dc[fast[r]] = 0;
+}
+
+/**
+ * void Integrator::rate(const float*, float*)
+ *
+ * The fluxes are kept apart from those of Kinetics::evaluate(), so that integrators of the same network may step at
+ * the same time (see Parareal).
+ *
+ * @param c the concentration of every node, by node id
+ * @param dc filled with the rate of change of every node
+ */
+void Integrator::rate(const float* c, float* dc){
+
+	for(int n = 0; n < nodes; n++)
+		x[n] = c[n] > 0 ? c[n] * scale[n] : 0;
+
+	kinetics->getFlux(&x[0], &flux[0]);
+	kinetics->scatter(&flux[0], dc);
+}
+
+/**
+ * void Integrator::remainder(const float*, float*)
+ *
+ * Molecules used up while they are empty are held at 0, as the clamping of every Runge-Kutta step does. Otherwise
+ * the linear part would carry their negative concentrations within a step on to the molecules they make.
+ *
+ * @param c the concentration of every node, by node id
+ * @param nc filled with the rate of change of every node, without the linear part
+ */
+void Integrator::remainder(const float* c, float* nc){
+
+	rate(c, nc);
+	for(int i = 0; i < nodes; i++){
+		double s = c[i] <= 0 && nc[i] < 0 ? 0 : nc[i];
+		for(int j = 0; j < nodes; j++)
+			if(c[j] > 0)
+				s -= linear[i * nodes + j] * c[j];
+		nc[i] = s;
+	}
+}
+
+/**
+ * void Integrator::multiply(const vector<double>&, const float*, float*)
+ *
+ * @param a a matrix of the size of the network, row by row
+ * @param v a concentration vector
+ * @param av filled with the product, not v
+ */
+void Integrator::multiply(const vector<double>& a, const float* v, float* av){
+
+	for(int i = 0; i < nodes; i++){
+		double s = 0;
+		for(int j = 0; j < nodes; j++)
+			s += a[i * nodes + j] * v[j];
+		av[i] = s;
+	}
+}
+
+/**
+ * static void Integrator::exponential(const vector<double>&, double, vector<double>&, int)
+ *
+ * The matrix exponential by scaling and squaring: the Taylor series of e^(a t / 2^s), squared s times.
+ *
+ * @param a the matrix, row by row
+ * @param time the factor t
+ * @param e filled with e^(a t)
+ * @param m the size of the matrix
+ */
+void Integrator::exponential(const vector<double>& a, double time, vector<double>& e, int m){
+
+	double norm = 0;
+	for(int i = 0; i < m; i++){
+		double row = 0;
+		for(int j = 0; j < m; j++)
+			row += fabs(a[i * m + j] * time);
+		if(row > norm)
+			norm = row;
+	}
+
+	int squarings = 0;
+	while(norm > .5){
+		norm /= 2;
+		squarings++;
+	}
+	double t = time / pow(2.0, squarings);
+
+	//e = I + b + b^2/2 + ..., with b = a t
+	vector<double> term(m * m, 0), next(m * m);
+	e.assign(m * m, 0);
+	for(int i = 0; i < m; i++){
+		term[i * m + i] = 1;
+		e[i * m + i] = 1;
+	}
+	for(int k = 1; k <= EXPONENTIAL_TERMS; k++){
+		for(int i = 0; i < m; i++)
+			for(int j = 0; j < m; j++){
+				double s = 0;
+				for(int l = 0; l < m; l++)
+					s += term[i * m + l] * a[l * m + j];
+				next[i * m + j] = s * t / k;
+			}
+		term.swap(next);
+		for(int i = 0; i < m * m; i++)
+			e[i] += term[i];
+	}
+
+	for(int q = 0; q < squarings; q++){
+		for(int i = 0; i < m; i++)
+			for(int j = 0; j < m; j++){
+				double s = 0;
+				for(int l = 0; l < m; l++)
+					s += e[i * m + l] * e[l * m + j];
+				next[i * m + j] = s;
+			}
+		e.swap(next);
+	}
+}
+
+/**
+ * void Integrator::setStep(float)
+ *
+ * @param h the timestep the matrices of the linear part are computed for
+ */
+void Integrator::setStep(float h){
+
+	if(h == factorStep)
+		return;
+	factorStep = h;
+
+	if(method != INTEGRATE_LAWSON)
+		return;
+
+	//e^(L h) = e^(L h/2) e^(L h/2)
+	exponential(linear, h / 2, half, nodes);
+	full.assign(nodes * nodes, 0);
+	for(int i = 0; i < nodes; i++)
+		for(int l = 0; l < nodes; l++)
+			for(int j = 0; j < nodes; j++)
+				full[i * nodes + j] += half[i * nodes + l] * half[l * nodes + j];
+}
+
+/**
+ * void Integrator::step(float*, float)
+ *
+ * Advance the concentrations by one timestep. As with Molecule::nextPoint, negative concentrations are set to 0.
+ *
+ * @param c the concentration of every node, by node id, replaced by the one a timestep later
+ * @param h the timestep
+ */
+void Integrator::step(float* c, float h){
+
+	if(nodes == 0)
+		return;
+
+	setStep(h);
+
+	int n;
+	switch(method){
+	case INTEGRATE_LAWSON:
+		remainder(c, &k1[0]);
+		for(n = 0; n < nodes; n++)
+			sum[n] = c[n] + h / 2 * k1[n];
+		multiply(half, &sum[0], &stage[0]);
+
+		remainder(&stage[0], &k2[0]);
+		multiply(half, c, &sum[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = sum[n] + h / 2 * k2[n];
+
+		remainder(&stage[0], &k3[0]);
+		multiply(half, &k3[0], &product[0]);
+		multiply(full, c, &sum[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = sum[n] + h * product[n];
+
+		remainder(&stage[0], &k4[0]);
+
+		//e^(L h) (c + h/6 k1) + e^(L h/2) h/3 (k2 + k3) + h/6 k4
+		for(n = 0; n < nodes; n++){
+			stage[n] = c[n] + h / 6 * k1[n];
+			k2[n] += k3[n];
+		}
+		multiply(full, &stage[0], &sum[0]);
+		multiply(half, &k2[0], &product[0]);
+		for(n = 0; n < nodes; n++)
+			c[n] = sum[n] + h / 3 * product[n] + h / 6 * k4[n];
+		break;
+
+	case INTEGRATE_QSSA:
+		reduced(c, &k1[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = c[n] + h / 2 * k1[n];
+
+		reduced(&stage[0], &k2[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = c[n] + h / 2 * k2[n];
+
+		reduced(&stage[0], &k3[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = c[n] + h * k3[n];
+
+		reduced(&stage[0], &k4[0]);
+		for(n = 0; n < nodes; n++){
+			c[n] += h / 6 * (k1[n] + 2 * k2[n] + 2 * k3[n] + k4[n]);
+			if(c[n] < 0)
+				c[n] = 0;
+		}
+
+		//the fast molecules follow the slow ones to the end of the step
+		quasiSteady(c);
+		break;
+
+	default:
+		rate(c, &k1[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = c[n] + h / 2 * k1[n];
+
+		rate(&stage[0], &k2[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = c[n] + h / 2 * k2[n];
+
+		rate(&stage[0], &k3[0]);
+		for(n = 0; n < nodes; n++)
+			stage[n] = c[n] + h * k3[n];
+
+		rate(&stage[0], &k4[0]);
+		for(n = 0; n < nodes; n++)
+			c[n] += h / 6 * (k1[n] + 2 * k2[n] + 2 * k3[n] + k4[n]);
+		break;
+	}
+
+	for(n = 0; n < nodes; n++)
+		if(c[n] < 0)
+			c[n] = 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * Integrator.h
+ *
+ * Timestepping of the rate equations of a network that treats the linear reactions exactly.
+ *
+ * Most reactions are linear in the molecule they use up (transcription, translation, degradation, PTM, the breakup of
+ * complexes, promoter release), and with high kinetic rates they limit the timestep of plain Runge-Kutta to about
+ * 2.8 / rate. Splitting the rate of change of the concentrations into L x, with L from Kinetics::getLinearPart(),
+ * and the rest N(x) (complexation, repression and promoter binding), the linear part can be solved exactly while
+ * only N is evaluated by Runge-Kutta:
+ *   INTEGRATE_RK4     plain fourth order Runge-Kutta, as Molecule does it, for comparison
+ *   INTEGRATE_LAWSON  fourth order Runge-Kutta on e^(-L t) x (Lawson's integrating factor method). Each step
+ *                     costs the same four evaluations as Runge-Kutta, and the linear reactions never make it
+ *                     unstable, however fast they are
+ *   INTEGRATE_QSSA    Runge-Kutta on the slow molecules only, with the fast ones held at their quasi-steady state
+ *
+ * The quasi-steady-state reduction picks the molecules used up by the linear reactions much faster than the others
+ * (mRNA and complexes with high degradation or breakup rates): sorting the decay rates, the fast molecules are those
+ * above the widest gap of at least QSSA_SEPARATION which also relax together that much faster. Their rate of change
+ * is set to 0 and solved for their concentrations, given the slow ones, by Newton iterations with L restricted to the
+ * fast molecules as the Jacobian, at every Runge-Kutta stage and after every step, so every step gives the
+ * concentrations of all molecules. The timestep then only has to follow the slow molecules, and the error of the
+ * reduction is about the ratio of the slow and fast decay rates (DerivGraph::stepBenchmark reports it against the
+ * full model).
+ *
+ * e^(L h) and e^(L h/2) are dense matrices, computed once for each timestep length, which is cheap for networks of a
+ * few dozen molecules. Near molecules emptied by the clamping at 0 the method is only first order, as Runge-Kutta is.
+ *
+ * The state is the concentration of every molecule as Molecule integrates it; the rate laws see it multiplied by a
+ * scale (see SteadyState), and never negative.
+ *
+ */
+
+#ifndef INTEGRATOR_H_
+#define INTEGRATOR_H_
+
+#include <vector>
+
+#include "Kinetics.h"
+
+using namespace std;
+
+// integration methods of DerivGraph::rungeKuttaEvaluate (Experiment::setIntegrator)
+enum IntegratorMethod{
+	INTEGRATE_RK4 = 0,
+	INTEGRATE_LAWSON,
+	INTEGRATE_QSSA
+};
+
+class Integrator{
+
+public:
+	Integrator(Kinetics&, const vector<float>&, int);
+
+	void step(float*, float);
+
+	// the fastest decay of a molecule through the linear reactions, which bounds the timestep of plain Runge-Kutta
+	float getFastestDecay();
+
+	// the molecules held at their quasi-steady state by INTEGRATE_QSSA
+	int getFastCount(){ return fast.size(); };
+
+private:
+	void rate(const float*, float*);
+	void remainder(const float*, float*);
+	void multiply(const vector<double>&, const float*, float*);
+	void setStep(float);
+	static void exponential(const vector<double>&, double, vector<double>&, int);
+	void selectFast();
+	double invertFast();
+	void quasiSteady(float*);
+	void reduced(float*, float*);
+
+	Kinetics* kinetics;
+	int method;
+	int nodes;
+
+	vector<float> scale;
+
+	// the linear part, in terms of the concentrations before scaling, row by row
+	vector<double> linear;
+
+	// e^(L h) and e^(L h/2), for the last timestep h
+	float factorStep;
+	vector<double> full;
+	vector<double> half;
+
+	// the fast molecules of INTEGRATE_QSSA, and the inverse of L restricted to them, row by row
+	vector<int> fast;
+	vector<double> fastInverse;
+
+	// work space of step()
+	vector<float> x;
+	vector<float> flux;
+	vector<float> stage;
+	vector<float> sum;
+	vector<float> product;
+	vector<float> k1;
+	vector<float> k2;
+	vector<float> k3;
+	vector<float> k4;
+};
+
+#endif
@@ -4,8 +4,10 @@
  */
 
 #include "Interaction.h"
+#include "Checkpoint.h"
+#include "Arena.h"
 #include <cstdio>
-#include "lemon/list_graph.h"
+#include "lemon/smart_graph.h"
 
 
 #include "ExternTrace.h"
@@ -19,6 +21,7 @@ Interaction::Interaction(){
 	t.trace("init","Creating new Interaction\n");
 	t.trace("mloc","Interaction at location %d\n", this);
         name = "default";	
+	kind = IK_DEFAULT;
 	rate = .05;
 	t.trace("init","New Interaction created\n");
 }
@@ -34,92 +37,17 @@ Interaction::~Interaction(){
 }
 
 /**
- * float Interaction::getEffect(ListDigraph* , NodeMap<Molecule*>* , ArcMap<Interaction*>* , Node , int, float)
+ * Interaction* Interaction::clone(Arena&)
+ * (Virtual function)
  *
- * Get the effect this interaction has on a particular node.
+ * @param a the arena to place the copy in
  *
- * This method defines the behavior of an interaction which connects two molecules. The effect on Node a can be dependent on
- * any other molecule, which can be accessed using the ListDigraph, NodeMap, and ArcMap parameters.
- *
- * Runge-Kutta iteratively approximates the change in concentration during a given timestep. The first iteration is based soley on the current concentration,
- * and each further iteration takes the result of the previous iteration into account. The Runge-Kutta data are stored in each molecule, and it is necessary to
- * call Molecule::rkApprox(stepsize, iteration) rather than Molecule::getValue() to get the current Iteration's approximated concentration. 
- *
- * @param g The graph object containing Node-Node relationships. 
- * @param m The NodeMap object containing Node-Molecule mappings.
- * @param i The ArcMap object containing Arc-Interaction mappings.
- * @param n The Node to calculate the effect for
- * @param rkIter The current iteration of Runge-Kutta [0,3]
- * @param rkStep The stepsize of Runge-Kutta
- *
- */
-float Interaction::getEffect(ListDigraph* g, ListDigraph::NodeMap<Molecule*>* m, ListDigraph::ArcMap<Interaction*>* i, ListDigraph::Node n, int rkIter, float rkStep){	
-	
-	t.trace("efct","Original Node value: %f\n", (*m)[n]->getValue());
-	t.trace("efct","Interaction Rate: %f\n", rate);
-	t.trace("efct","Interaction Dir: %s\n", (g->source(g->arcFromId(arcID)) == n) ? "outgoing" : "incoming");
-	t.trace("efct","Opposite Node value: %f\n", (*m)[g->oppositeNode(n, g->arcFromId(arcID))]->getValue());
-	Molecule* thisMol = (*m)[n];
-	Molecule* oppositeMol = (*m)[g->oppositeNode(n, g->arcFromId(arcID))];
-	
-
-	if(isSourceNode(g, n) == 1)
-		
-		return -1 * thisMol->rkApprox(rkIter, rkStep) * rate;
-	
-	else if(isTargetNode(g, n) == 1)
-		
-		return oppositeMol->rkApprox(rkIter, rkStep) * rate;
-	
-	else{
-		t.trace("error","%s reached error case, not source or target (%p)\n", name, this); 	
-		return 0;
-	}
-
-}
-/*
- * int Interaction::isSourceNode(ListDigraph*, ListDigraph::Node)
- *
- * Helper method to determine whether a particular node is the source or target node in a
- * particular arc.
- *
- * @param g
- * @param n
- *
- * @return 1 if the node is the source, and 0 otherwise.
- */
-int Interaction::isSourceNode(ListDigraph* g, ListDigraph::Node n){
-
-	if(g->source(g->arcFromId(arcID)) == n)
-		return 1;
-	else
-		return 0;
-
-}
-
-
-/*
- * int Interaction::isTargetNode(ListDigraph*, ListDigraph::Node, ListDigraph::Arc)
- *
- * Helper method to determine whether a particular node is the target or source node in a
- * particular arc.
- *
- * @param g
- * @param n
- * @param a
- *
- * @return 1 if the node is the target, -1 if it is the source, and 0 otherwise.
+ * @return a copy of this interaction, which must be destroyed with an explicit destructor call
  */
-int Interaction::isTargetNode(ListDigraph* g, ListDigraph::Node n){
-
-	if(g->target(g->arcFromId(arcID)) == n)
-		return 1;
-	else
-		return 0;
-
+Interaction* Interaction::clone(Arena& a){
+	return new (a) Interaction(*this);
 }
 
-
 /**
  * void Interaction::setRate(float)
  *
@@ -146,3 +74,27 @@ const char* Interaction::getName(){
 	return name;
 
 }
+
+/**
+ * void Interaction::save(Snapshot&)
+ * (Virtual function)
+ *
+ * Serialize the interaction. The kind, source and target are written by the DerivGraph.
+ *
+ * @param s the snapshot to append to
+ */
+void Interaction::save(Snapshot& s){
+	s.putFloat(rate);
+}
+
+/**
+ * void Interaction::load(Snapshot&)
+ * (Virtual function)
+ *
+ * Restore the state written by Interaction::save.
+ *
+ * @param s the snapshot to read from
+ */
+void Interaction::load(Snapshot& s){
+	rate = s.getFloat();
+}
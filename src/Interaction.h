@@ -10,17 +10,34 @@
 #include "Molecule.h"
 #include "CustomMolecules.h"
 
-#include "lemon/list_graph.h"
+#include "lemon/smart_graph.h"
 using namespace lemon; 
 
+class Snapshot;
+class Arena;
+
+// interaction types, used to rebuild a cell from a snapshot
+enum InteractionKind{
+	IK_DEFAULT = 0,
+	IK_TRANSCRIPTION,
+	IK_TRANSLATION,
+	IK_DEGRADATION,
+	IK_FORWARD_COMPLEXATION,
+	IK_REVERSE_COMPLEXATION,
+	IK_FORWARD_PTM,
+	IK_REVERSE_PTM,
+	IK_PROMOTER_BIND
+};
+
 
 class Interaction{
 
 public:
 	Interaction();
-	~Interaction();
+	virtual ~Interaction();
 
-	virtual float getEffect(ListDigraph*, ListDigraph::NodeMap<Molecule*>*, ListDigraph::ArcMap<Interaction*>*, ListDigraph::Node, int, float);
+	// copy of the interaction placed in an arena, used when a DerivGraph is copied
+	virtual Interaction* clone(Arena&);
 
 	const char* getName();
 
@@ -28,8 +45,11 @@ public:
 	virtual	float getRate();
 	const char* name;
 	int arcID;
-	int isSourceNode(ListDigraph*, ListDigraph::Node);
-	int isTargetNode(ListDigraph*, ListDigraph::Node);
+	int kind;
+
+	// serialization
+	virtual void save(Snapshot&);
+	virtual void load(Snapshot&);
 
 protected:
 	float rate;
@@ -0,0 +1,319 @@
+/**
+ * Island.cpp
+ *
+ * Island model transports.
+ *
+ * A SocketTransport forks the islands from the first process and connects every pair of islands with a Unix domain
+ * socket pair. Messages are a 32 bit length followed by the bytes of the Snapshot. All sockets are non-blocking and
+ * an exchange is driven by poll(), so islands sending large messages to each other at the same time can not deadlock.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Island.h"
+
+#include "ExternTrace.h"
+
+/**
+ * void Transport::getNeighbours(int, vector<int>&, vector<int>&)
+ *
+ * List the islands this island sends migrants to and receives migrants from.
+ *
+ * @param topology TOPOLOGY_RING or TOPOLOGY_FULL
+ * @param dests filled with the islands to send to
+ * @param sources filled with the islands to receive from
+ */
+void Transport::getNeighbours(int topology, vector<int>& dests, vector<int>& sources){
+
+	int n = getIslandCount();
+	int i = getIsland();
+
+	dests.clear();
+	sources.clear();
+
+	if(n < 2)
+		return;
+
+	if(topology == TOPOLOGY_RING){
+		dests.push_back((i + 1) % n);
+		sources.push_back((i + n - 1) % n);
+		return;
+	}
+
+	for(int j = 0; j < n; j++){
+		if(j != i){
+			dests.push_back(j);
+			sources.push_back(j);
+		}
+	}
+}
+
+/**
+ * SocketTransport::SocketTransport(int)
+ *
+ * @param n the number of islands, including this process
+ */
+SocketTransport::SocketTransport(int n){
+
+	islands = n > 0 ? n : 1;
+	island = 0;
+	sockets.assign(islands * islands, -1);
+}
+
+/**
+ * SocketTransport::~SocketTransport()
+ *
+ * Close the sockets of this island.
+ */
+SocketTransport::~SocketTransport(){
+
+	for(unsigned int i = 0; i < sockets.size(); i++)
+		if(sockets[i] >= 0)
+			close(sockets[i]);
+}
+
+/**
+ * int SocketTransport::start()
+ *
+ * Connect the islands and fork a process for each island but the first. Every process returns from start, with
+ * its own island number, and only keeps the sockets connecting it to the other islands.
+ *
+ * @return the island number of the calling process, or -1 if the islands could not be started
+ */
+int SocketTransport::start(){
+
+	//one connection for every pair of islands
+	for(int i = 0; i < islands; i++){
+		for(int j = i + 1; j < islands; j++){
+			int sv[2];
+			if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0){
+				t.trace("error","Could not connect islands %d and %d: %s\n", i, j, strerror(errno));
+				return -1;
+			}
+			sockets[i * islands + j] = sv[0];
+			sockets[j * islands + i] = sv[1];
+		}
+	}
+
+	//buffered output would otherwise be written by every process
+	fflush(0);
+
+	island = 0;
+	for(int i = 1; i < islands; i++){
+		pid_t pid = fork();
+		if(pid < 0){
+			t.trace("error","Could not start island %d: %s\n", i, strerror(errno));
+			return -1;
+		}
+		if(pid == 0){
+			island = i;
+			children.clear();
+			break;
+		}
+		children.push_back(pid);
+	}
+
+	//keep only the sockets of this island
+	for(int i = 0; i < islands; i++){
+		for(int j = 0; j < islands; j++){
+			int& fd = sockets[i * islands + j];
+			if(fd < 0)
+				continue;
+			if(i != island){
+				close(fd);
+				fd = -1;
+			}
+			else
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		}
+	}
+
+	t.trace("args","Island %d of %d started (pid %d)\n", island, islands, getpid());
+	return island;
+}
+
+/**
+ * int SocketTransport::finish()
+ *
+ * Disconnect this island. The first island also waits for the processes of the other islands to exit.
+ *
+ * @return 1 if every island exited normally, 0 otherwise
+ */
+int SocketTransport::finish(){
+
+	for(int j = 0; j < islands; j++){
+		int& fd = sockets[island * islands + j];
+		if(fd >= 0){
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	int ok = 1;
+	for(unsigned int c = 0; c < children.size(); c++){
+		int status = 0;
+		if(waitpid(children[c], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+			t.trace("error","Island %d did not exit normally\n", c + 1);
+			ok = 0;
+		}
+	}
+	children.clear();
+	return ok;
+}
+
+/**
+ * int SocketTransport::exchange(const vector<int>&, Snapshot&, const vector<int>&, vector<Snapshot>&)
+ *
+ * Send a message to a set of islands and receive one message from each island in another set. Returns once all
+ * messages have been sent and received.
+ *
+ * @param dests the islands to send to
+ * @param msg the message to send
+ * @param sources the islands to receive from
+ * @param received filled with one message per source, in the same order
+ *
+ * An island which exited (its end of the connection is closed) has left: nothing more is sent to it, and the
+ * message received from it holds no migrants. Writing to it gives EPIPE rather than SIGPIPE, so the sending island
+ * carries on.
+ *
+ * @return 1 on success, 0 if a connection failed
+ */
+int SocketTransport::exchange(const vector<int>& dests, Snapshot& msg, const vector<int>& sources, vector<Snapshot>& received){
+
+	//outgoing frame: length, then data
+	unsigned int len = msg.data.size();
+	vector<char> frame(sizeof(len) + len);
+	memcpy(&frame[0], &len, sizeof(len));
+	if(len)
+		memcpy(&frame[sizeof(len)], &msg.data[0], len);
+
+	vector<size_t> sent(dests.size(), 0);
+	for(unsigned int d = 0; d < dests.size(); d++)
+		if(sockets[island * islands + dests[d]] < 0)
+			sent[d] = frame.size();
+
+	//incoming frames: the length is read first, then the data
+	received.assign(sources.size(), Snapshot());
+	vector<unsigned int> lengths(sources.size(), 0);
+	vector<size_t> got(sources.size(), 0);
+	for(unsigned int s = 0; s < sources.size(); s++)
+		if(sockets[island * islands + sources[s]] < 0)
+			leave(received[s], got[s], lengths[s]);
+
+	vector<struct pollfd> fds;
+	vector<int> which;
+
+	while(1){
+
+		fds.clear();
+		which.clear();
+
+		for(unsigned int d = 0; d < dests.size(); d++){
+			if(sent[d] < frame.size()){
+				struct pollfd p = { sockets[island * islands + dests[d]], POLLOUT, 0 };
+				fds.push_back(p);
+				which.push_back(d);
+			}
+		}
+		for(unsigned int s = 0; s < sources.size(); s++){
+			if(got[s] < sizeof(unsigned int) || got[s] < sizeof(unsigned int) + lengths[s]){
+				struct pollfd p = { sockets[island * islands + sources[s]], POLLIN, 0 };
+				fds.push_back(p);
+				which.push_back(-1 - (int)s);
+			}
+		}
+
+		if(fds.empty())
+			break;
+
+		if(poll(&fds[0], fds.size(), -1) < 0){
+			if(errno == EINTR)
+				continue;
+			t.trace("error","Island %d: poll failed: %s\n", island, strerror(errno));
+			return 0;
+		}
+
+		for(unsigned int f = 0; f < fds.size(); f++){
+
+			if(!fds[f].revents)
+				continue;
+
+			//sending
+			if(which[f] >= 0){
+				int d = which[f];
+				ssize_t n = send(fds[f].fd, &frame[sent[d]], frame.size() - sent[d], MSG_NOSIGNAL);
+				if(n < 0 && (errno == EPIPE || errno == ECONNRESET)){
+					sent[d] = frame.size();
+					for(unsigned int s = 0; s < sources.size(); s++)
+						if(sources[s] == dests[d])
+							leave(received[s], got[s], lengths[s]);
+					close(sockets[island * islands + dests[d]]);
+					sockets[island * islands + dests[d]] = -1;
+					t.trace("gens","Island %d: island %d has left\n", island, dests[d]);
+					continue;
+				}
+				if(n < 0 && errno != EAGAIN && errno != EINTR){
+					t.trace("error","Island %d: could not send to island %d: %s\n", island, dests[d], strerror(errno));
+					return 0;
+				}
+				if(n > 0)
+					sent[d] += n;
+				continue;
+			}
+
+			//receiving
+			int s = -1 - which[f];
+			ssize_t n;
+			if(got[s] < sizeof(unsigned int))
+				n = read(fds[f].fd, (char*)&lengths[s] + got[s], sizeof(unsigned int) - got[s]);
+			else
+				n = read(fds[f].fd, &received[s].data[got[s] - sizeof(unsigned int)], sizeof(unsigned int) + lengths[s] - got[s]);
+
+			if(n == 0 || (n < 0 && errno == ECONNRESET)){
+				for(unsigned int d = 0; d < dests.size(); d++)
+					if(dests[d] == sources[s])
+						sent[d] = frame.size();
+				leave(received[s], got[s], lengths[s]);
+				close(sockets[island * islands + sources[s]]);
+				sockets[island * islands + sources[s]] = -1;
+				t.trace("gens","Island %d: island %d has left\n", island, sources[s]);
+				continue;
+			}
+			if(n < 0 && errno != EAGAIN && errno != EINTR){
+				t.trace("error","Island %d: lost connection to island %d\n", island, sources[s]);
+				return 0;
+			}
+			if(n > 0){
+				got[s] += n;
+				if(got[s] == sizeof(unsigned int))
+					received[s].data.resize(lengths[s]);
+			}
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * void SocketTransport::leave(Snapshot&, size_t&, unsigned int&)
+ *
+ * Stand in for the message of an island which has left: one holding no migrants, complete.
+ *
+ * @param message set to the empty message
+ * @param got set to the length of the frame of the message
+ * @param length set to the length of the message
+ */
+void SocketTransport::leave(Snapshot& message, size_t& got, unsigned int& length){
+
+	message = Snapshot();
+	message.putInt(0);
+	length = message.data.size();
+	got = sizeof(unsigned int) + length;
+}
@@ -0,0 +1,70 @@
+/**
+ * Island.h
+ *
+ * Island model: several sub-populations (islands) evolving in separate processes, which periodically exchange
+ * their best networks.
+ *
+ * Islands talk to each other through a Transport, which moves Snapshot messages between numbered islands.
+ * SocketTransport runs all islands on one machine, as processes forked from the first one and connected by
+ * Unix domain sockets. A transport between machines only has to provide the same exchange operation.
+ *
+ */
+
+#ifndef ISLAND_H_
+#define ISLAND_H_
+
+#include <sys/types.h>
+#include <vector>
+#include "Checkpoint.h"
+
+using namespace std;
+
+// migration topologies
+enum Topology{
+	TOPOLOGY_RING = 0,	// island i sends to island i+1
+	TOPOLOGY_FULL		// every island sends to every other island
+};
+
+class Transport{
+
+public:
+	virtual ~Transport(){};
+
+	// number of this island, from 0 to getIslandCount()-1
+	virtual int getIsland() = 0;
+	virtual int getIslandCount() = 0;
+
+	// send a message to every island in the first list, and receive one message from every island in the second
+	virtual int exchange(const vector<int>&, Snapshot&, const vector<int>&, vector<Snapshot>&) = 0;
+
+	void getNeighbours(int, vector<int>&, vector<int>&);
+};
+
+class SocketTransport : public Transport{
+
+public:
+	SocketTransport(int);
+	~SocketTransport();
+
+	int start();
+	int finish();
+
+	int getIsland(){ return island; };
+	int getIslandCount(){ return islands; };
+
+	int exchange(const vector<int>&, Snapshot&, const vector<int>&, vector<Snapshot>&);
+
+private:
+	void leave(Snapshot&, size_t&, unsigned int&);
+
+	int islands;
+	int island;
+
+	// sockets[i * islands + j] is the end of the connection between islands i and j which is used by island i
+	vector<int> sockets;
+
+	// processes of the other islands, only known to island 0
+	vector<pid_t> children;
+};
+
+#endif
@@ -0,0 +1,569 @@
+/**
+ * Kinetics.cpp
+ *
+ * Compilation of the interactions of a network into reactions, and the rate laws of the reactions.
+ *
+ *   interaction                      reactions (flux: stoichiometry)
+ *   Transcription  DNA -> mRNA       k DNA: +1 mRNA
+ *                  repressed by P    kf mRNA P^hill: -1 DNA
+ *   Translation    mRNA -> Protein   k mRNA: +1 Protein
+ *   Degradation    M -> null         k M: -1 M
+ *   Complexation   P1 + P2 -> C      k P1 P2: -1 P1, -1 P2, +1 C
+ *                  C -> P1 + P2      k C: -1 C, +1 P1, +1 P2
+ *   PTM            A -> B            k A: -1 A, +1 B
+ *   PromoterBind   P -> DNA          (kf - kr) DNA: -1 P
+ *                                    kr (1 - DNA): +1 DNA
+ *
+ * The fluxes are those of the getEffect() methods the interactions used to have, with each shared product now
+ * computed once instead of once for each end of the arc.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "Kinetics.h"
+#include "CustomInteractions.h"
+
+#include "ExternTrace.h"
+
+// the stoichiometry of one reaction and the arcs it comes from, while the network is being compiled
+struct Column{
+	int count;
+	int node[3];
+	float coeff[3];
+	int arc;
+	int pair;
+};
+
+/**
+ * static Column column(int, float, int, float, int, float)
+ *
+ * @return the stoichiometry of a reaction changing up to three nodes. Nodes given as -1 are left out
+ */
+static Column column(int n0, float c0, int n1 = -1, float c1 = 0, int n2 = -1, float c2 = 0){
+
+	Column c;
+	c.count = 0;
+	c.arc = -1;
+	c.pair = -1;
+	int n[3] = { n0, n1, n2 };
+	float k[3] = { c0, c1, c2 };
+	for(int e = 0; e < 3; e++){
+		if(n[e] < 0)
+			continue;
+		c.node[c.count] = n[e];
+		c.coeff[c.count] = k[e];
+		c.count++;
+	}
+	return c;
+}
+
+/**
+ * void Kinetics::compile(ArcTable&, const vector<int>*)
+ *
+ * Rewrite the interactions of a network as reactions. The rates are copied, so the network has to be compiled again
+ * after a mutation.
+ *
+ * Given a selection of nodes, only the reactions of the arcs leaving them are compiled, in the same order, so a part
+ * of the network which no other part reaches (see DerivGraph::rungeKuttaEvaluate) changes exactly as it would with
+ * the whole network. The node ids stay those of the whole network.
+ *
+ * @param table the up to date adjacency table of the network
+ * @param selected by node id, nonzero for the nodes whose reactions are compiled, or null for all of them
+ */
+void Kinetics::compile(ArcTable& table, const vector<int>* selected){
+
+	nodes = table.getNodeCount();
+
+	firstOrder.clear();
+	secondOrder.clear();
+	repression.clear();
+	release.clear();
+
+	// the stoichiometry of the reactions of each law, joined in reaction order at the end
+	vector<Column> columns[4];
+
+	for(int id = 0; id < table.getArcCount(); id++){
+
+		ArcRecord& a = table.arcFromId(id);
+		if(selected && !(*selected)[a.source])
+			continue;
+
+		float rate = a.interaction->getRate();
+
+		FirstOrder f = { a.source, rate };
+
+		//the columns added for this arc
+		size_t added[4] = { columns[0].size(), columns[1].size(), columns[2].size(), columns[3].size() };
+		int pairArc = -1;
+
+		switch(a.kind){
+		case IK_TRANSCRIPTION:{
+			firstOrder.push_back(f);
+			columns[0].push_back(column(a.target, 1));
+
+			DNA* dna = (DNA*) a.sourceMol;
+			if(dna->promoterId != -1){
+				ArcRecord& bind = table.arcFromId(dna->promoterId);
+				Repression r = { a.target, bind.source, (float)dna->hill, ((PromoterBind*) bind.interaction)->kf };
+				repression.push_back(r);
+				columns[2].push_back(column(a.source, -1));
+
+				//its rate constant belongs to the promoter binding
+				columns[2].back().arc = bind.id;
+			}
+			break;
+		}
+		case IK_TRANSLATION:
+			firstOrder.push_back(f);
+			columns[0].push_back(column(a.target, 1));
+			break;
+		case IK_DEGRADATION:
+			firstOrder.push_back(f);
+			columns[0].push_back(column(a.source, -1));
+			break;
+		case IK_FORWARD_COMPLEXATION:{
+			int pairId = ((ForwardComplexation*) a.interaction)->pairArcID;
+			ArcRecord& pair = table.arcFromId(pairId);
+			SecondOrder s = { a.source, pair.source, rate };
+
+			if(pair.interaction->getRate() == rate){
+				//the pair is compiled once, by its first arc
+				if(id < pairId){
+					pairArc = pairId;
+					secondOrder.push_back(s);
+					columns[1].push_back(column(a.source, -1, pair.source, -1, a.target, 1));
+				}
+			}
+			else{
+				secondOrder.push_back(s);
+				columns[1].push_back(column(a.source, -1, a.target, .5));
+			}
+			break;
+		}
+		case IK_REVERSE_COMPLEXATION:{
+			int pairId = ((ReverseComplexation*) a.interaction)->pairArcID;
+			ArcRecord& pair = table.arcFromId(pairId);
+
+			if(pair.interaction->getRate() == rate){
+				if(id < pairId){
+					pairArc = pairId;
+					firstOrder.push_back(f);
+					columns[0].push_back(column(a.source, -1, a.target, 1, pair.target, 1));
+				}
+			}
+			else{
+				firstOrder.push_back(f);
+				columns[0].push_back(column(a.source, -.5, a.target, 1));
+			}
+			break;
+		}
+		case IK_PROMOTER_BIND:{
+			PromoterBind* pb = (PromoterBind*) a.interaction;
+			FirstOrder bind = { a.target, pb->kf - pb->kr };
+			firstOrder.push_back(bind);
+			columns[0].push_back(column(a.source, -1));
+
+			Release r = { a.target, pb->kr };
+			release.push_back(r);
+			columns[3].push_back(column(a.target, 1));
+			break;
+		}
+		default:
+			firstOrder.push_back(f);
+			columns[0].push_back(column(a.source, -1, a.target, 1));
+			break;
+		}
+
+		for(int law = 0; law < 4; law++){
+			for(size_t r = added[law]; r < columns[law].size(); r++){
+				if(columns[law][r].arc < 0)
+					columns[law][r].arc = id;
+				columns[law][r].pair = pairArc;
+			}
+		}
+	}
+
+	stoichStart.clear();
+	stoichNode.clear();
+	stoichCoeff.clear();
+	reactionArc.clear();
+	reactionPair.clear();
+	stoichStart.push_back(0);
+	for(int law = 0; law < 4; law++){
+		for(unsigned int r = 0; r < columns[law].size(); r++){
+			Column& c = columns[law][r];
+			for(int e = 0; e < c.count; e++){
+				stoichNode.push_back(c.node[e]);
+				stoichCoeff.push_back(c.coeff[e]);
+			}
+			stoichStart.push_back(stoichNode.size());
+			reactionArc.push_back(c.arc);
+			reactionPair.push_back(c.pair);
+		}
+	}
+
+	//the same matrix by rows, the entries of every row in the order scatter() adds them
+	nodeStart.assign(nodes + 1, 0);
+	for(unsigned int e = 0; e < stoichNode.size(); e++)
+		nodeStart[stoichNode[e] + 1]++;
+	for(int n = 0; n < nodes; n++)
+		nodeStart[n + 1] += nodeStart[n];
+	nodeReaction.resize(stoichNode.size());
+	nodeCoeff.resize(stoichNode.size());
+	vector<int> fill(nodeStart.begin(), nodeStart.end() - 1);
+	for(int r = 0; r < getReactionCount(); r++)
+		for(int e = stoichStart[r]; e < stoichStart[r + 1]; e++){
+			int slot = fill[stoichNode[e]]++;
+			nodeReaction[slot] = r;
+			nodeCoeff[slot] = stoichCoeff[e];
+		}
+
+	flux.resize(getReactionCount());
+
+	t.trace("mloc","Kinetics %p compiled %d reactions from %d arcs\n", this, getReactionCount(), table.getArcCount());
+}
+
+/**
+ * void Kinetics::getSignature(const vector<int>&, string&)
+ *
+ * Describe the reactions of a part of the network, with its nodes numbered from 0, so parts with the same reactions
+ * in the same order have the same description wherever they are in their networks.
+ *
+ * @param local the number of every node within the part, by node id, -1 for the nodes outside of it
+ * @param signature the description is appended to it
+ */
+void Kinetics::getSignature(const vector<int>& local, string& signature){
+
+	int base = 0;
+
+	for(unsigned int k = 0; k < firstOrder.size(); k++){
+		const FirstOrder& r = firstOrder[k];
+		if(local[r.a] < 0)
+			continue;
+		int law[2] = { 0, local[r.a] };
+		signature.append((const char*)law, sizeof(law));
+		signature.append((const char*)&r.k, sizeof(r.k));
+		appendColumn(base + k, local, signature);
+	}
+	base += firstOrder.size();
+
+	for(unsigned int k = 0; k < secondOrder.size(); k++){
+		const SecondOrder& r = secondOrder[k];
+		if(local[r.a] < 0)
+			continue;
+		int law[3] = { 1, local[r.a], local[r.b] };
+		signature.append((const char*)law, sizeof(law));
+		signature.append((const char*)&r.k, sizeof(r.k));
+		appendColumn(base + k, local, signature);
+	}
+	base += secondOrder.size();
+
+	for(unsigned int k = 0; k < repression.size(); k++){
+		const Repression& r = repression[k];
+		if(local[r.a] < 0)
+			continue;
+		int law[3] = { 2, local[r.a], local[r.b] };
+		float constants[2] = { r.hill, r.k };
+		signature.append((const char*)law, sizeof(law));
+		signature.append((const char*)constants, sizeof(constants));
+		appendColumn(base + k, local, signature);
+	}
+	base += repression.size();
+
+	for(unsigned int k = 0; k < release.size(); k++){
+		const Release& r = release[k];
+		if(local[r.a] < 0)
+			continue;
+		int law[2] = { 3, local[r.a] };
+		signature.append((const char*)law, sizeof(law));
+		signature.append((const char*)&r.k, sizeof(r.k));
+		appendColumn(base + k, local, signature);
+	}
+}
+
+/**
+ * void Kinetics::appendColumn(int, const vector<int>&, string&)
+ *
+ * @param r the reaction
+ * @param local the number of every node within the part of the network described, by node id
+ * @param signature the stoichiometry of the reaction is appended to it
+ */
+void Kinetics::appendColumn(int r, const vector<int>& local, string& signature){
+
+	int count = stoichStart[r + 1] - stoichStart[r];
+	signature.append((const char*)&count, sizeof(count));
+	for(int e = stoichStart[r]; e < stoichStart[r + 1]; e++){
+		signature.append((const char*)&local[stoichNode[e]], sizeof(int));
+		signature.append((const char*)&stoichCoeff[e], sizeof(float));
+	}
+}
+
+/**
+ * void Kinetics::getFlux(const float*, float*)
+ *
+ * @param x the concentration of every node, by node id
+ * @param v filled with the flux of every reaction
+ */
+void Kinetics::getFlux(const float* x, float* v){
+	getFlux(x, v, 0, getReactionCount());
+}
+
+/**
+ * void Kinetics::getFlux(const float*, float*, int, int)
+ *
+ * The fluxes of a range of reactions, which threads sharing an evaluation each compute a part of (see KineticsTeam).
+ *
+ * @param x the concentration of every node, by node id
+ * @param v the flux of every reaction, of which the range is filled
+ * @param first the first reaction of the range
+ * @param last the reaction after the range
+ */
+void Kinetics::getFlux(const float* x, float* v, int first, int last){
+
+	int base = 0;
+	int k, end;
+
+	end = min(last, base + (int)firstOrder.size());
+	for(k = max(first, base); k < end; k++){
+		const FirstOrder& r = firstOrder[k - base];
+		v[k] = r.k * x[r.a];
+	}
+	base += firstOrder.size();
+
+	end = min(last, base + (int)secondOrder.size());
+	for(k = max(first, base); k < end; k++){
+		const SecondOrder& r = secondOrder[k - base];
+		v[k] = r.k * x[r.a] * x[r.b];
+	}
+	base += secondOrder.size();
+
+	//the repressor binds cooperatively, raised to the hill coefficient
+	end = min(last, base + (int)repression.size());
+	for(k = max(first, base); k < end; k++){
+		const Repression& r = repression[k - base];
+		float rep = x[r.b];
+		if(r.hill != 1)
+			rep = pow((double)rep, r.hill);
+		v[k] = r.k * x[r.a] * rep;
+	}
+	base += repression.size();
+
+	end = min(last, base + (int)release.size());
+	for(k = max(first, base); k < end; k++){
+		const Release& r = release[k - base];
+		v[k] = r.k * (1 - x[r.a]);
+	}
+}
+
+/**
+ * void Kinetics::scatter(const float*, float*)
+ *
+ * Multiply the fluxes by the stoichiometry matrix.
+ *
+ * @param v the flux of every reaction
+ * @param dx filled with the change in concentration of every node, by node id
+ */
+void Kinetics::scatter(const float* v, float* dx){
+
+	for(int n = 0; n < nodes; n++)
+		dx[n] = 0;
+
+	int reactions = getReactionCount();
+	for(int r = 0; r < reactions; r++)
+		for(int e = stoichStart[r]; e < stoichStart[r + 1]; e++)
+			dx[stoichNode[e]] += stoichCoeff[e] * v[r];
+}
+
+/**
+ * void Kinetics::gather(const float*, float*, int, int)
+ *
+ * Multiply the fluxes by the rows of a range of nodes of the stoichiometry matrix. Every node only reads the fluxes,
+ * so threads may fill different ranges at the same time, and the sums are added in the order of scatter(), so they
+ * are the same to the last bit.
+ *
+ * @param v the flux of every reaction
+ * @param dx the change in concentration of every node, of which the range is filled
+ * @param first the first node of the range
+ * @param last the node after the range
+ */
+void Kinetics::gather(const float* v, float* dx, int first, int last){
+
+	for(int n = first; n < last; n++){
+		float sum = 0;
+		for(int e = nodeStart[n]; e < nodeStart[n + 1]; e++)
+			sum += nodeCoeff[e] * v[nodeReaction[e]];
+		dx[n] = sum;
+	}
+}
+
+/**
+ * void Kinetics::evaluate(const float*, float*)
+ *
+ * Sum the effects of all reactions on every node.
+ *
+ * @param x the concentration of every node at the current Runge-Kutta stage, by node id
+ * @param dx filled with the total change in concentration of every node, by node id
+ */
+void Kinetics::evaluate(const float* x, float* dx){
+
+	if(flux.empty()){
+		scatter(0, dx);
+		return;
+	}
+
+	getFlux(x, &flux[0]);
+	scatter(&flux[0], dx);
+}
+
+/**
+ * void Kinetics::fire(int, float, float*)
+ *
+ * Apply the stoichiometry of one reaction.
+ *
+ * @param r the reaction
+ * @param times how many times it occurs, negative if it runs in reverse
+ * @param n the amount of every node, by node id
+ */
+void Kinetics::fire(int r, float times, float* n){
+
+	for(int e = stoichStart[r]; e < stoichStart[r + 1]; e++)
+		n[stoichNode[e]] += stoichCoeff[e] * times;
+}
+
+/**
+ * void Kinetics::getFluxTangent(const float*, const float*, float*)
+ *
+ * Differentiate the fluxes along a change of the concentrations, using the derivatives of the rate laws:
+ * dv = J dx, where J is the Jacobian of the fluxes with respect to the concentrations.
+ *
+ * @param x the concentration of every node, by node id
+ * @param dx the change of the concentration of every node
+ * @param dv filled with the resulting change of the flux of every reaction
+ */
+void Kinetics::getFluxTangent(const float* x, const float* dx, float* dv){
+
+	for(unsigned int k = 0; k < firstOrder.size(); k++){
+		const FirstOrder& r = firstOrder[k];
+		*dv++ = r.k * dx[r.a];
+	}
+
+	for(unsigned int k = 0; k < secondOrder.size(); k++){
+		const SecondOrder& r = secondOrder[k];
+		*dv++ = r.k * (dx[r.a] * x[r.b] + x[r.a] * dx[r.b]);
+	}
+
+	for(unsigned int k = 0; k < repression.size(); k++){
+		const Repression& r = repression[k];
+		float rep = x[r.b];
+		float drep = 1;
+		if(r.hill != 1){
+			drep = r.hill * pow((double)rep, r.hill - 1);
+			rep = pow((double)rep, r.hill);
+		}
+		*dv++ = r.k * (dx[r.a] * rep + x[r.a] * drep * dx[r.b]);
+	}
+
+	for(unsigned int k = 0; k < release.size(); k++){
+		const Release& r = release[k];
+		*dv++ = -r.k * dx[r.a];
+	}
+}
+
+/**
+ * void Kinetics::getRateDerivative(const float*, float*)
+ *
+ * Every rate law is linear in its rate constant, so this is the flux with the constant left out.
+ *
+ * @param x the concentration of every node, by node id
+ * @param u filled with the derivative of the flux of every reaction with respect to its own rate constant
+ */
+void Kinetics::getRateDerivative(const float* x, float* u){
+
+	for(unsigned int k = 0; k < firstOrder.size(); k++)
+		*u++ = x[firstOrder[k].a];
+
+	for(unsigned int k = 0; k < secondOrder.size(); k++)
+		*u++ = x[secondOrder[k].a] * x[secondOrder[k].b];
+
+	for(unsigned int k = 0; k < repression.size(); k++){
+		const Repression& r = repression[k];
+		*u++ = x[r.a] * (r.hill != 1 ? pow((double)x[r.b], r.hill) : x[r.b]);
+	}
+
+	for(unsigned int k = 0; k < release.size(); k++)
+		*u++ = 1 - x[release[k].a];
+}
+
+/**
+ * void Kinetics::setHill(float)
+ *
+ * Give every repression the same hill coefficient, which need not be a whole number. The coefficients of the DNA
+ * molecules are used again once the network is compiled again.
+ *
+ * @param hill the hill coefficient, at least 1
+ */
+void Kinetics::setHill(float hill){
+
+	for(unsigned int k = 0; k < repression.size(); k++)
+		repression[k].hill = hill;
+}
+
+/**
+ * void Kinetics::getLinearPart(double*)
+ *
+ * The Jacobian of the changes of the concentrations through the reactions whose flux is linear in the one molecule
+ * they use up: the first order reactions but promoter binding (which uses up the protein at the rate of the DNA), and
+ * promoter release. The change of the concentrations is this matrix times the concentrations, plus what the other
+ * reactions and the constant part of the release flux add. Its off-diagonal entries are never negative, so the
+ * linear part alone keeps the concentrations positive.
+ *
+ * @param a filled with the matrix, node by node id, row by row: a[i * nodes + j] is the change of node i with node j
+ */
+void Kinetics::getLinearPart(double* a){
+
+	for(int e = 0; e < nodes * nodes; e++)
+		a[e] = 0;
+
+	for(unsigned int k = 0; k < firstOrder.size(); k++){
+		const FirstOrder& r = firstOrder[k];
+
+		int own = 1;
+		for(int e = stoichStart[k]; e < stoichStart[k + 1]; e++)
+			if(stoichNode[e] != r.a && stoichCoeff[e] * r.k < 0)
+				own = 0;
+		if(!own)
+			continue;
+
+		for(int e = stoichStart[k]; e < stoichStart[k + 1]; e++)
+			a[stoichNode[e] * nodes + r.a] += stoichCoeff[e] * r.k;
+	}
+
+	int first = firstOrder.size() + secondOrder.size() + repression.size();
+	for(unsigned int k = 0; k < release.size(); k++){
+		const Release& r = release[k];
+		for(int e = stoichStart[first + k]; e < stoichStart[first + k + 1]; e++)
+			a[stoichNode[e] * nodes + r.a] -= stoichCoeff[e] * r.k;
+	}
+}
+
+/**
+ * float Kinetics::getRateConstant(int)
+ *
+ * @param r the reaction
+ *
+ * @return the rate constant of the reaction
+ */
+float Kinetics::getRateConstant(int r){
+
+	unsigned int k = r;
+	if(k < firstOrder.size())
+		return firstOrder[k].k;
+	k -= firstOrder.size();
+	if(k < secondOrder.size())
+		return secondOrder[k].k;
+	k -= secondOrder.size();
+	if(k < repression.size())
+		return repression[k].k;
+	return release[k - repression.size()].k;
+}
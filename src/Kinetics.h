@@ -0,0 +1,131 @@
+/**
+ * Kinetics.h
+ *
+ * Reactions of a network, compiled for the Runge-Kutta and Gillespie solvers.
+ *
+ * The interactions of a network are rewritten as reactions, each with a rate law giving its flux from the
+ * concentrations, and a column of a sparse stoichiometry matrix giving how much of each molecule it makes or uses
+ * up per unit of flux. evaluate() computes every flux once and scatters it to the molecules through the matrix.
+ * The matrix is kept by rows as well, so ranges of fluxes and of molecules can be evaluated apart (see KineticsTeam).
+ *
+ * There are four rate laws, and the reactions of each law are kept in an array of their own, holding only the node
+ * ids and constants the law needs, so the flux loops are branch-free and run without virtual calls or graph lookups.
+ * The Gillespie solver uses the same fluxes as propensities, and fire() applies the column of the chosen reaction.
+ *
+ * The derivatives of the fluxes are analytic: getFluxTangent() gives the change of every flux along a change of the
+ * concentrations (a product with the Jacobian of the rate laws), and getRateDerivative() its change with the rate
+ * constant of each reaction. Each reaction remembers the arc it was compiled from (both arcs of a complexation pair),
+ * so results per reaction can be given back to the interactions.
+ *
+ * A part of the network no other part reaches can be compiled on its own, and getSignature() describes the reactions
+ * of such a part, so its solution can be looked up by content (see ComponentCache).
+ *
+ * getLinearPart() splits off the reactions whose flux is linear in the molecule they use up (all but complexation,
+ * repression and promoter binding), which integrators treating them exactly need (see Integrator).
+ *
+ * The two forward complexations of a complex are one reaction, P1 + P2 -> C, as are its two reverse complexations,
+ * C -> P1 + P2, as long as the rates of the pair are equal (the mutations keep them equal).
+ *
+ */
+
+#ifndef KINETICS_H_
+#define KINETICS_H_
+
+#include <vector>
+#include <string>
+
+#include "ArcTable.h"
+
+using namespace std;
+
+class Kinetics{
+
+public:
+	void compile(ArcTable&, const vector<int>* = 0);
+	void evaluate(const float*, float*);
+
+	void getFlux(const float*, float*);
+	void getFlux(const float*, float*, int, int);
+	void scatter(const float*, float*);
+	void gather(const float*, float*, int, int);
+	void fire(int, float, float*);
+
+	void getFluxTangent(const float*, const float*, float*);
+	void getRateDerivative(const float*, float*);
+	float getRateConstant(int);
+	void setHill(float);
+	void getLinearPart(double*);
+	void getSignature(const vector<int>&, string&);
+
+	int getNodeCount(){ return nodes; };
+	int getReactionCount(){ return stoichStart.size() - 1; };
+
+	// the entries of the rows of the stoichiometry matrix before node n
+	int getRowStart(int n){ return nodeStart[n]; };
+
+	// the stoichiometry matrix by columns: the entries of reaction r are getColumnStart(r) to getColumnStart(r + 1)
+	int getColumnStart(int r){ return stoichStart[r]; };
+	int getEntryNode(int e){ return stoichNode[e]; };
+	float getEntryCoeff(int e){ return stoichCoeff[e]; };
+
+	// the arc a reaction was compiled from, and the other arc of its complexation pair (-1 if there is none)
+	int getReactionArc(int r){ return reactionArc[r]; };
+	int getReactionPair(int r){ return reactionPair[r]; };
+
+private:
+	void appendColumn(int, const vector<int>&, string&);
+
+	// flux k x[a]
+	struct FirstOrder{
+		int a;
+		float k;
+	};
+
+	// flux k x[a] x[b]
+	struct SecondOrder{
+		int a;
+		int b;
+		float k;
+	};
+
+	// flux k x[a] x[b]^hill
+	struct Repression{
+		int a;
+		int b;
+		float hill;
+		float k;
+	};
+
+	// flux k (1 - x[a])
+	struct Release{
+		int a;
+		float k;
+	};
+
+	int nodes;
+
+	// the reactions of each law. The reactions are numbered in this order
+	vector<FirstOrder> firstOrder;
+	vector<SecondOrder> secondOrder;
+	vector<Repression> repression;
+	vector<Release> release;
+
+	// the stoichiometry matrix by columns: the entries of reaction r are stoichStart[r] to stoichStart[r+1]
+	vector<int> stoichStart;
+	vector<int> stoichNode;
+	vector<float> stoichCoeff;
+
+	// the stoichiometry matrix by rows, for gather(): the entries of node n are nodeStart[n] to nodeStart[n+1]
+	vector<int> nodeStart;
+	vector<int> nodeReaction;
+	vector<float> nodeCoeff;
+
+	// the arcs of every reaction
+	vector<int> reactionArc;
+	vector<int> reactionPair;
+
+	// the flux of every reaction at the current stage
+	vector<float> flux;
+};
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * KineticsTeam.cpp
+ *
+ * Evaluation of the rate laws of a network by a team of threads meeting at a spinning barrier.
+ */
+
+#include <sched.h>
+
+#include "KineticsTeam.h"
+
+#include "ExternTrace.h"
+
+// arcs of a network for every member of its team. Smaller networks evaluate faster than the members can meet
+#define KINETICS_TEAM_ARCS 256
+
+// checks of the barrier before a waiting member gives up the processor between checks
+#define KINETICS_TEAM_SPINS 4000
+
+/**
+ * KineticsTeam::KineticsTeam(Kinetics&, int)
+ *
+ * Split the reactions evenly among the members, and the nodes by the entries of their rows.
+ *
+ * @param k the compiled reactions of the network
+ * @param n the number of members, the calling thread included
+ */
+KineticsTeam::KineticsTeam(Kinetics& k, int n){
+
+	kinetics = &k;
+	size = n < 1 ? 1 : n;
+	x = 0;
+	dx = 0;
+	arrived = 0;
+	release = 0;
+	stopping = 0;
+
+	int reactions = k.getReactionCount();
+	int nodes = k.getNodeCount();
+	int entries = k.getRowStart(nodes);
+	flux.resize(reactions + 1);
+
+	int node = 0;
+	for(int i = 0; i < size; i++){
+		Member* m = new Member;
+		m->team = this;
+		m->index = i;
+		m->sense = 0;
+		m->firstReaction = (int)((long)reactions * i / size);
+		m->lastReaction = (int)((long)reactions * (i + 1) / size);
+
+		m->firstNode = node;
+		while(node < nodes && (i == size - 1 || k.getRowStart(node) < (long)entries * (i + 1) / size))
+			node++;
+		m->lastNode = node;
+
+		members.push_back(m);
+	}
+
+	for(int i = 1; i < size; i++){
+		if(pthread_create(&members[i]->thread, 0, memberThread, members[i]) != 0){
+			t.trace("error","Could not start member %d of a kinetics team\n", i);
+
+			//the members which did not start are done by the caller
+			members[0]->lastReaction = reactions;
+			members[0]->lastNode = nodes;
+			for(int j = i; j < size; j++)
+				delete members[j];
+			members.resize(i);
+			for(int j = 1; j < i; j++){
+				members[j]->firstReaction = members[j]->lastReaction = reactions;
+				members[j]->firstNode = members[j]->lastNode = nodes;
+			}
+			size = i;
+			break;
+		}
+	}
+}
+
+KineticsTeam::~KineticsTeam(){
+
+	stopping = 1;
+	wait(members[0]);
+
+	for(int i = 1; i < size; i++)
+		pthread_join(members[i]->thread, 0);
+	for(int i = 0; i < size; i++)
+		delete members[i];
+}
+
+/**
+ * static int KineticsTeam::getTeamSize(int, int)
+ *
+ * @param arcs the number of arcs of the network
+ * @param threads the largest team
+ *
+ * @return the number of members, 1 if the network should be evaluated by the calling thread alone
+ */
+int KineticsTeam::getTeamSize(int arcs, int threads){
+
+	int n = arcs / KINETICS_TEAM_ARCS;
+	if(n > threads)
+		n = threads;
+	return n < 1 ? 1 : n;
+}
+
+/**
+ * void KineticsTeam::evaluate(const float*, float*)
+ *
+ * Sum the effects of all reactions on every node, as Kinetics::evaluate does.
+ *
+ * @param c the concentration of every node at the current Runge-Kutta stage, by node id
+ * @param dc filled with the total change in concentration of every node, by node id
+ */
+void KineticsTeam::evaluate(const float* c, float* dc){
+
+	x = c;
+	dx = dc;
+
+	wait(members[0]);
+	work(members[0]);
+	wait(members[0]);
+}
+
+/**
+ * void* KineticsTeam::memberThread(void*)
+ *
+ * Body of the members other than the calling thread: evaluate a stage every time the team meets, until it is deleted.
+ *
+ * @param arg the Member
+ */
+void* KineticsTeam::memberThread(void* arg){
+
+	Member* m = (Member*) arg;
+	KineticsTeam* team = m->team;
+
+	while(1){
+		team->wait(m);
+		if(team->stopping)
+			break;
+		team->work(m);
+		team->wait(m);
+	}
+
+	return 0;
+}
+
+/**
+ * void KineticsTeam::work(Member*)
+ *
+ * The part of a member in an evaluation: its fluxes, then, once the whole team has computed theirs, its sums.
+ *
+ * @param m the member
+ */
+void KineticsTeam::work(Member* m){
+
+	kinetics->getFlux(x, &flux[0], m->firstReaction, m->lastReaction);
+	wait(m);
+	kinetics->gather(&flux[0], dx, m->firstNode, m->lastNode);
+}
+
+/**
+ * void KineticsTeam::wait(Member*)
+ *
+ * Wait until every member has arrived (a sense-reversing barrier). The last member to arrive releases the others.
+ *
+ * @param m the member
+ */
+void KineticsTeam::wait(Member* m){
+
+	m->sense = !m->sense;
+
+	if(__sync_add_and_fetch(&arrived, 1) == size){
+		arrived = 0;
+		__sync_synchronize();
+		release = m->sense;
+		return;
+	}
+
+	for(int spin = 0; release != m->sense; spin++)
+		if(spin >= KINETICS_TEAM_SPINS)
+			sched_yield();
+	__sync_synchronize();
+}
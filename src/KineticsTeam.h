@@ -0,0 +1,78 @@
+/**
+ * KineticsTeam.h
+ *
+ * Threads sharing the evaluation of the rate laws of one large network.
+ *
+ * With high --max limits a network holds hundreds of molecules and arcs, and a small population leaves most cores
+ * idle. A team splits every evaluation of a Runge-Kutta stage: each member computes the fluxes of a range of
+ * reactions, and after all fluxes are known, the sums of a range of molecules (see Kinetics::gather). Every molecule
+ * is summed by one member only, so there are no conflicting writes and no reduction, and the results are the same to
+ * the last bit as those of Kinetics::evaluate.
+ *
+ * An evaluation takes a few microseconds, much less than waking a sleeping thread, so the members wait for each
+ * other at a spinning barrier, and only give up the processor after spinning for a while. The calling thread is
+ * member 0. The members are started with the team and stopped when it is deleted, so a team lives for one run.
+ *
+ */
+
+#ifndef KINETICSTEAM_H_
+#define KINETICSTEAM_H_
+
+#include <vector>
+#include <pthread.h>
+
+#include "Kinetics.h"
+
+using namespace std;
+
+class KineticsTeam{
+
+public:
+	KineticsTeam(Kinetics&, int);
+	~KineticsTeam();
+
+	void evaluate(const float*, float*);
+
+	int getSize(){ return size; };
+
+	// the members worth sharing the evaluation of a network among, at most the given number of threads
+	static int getTeamSize(int, int);
+
+private:
+	struct Member{
+		KineticsTeam* team;
+		int index;
+		pthread_t thread;
+
+		// the phase of the barrier this member waits for
+		int sense;
+
+		// the reactions and the nodes of this member
+		int firstReaction;
+		int lastReaction;
+		int firstNode;
+		int lastNode;
+	};
+
+	static void* memberThread(void*);
+	void work(Member*);
+	void wait(Member*);
+
+	Kinetics* kinetics;
+	int size;
+	vector<Member*> members;
+
+	// the flux of every reaction at the current stage
+	vector<float> flux;
+
+	// the stage being evaluated
+	const float* x;
+	float* dx;
+
+	// the barrier: members arrived, and the phase released last
+	volatile int arrived;
+	volatile int release;
+	volatile int stopping;
+};
+
+#endif
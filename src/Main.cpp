@@ -1,9 +1,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
 #include <iostream>
 
 #include "Experiment.h"
+#include "Sweep.h"
 
 #include "Trace.h"
 //#include "ExternTrace.h"
@@ -12,10 +16,30 @@ using namespace std;
 
 Trace t;
 
-//global variable for hill parameter
-//much easier than passing this through 4 class constructors to get to the DNA object
-// consider moving all command line parameter values here
-int hillParam = 1;
+/**
+ * static int readCount(const char*, const char*, int, int*)
+ *
+ * Read a whole number option, which must be at least a given value.
+ *
+ * @param option the name of the option, for the message
+ * @param text the value given
+ * @param least the smallest value allowed
+ * @param value set to the value read
+ *
+ * @return 1 if the value was read, 0 after printing why not
+ */
+static int readCount(const char* option, const char* text, int least, int* value){
+
+	char* end;
+	errno = 0;
+	long v = strtol(text, &end, 10);
+	if(end == text || *end != 0 || errno != 0 || v < least || v > INT_MAX){
+		printf("Could not read --%s %s (a whole number of at least %d)\n", option, text, least);
+		return 0;
+	}
+	*value = (int)v;
+	return 1;
+}
 
 int main(int argc, char** argv){
   
@@ -29,6 +53,13 @@ int main(int argc, char** argv){
   int usage_flag = 0;
   int gillespie_flag = 0;
   int rungeKutta_flag = 0;
+  int summary_flag = 0;
+  int lgf_flag = 0;
+  int bench_flag = 0;
+  int benchStep_flag = 0;
+  int guided_flag = 0;
+  int prefilter_flag = 0;
+  int hopf_flag = 0;
 
   // used by command line parser
   int c;
@@ -68,7 +99,7 @@ int main(int argc, char** argv){
   // runge kutta (calculation of next points) 
   t.addTraceType("rk-new",0);
 
-  // hill / goodwin term calculation (transcription::getEffect)
+  // hill / goodwin term calculation (Kinetics::evaluate)
   t.addTraceType("hill",0);
 
   // molecule scoring
@@ -82,6 +113,24 @@ int main(int argc, char** argv){
 
   t.addTraceType("stoch",1);
 
+  // rate sensitivities of the oscillation amplitude (--guided)
+  t.addTraceType("sens",0);
+
+  // limit cycles found while integrating (--cycle-detect)
+  t.addTraceType("rk",0);
+
+  // steady state search of the stability screen (--hopf) and Hopf points of the continuation
+  t.addTraceType("hopf",0);
+
+  // iterations and speedup of parallel in time integration (--parareal)
+  t.addTraceType("parareal",1);
+
+  // conservation laws found when a network is compiled
+  t.addTraceType("conservation",0);
+
+  // parts of networks integrated apart and found in the cache (--component-cache)
+  t.addTraceType("components",0);
+
   int numCells = 2;
   int numGenerations = 10;
 
@@ -100,6 +149,37 @@ int main(int argc, char** argv){
   float rkTimeLimit = 20;
   float rkTimeStep = .05;
 
+  // hill coefficient of the genes, passed to every network through Experiment and Cell
+  int hillCoefficient = 1;
+
+  int checkpointInterval = 0;
+  const char* resumeFile = 0;
+
+  const char* initFile = 0;
+  float initFraction = 1;
+
+  int selectionMode = SELECT_NONE;
+  int elitism = 0;
+  int tournamentSize = 2;
+
+  int numIslands = 1;
+  int migrationInterval = 10;
+  int numMigrants = 1;
+  int topology = TOPOLOGY_RING;
+
+  const char* sweepSpec = 0;
+  int numThreads = 1;
+  int pararealThreads = 0;
+  int networkThreads = 1;
+  int cacheMegabytes = 0;
+  int scoreMethod = SCORE_COUNT;
+  int cycleDetection = 0;
+  int integrator = INTEGRATE_RK4;
+  const char* continuationFiles = 0;
+  float hillFrom = 1;
+  float hillTo = 16;
+  float hillStep = .25;
+
 
   // this loop parses the command line options. it was mostly adapted from online examples
   while(1){
@@ -116,6 +196,13 @@ int main(int argc, char** argv){
       {"csvData", no_argument, &csvData_flag, 1},
 	  {"deterministic", no_argument, &rungeKutta_flag, 1},
 	  {"stochastic", no_argument, &gillespie_flag, 1},
+      {"summary", no_argument, &summary_flag, 1},
+      {"lgf", no_argument, &lgf_flag, 1},
+      {"bench", no_argument, &bench_flag, 1},
+      {"bench-step", no_argument, &benchStep_flag, 1},
+      {"guided", no_argument, &guided_flag, 1},
+      {"prefilter", no_argument, &prefilter_flag, 1},
+      {"hopf", no_argument, &hopf_flag, 1},
 
       {"cells",  required_argument, 0, 'c'},
       {"gens",  required_argument, 0, 'g'},
@@ -130,6 +217,27 @@ int main(int argc, char** argv){
       {"rkstep", required_argument, 0, 'k'},
       {"interval", required_argument, 0, 'l'},
       {"hill", required_argument, 0, 'm'},
+      {"checkpoint", required_argument, 0, 'n'},
+      {"resume", required_argument, 0, 'o'},
+      {"init-from", required_argument, 0, 'p'},
+      {"init-fraction", required_argument, 0, 'q'},
+      {"select", required_argument, 0, 'r'},
+      {"elitism", required_argument, 0, 's'},
+      {"tournament", required_argument, 0, 'u'},
+      {"islands", required_argument, 0, 'v'},
+      {"migrate-every", required_argument, 0, 'w'},
+      {"migrants", required_argument, 0, 'x'},
+      {"topology", required_argument, 0, 'y'},
+      {"sweep", required_argument, 0, 'z'},
+      {"threads", required_argument, 0, 'T'},
+      {"parareal", required_argument, 0, 'P'},
+      {"network-threads", required_argument, 0, 'N'},
+      {"component-cache", required_argument, 0, 'M'},
+      {"score", required_argument, 0, 'S'},
+      {"cycle-detect", required_argument, 0, 'C'},
+      {"integrator", required_argument, 0, 'I'},
+      {"continuation", required_argument, 0, 'K'},
+      {"hill-range", required_argument, 0, 'H'},
 
       {0,0,0,0}
      };
@@ -190,7 +298,110 @@ int main(int argc, char** argv){
 		scoringInterval = atoi(optarg);
 		break;
 	case 'm':
-		hillParam = atoi(optarg);
+		if(!readCount("hill", optarg, 1, &hillCoefficient))
+			return 1;
+		break;
+	case 'n':
+		checkpointInterval = atoi(optarg);
+		break;
+	case 'o':
+		resumeFile = optarg;
+		break;
+	case 'p':
+		initFile = optarg;
+		break;
+	case 'q':
+		initFraction = atof(optarg);
+		break;
+	case 'r':
+		if(strcmp(optarg, "tournament") == 0)
+			selectionMode = SELECT_TOURNAMENT;
+		else if(strcmp(optarg, "truncation") == 0)
+			selectionMode = SELECT_TRUNCATION;
+		else if(strcmp(optarg, "proportional") == 0)
+			selectionMode = SELECT_PROPORTIONAL;
+		else if(strcmp(optarg, "none") == 0)
+			selectionMode = SELECT_NONE;
+		else{
+			printf("Unknown selection mode %s\n", optarg);
+			return 1;
+		}
+		break;
+	case 's':
+		elitism = atoi(optarg);
+		break;
+	case 'u':
+		tournamentSize = atoi(optarg);
+		break;
+	case 'v':
+		numIslands = atoi(optarg);
+		break;
+	case 'w':
+		migrationInterval = atoi(optarg);
+		break;
+	case 'x':
+		numMigrants = atoi(optarg);
+		break;
+	case 'y':
+		if(strcmp(optarg, "ring") == 0)
+			topology = TOPOLOGY_RING;
+		else if(strcmp(optarg, "full") == 0)
+			topology = TOPOLOGY_FULL;
+		else{
+			printf("Unknown topology %s\n", optarg);
+			return 1;
+		}
+		break;
+	case 'z':
+		sweepSpec = optarg;
+		break;
+	case 'T':
+		if(!readCount("threads", optarg, 1, &numThreads))
+			return 1;
+		break;
+	case 'P':
+		pararealThreads = atoi(optarg);
+		break;
+	case 'N':
+		networkThreads = atoi(optarg);
+		break;
+	case 'M':
+		if(!readCount("component-cache", optarg, 0, &cacheMegabytes))
+			return 1;
+		break;
+	case 'S':
+		if(strcmp(optarg, "count") == 0)
+			scoreMethod = SCORE_COUNT;
+		else if(strcmp(optarg, "fft") == 0)
+			scoreMethod = SCORE_FFT;
+		else{
+			printf("Unknown scoring method %s\n", optarg);
+			return 1;
+		}
+		break;
+	case 'C':
+		cycleDetection = atoi(optarg);
+		break;
+	case 'I':
+		if(strcmp(optarg, "rk4") == 0)
+			integrator = INTEGRATE_RK4;
+		else if(strcmp(optarg, "lawson") == 0)
+			integrator = INTEGRATE_LAWSON;
+		else if(strcmp(optarg, "qssa") == 0)
+			integrator = INTEGRATE_QSSA;
+		else{
+			printf("Unknown integrator %s\n", optarg);
+			return 1;
+		}
+		break;
+	case 'K':
+		continuationFiles = optarg;
+		break;
+	case 'H':
+		if(sscanf(optarg, "%f:%f:%f", &hillFrom, &hillTo, &hillStep) < 2 || hillFrom < 1 || hillTo < 1 || hillStep <= 0){
+			printf("Could not read hill range %s\n", optarg);
+			return 1;
+		}
 		break;
 	case '?':
 		break;
@@ -212,6 +423,15 @@ if (usage_flag){
       printf("  --csvData         Output csv data containing molecule concentrations\n");
 	  printf("  --deterministic   Use deterministic Runge-Kutta solver for solving curves\n");
 	  printf("  --stochastic      Use stochastic gillespie algorithm for solving curves\n");
+      printf("  --summary         Output a per-generation population summary (NDJSON) to summary.ndjson\n");
+      printf("  --lgf             Output LEMON Graph Format files of the cell networks\n");
+      printf("  --bench           Time arc iteration on a network grown to the --max limits, and exit\n");
+      printf("  --bench-step      Find the longest accurate timestep of every integrator on networks grown to the --max limits\n");
+      printf("                    with the --minrate/--maxrate rates, and exit\n");
+      printf("  --guided          Bias rate mutations toward the rates the oscillation amplitude is most sensitive to\n");
+      printf("                    (needs --deterministic, costs a sensitivity analysis per cell each scoring generation)\n");
+      printf("  --prefilter       Give a score of 0 without solving to networks with no feedback loop through a repression\n");
+      printf("  --hopf            Give a score of 0 without solving to networks whose steady state is linearly stable\n");
       printf("\n");
       printf("Parameters:\n");
       printf("  --cells <int>        Number of Cells to simulate\n");
@@ -227,19 +447,252 @@ if (usage_flag){
       printf("  --rkstep <float>     Step size between points for differential equation solving\n");
       printf("  --interval <int>     Number of generations between equation solving and scoring\n");
       printf("  --hill <int>         Value of Hill Coefficient for DNA Transcription\n");
+      printf("  --checkpoint <int>   Number of generations between checkpoints (checkpoint.bin)\n");
+      printf("  --resume <file>      Continue the experiment saved in a checkpoint file\n");
+      printf("  --init-from <file>   Start cells from the network in a LEMON Graph Format file\n");
+      printf("  --init-fraction <float>  Fraction of the cells started from --init-from (default 1)\n");
+      printf("  --select <mode>      Selection after scoring: none, tournament, truncation or proportional\n");
+      printf("  --elitism <int>      Number of best cells always kept by selection\n");
+      printf("  --tournament <int>   Number of cells in each selection tournament (default 2)\n");
+      printf("  --islands <int>      Number of islands (processes), each with --cells cells\n");
+      printf("  --migrate-every <int>  Number of generations between migrations (default 10)\n");
+      printf("  --migrants <int>     Number of best cells each island sends to its neighbours (default 1)\n");
+      printf("  --topology <name>    Migration topology: ring or full (default ring)\n");
+      printf("  --sweep <spec>       Run an experiment for every combination of parameter values, e.g. hill=13:16,maxrate=5,10\n");
+      printf("                       (cells, hill, minrate, maxrate, initconc, rklim, rkstep, maxbasic, maxptm, maxcomp, maxprom)\n");
+      printf("  --threads <int>      Number of threads processing the cells (default 1)\n");
+      printf("  --parareal <int>     Number of threads integrating the time slices of each cell in parallel (Parareal),\n");
+      printf("                       for few cells with a long --rklim. Reports iterations and speedup of every run\n");
+      printf("  --network-threads <int>  Number of threads sharing each Runge-Kutta stage of a large network (default 1),\n");
+      printf("                       for few cells with high --max limits. Networks get a thread per 256 arcs\n");
+      printf("  --component-cache <int>  Megabytes kept of the solutions of the unconnected parts of networks, so only the\n");
+      printf("                       parts a mutation changed are integrated again (default 0, off). Reports on stderr\n");
+      printf("  --score <method>     Oscillation scoring: count (direction changes, default) or fft (autocorrelation period)\n");
+      printf("  --cycle-detect <int> Stop integrating a cell after this many consistent periods of a limit cycle (default 0, off)\n");
+      printf("  --integrator <method>  Deterministic solver: rk4 (Runge-Kutta, default), lawson (exact linear reactions,\n");
+      printf("                       stable with long --rkstep at high --maxrate) or qssa (fast molecules held at their\n");
+      printf("                       quasi-steady state, so --rkstep only has to follow the slow ones)\n");
+      printf("  --continuation <files>  Follow the steady states of LGF networks (comma separated) over --hill-range,\n");
+      printf("                       print their bifurcation table with the Hopf points, and exit\n");
+      printf("  --hill-range <from>:<to>[:<step>]  Hill coefficients of --continuation (default 1:16:0.25)\n");
 
 return 0;
 }
 
+// time the iteration of the arcs of one network
+if(bench_flag){
+	DerivGraph g;
+	g.setLimits(maxBasic, maxPTM, maxComp, maxPromoter);
+	g.setKineticRateLimits(minKineticRate, maxKineticRate);
+	g.setDefaultInitialConc(initialConcentration);
+	g.setHill(hillCoefficient);
+	g.benchmark(stdout);
+	return 0;
+}
+
+// compare the longest accurate timesteps of the integrators, on as many networks as there would be cells
+if(benchStep_flag){
+	printf("Longest accurate timestep of each integrator over %g time units, the time a run with it takes (ms),\n", rkTimeLimit);
+	printf("and the longest stable timestep, then the molecules qssa holds at their quasi-steady state and its error\n");
+	printf("nodes reactions     decay       rk4     ms  stable    lawson     ms  stable      qssa     ms  stable   fast     error\n");
+	for(int k = 0; k < numCells; k++){
+		DerivGraph g;
+		g.setLimits(maxBasic, maxPTM, maxComp, maxPromoter);
+		g.setKineticRateLimits(minKineticRate, maxKineticRate);
+		g.setDefaultInitialConc(initialConcentration);
+		g.setHill(hillCoefficient);
+		g.stepBenchmark(stdout, rkTimeStep, rkTimeLimit);
+	}
+	return 0;
+}
+
+// follow the steady states of evolved networks over the hill coefficient, instead of evolving a population for each
+if(continuationFiles){
+	char files[1024];
+	snprintf(files, sizeof(files), "%s", continuationFiles);
+
+	Continuation::writeHeader(stdout);
+	for(char* file = strtok(files, ","); file; file = strtok(0, ",")){
+		DerivGraph g;
+		g.setHill(hillCoefficient);
+		if(!g.importLgf(file)){
+			printf("Could not load network from %s\n", file);
+			return 1;
+		}
+		g.continuation(stdout, file, hillFrom, hillTo, hillStep);
+	}
+	return 0;
+}
+
+// run every point of a parameter sweep in this process, with the cells of all points sharing one pool of threads
+if(sweepSpec){
+	if(resumeFile || checkpointInterval > 0 || numIslands > 1 || pararealThreads > 1){
+		printf("--sweep can not be used with --resume, --checkpoint, --islands or --parareal\n");
+		return 1;
+	}
+
+	Sweep sweep;
+	if(!sweep.parse(sweepSpec)){
+		printf("Could not parse sweep %s\n", sweepSpec);
+		return 1;
+	}
+
+	RunParameters base = { numCells, hillCoefficient, minKineticRate, maxKineticRate, initialConcentration, rkTimeLimit, rkTimeStep, maxBasic, maxPTM, maxComp, maxPromoter };
+
+	ComponentCache* cache = cacheMegabytes > 0 ? new ComponentCache(cacheMegabytes) : 0;
+
+	vector<Experiment*> runs;
+	int ok = 1;
+	for(int k = 0; k < sweep.getPointCount() && ok; k++){
+		RunParameters p = base;
+		sweep.apply(k, p);
+
+		Experiment* x = new Experiment(p.cells, numGenerations, p.maxBasic, p.maxPTM, p.maxComp, p.maxProm, p.minRate, p.maxRate, p.rkLimit, p.rkStep, p.initConc, p.hill, rungeKutta_flag, gillespie_flag);
+		runs.push_back(x);
+
+		//the summary records of all points go to sweep.ndjson
+		x->setOutputOptions(graphviz_flag, gnuplot_flag, outputall_flag, csvCell_flag, csvData_flag, scoringInterval, 0, lgf_flag);
+		x->setSelection(selectionMode, elitism, tournamentSize);
+		x->setGuidedMutation(guided_flag);
+		x->setScoring(scoreMethod);
+		x->setCycleDetection(cycleDetection);
+		x->setIntegrator(integrator);
+		x->setNetworkThreads(networkThreads);
+		x->setComponentCache(cache);
+		x->setPrefilter(prefilter_flag);
+		x->setHopfScreen(hopf_flag);
+
+		if(initFile && !x->seedFrom(initFile, initFraction)){
+			printf("Could not load network from %s\n", initFile);
+			ok = 0;
+		}
+	}
+
+	if(ok){
+		ThreadPool pool(numThreads);
+		ok = sweep.run(runs, pool);
+		if(numThreads > 1)
+			pool.report(stdout);
+	}
+
+	for(unsigned int k = 0; k < runs.size(); k++)
+		delete runs[k];
+
+	if(cache){
+		cache->report(stderr);
+		delete cache;
+	}
+
+	return ok ? 0 : 1;
+}
+
+// the slices of a cell are a batch of their own, which the threads processing the cells can not wait for
+if(pararealThreads > 1 && numThreads > 1){
+	printf("--parareal can not be used with --threads\n");
+	return 1;
+}
+
+// a resumed experiment takes its cells from the checkpoint, so none are created here
+if(resumeFile)
+	numCells = 0;
+
+// start the other islands. Every process continues from here as one island, with its own output directory
+SocketTransport* islands = 0;
+if(numIslands > 1){
+	if(resumeFile){
+		printf("--resume can not be used with --islands\n");
+		return 1;
+	}
+	islands = new SocketTransport(numIslands);
+	if(islands->start() < 0){
+		printf("Could not start %d islands\n", numIslands);
+		return 1;
+	}
+}
+
 // create our experiment with the options from the command line
-Experiment e = Experiment(numCells, numGenerations, maxBasic, maxPTM, maxComp, maxPromoter, minKineticRate, maxKineticRate, rkTimeLimit, rkTimeStep, initialConcentration, rungeKutta_flag, gillespie_flag);
+Experiment e = Experiment(numCells, numGenerations, maxBasic, maxPTM, maxComp, maxPromoter, minKineticRate, maxKineticRate, rkTimeLimit, rkTimeStep, initialConcentration, hillCoefficient, rungeKutta_flag, gillespie_flag);
 
 //set options related to output
-e.setOutputOptions(graphviz_flag, gnuplot_flag, outputall_flag, csvCell_flag, csvData_flag, scoringInterval);
+e.setOutputOptions(graphviz_flag, gnuplot_flag, outputall_flag, csvCell_flag, csvData_flag, scoringInterval, summary_flag, lgf_flag);
+
+e.setCheckpointInterval(checkpointInterval);
+
+e.setSelection(selectionMode, elitism, tournamentSize);
+
+e.setGuidedMutation(guided_flag);
+
+e.setScoring(scoreMethod);
+
+e.setCycleDetection(cycleDetection);
+
+e.setIntegrator(integrator);
+
+e.setNetworkThreads(networkThreads);
+
+e.setPrefilter(prefilter_flag);
+
+e.setHopfScreen(hopf_flag);
+
+if(resumeFile && !e.resume(resumeFile)){
+	printf("Could not resume from %s\n", resumeFile);
+	return 1;
+}
+
+if(initFile && !resumeFile && !e.seedFrom(initFile, initFraction)){
+	printf("Could not load network from %s\n", initFile);
+	return 1;
+}
+
+if(islands)
+	e.setMigration(islands, migrationInterval, numMigrants, topology);
+
+// threads processing the cells. Islands each start their own, after the fork
+ThreadPool* pool = 0;
+if(numThreads > 1){
+	pool = new ThreadPool(numThreads);
+	e.setThreadPool(pool);
+}
+
+// threads integrating the time slices of every cell, when there are too few cells to keep threads busy
+ThreadPool* slicePool = 0;
+if(pararealThreads > 1){
+	slicePool = new ThreadPool(pararealThreads);
+	e.setParareal(slicePool);
+}
+
+// solutions of the parts of networks, shared by the cells. Islands each keep their own, after the fork
+ComponentCache* cache = 0;
+if(cacheMegabytes > 0){
+	cache = new ComponentCache(cacheMegabytes);
+	e.setComponentCache(cache);
+}
 
 //start the experiment
 e.start();
 
+if(pool){
+	pool->report(stdout);
+	delete pool;
+}
+
+if(slicePool){
+	slicePool->report(stdout);
+	delete slicePool;
+}
+
+if(cache){
+	cache->report(stderr);
+	delete cache;
+}
+
+if(islands){
+	int ok = islands->finish();
+	delete islands;
+	if(!ok)
+		return 1;
+}
+
 
 return 0;
 
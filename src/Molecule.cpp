@@ -1,4 +1,6 @@
 #include "Molecule.h"
+#include "Checkpoint.h"
+#include "Arena.h"
 
 #include "ExternTrace.h"
 
@@ -25,6 +27,8 @@ Molecule::Molecule(){
 	//set the molecule id
 	moleculeID = -1;
 
+	kind = MK_MOLECULE;
+
 	stoch_numMols = 1000;
 
 	numChanges = 0;
@@ -51,6 +55,36 @@ Molecule::Molecule(){
 
 }
 
+/**
+ * Molecule::Molecule(const Molecule&)
+ *
+ * Copy constructor. The state which persists between generations is copied, the Runge-Kutta and stochastic
+ * data are not, since they are recalculated before they are used.
+ *
+ * @param m the molecule to copy
+ */
+Molecule::Molecule(const Molecule& m)
+	:nodeID(m.nodeID), kind(m.kind), wasPTM(m.wasPTM), n(m.n), stoch_numMols(m.stoch_numMols),
+	 initialConcentration(m.initialConcentration), currentConcentration(m.currentConcentration),
+	 numChanges(m.numChanges), prevDir(m.prevDir), currentDir(m.currentDir),
+	 longName(m.longName), shortName(m.shortName), moleculeID(m.moleculeID){
+
+	memcpy(PTMArray, m.PTMArray, sizeof(PTMArray));
+	memcpy(rkVal, m.rkVal, sizeof(rkVal));
+}
+
+/**
+ * Molecule* Molecule::clone(Arena&)
+ * (Virtual function)
+ *
+ * @param a the arena to place the copy in
+ *
+ * @return a copy of this molecule, which must be destroyed with an explicit destructor call
+ */
+Molecule* Molecule::clone(Arena& a){
+	return new (a) Molecule(*this);
+}
+
 /**
  * Molecule::~Molecule()
  *
@@ -124,7 +158,7 @@ void Molecule::updateRkVal(int index, float amount){
  * stage of Runge-Kutta. Runge-Kutta uses successive iterations to make more accurate approximations
  * of a solution. 
  *
- * rkApprox should be used in Interaction::getEffect, to provide the Runge-Kutta corrected concentrations
+ * rkApprox gives the rate laws (see Kinetics) the Runge-Kutta corrected concentrations
  * of molecules during runge-kutta calculation instead of the base value for all iterations.
  *
  * @param rkIteration the current iteration of Runge-Kutta
@@ -186,13 +220,57 @@ void Molecule::nextPoint(float step){
 	rkVal[1] = 0;
 	rkVal[2] = 0;
 	rkVal[3] = 0;
-	
-	/*
-	 * Scoring -- Oscillation counting
-	 * 
-	 * as points are added, check to see if the direction has changed from the previous direction
-	 */
-	
+
+	countChange(oldConc);
+}
+
+/**
+ * void Molecule::repeat(int)
+ *
+ * Add a data point to the rungeKuttaSolution equal to the one a period earlier, to continue a periodic solution
+ * without integrating it. The point is scored like one computed by nextPoint.
+ *
+ * @param period the period, in timesteps
+ */
+void Molecule::repeat(int period){
+
+	float oldConc = currentConcentration;
+
+	currentConcentration = rungeKuttaSolution[rungeKuttaSolution.size() - period];
+	rungeKuttaSolution.push_back(currentConcentration);
+
+	countChange(oldConc);
+}
+
+/**
+ * void Molecule::addPoint(float)
+ *
+ * Add a data point to the rungeKuttaSolution computed by another integrator (see Integrator). The point is scored
+ * like one computed by nextPoint.
+ *
+ * @param value the concentration at the next timestep
+ */
+void Molecule::addPoint(float value){
+
+	float oldConc = currentConcentration;
+
+	currentConcentration = value < 0 ? 0 : value;
+	rungeKuttaSolution.push_back(currentConcentration);
+
+	countChange(oldConc);
+}
+
+/**
+ * void Molecule::countChange(float)
+ *
+ * Scoring -- Oscillation counting
+ *
+ * As points are added, check to see if the direction has changed from the previous direction.
+ *
+ * @param oldConc the concentration at the previous point
+ */
+void Molecule::countChange(float oldConc){
+
 	float actualChange = currentConcentration-oldConc;
 	
 	if(actualChange <= .0001 && actualChange >= -0.0001)
@@ -205,7 +283,7 @@ void Molecule::nextPoint(float step){
 	if(actualChange < 0)
 		currentDir = -1;
 	
-	t.trace("score", "%s%d - (%f , %f), dir = %d, prev = %d\n",shortName, moleculeID,currentConcentration,delta  , currentDir, prevDir);
+	t.trace("score", "%s%d - (%f , %f), dir = %d, prev = %d\n",shortName, moleculeID,currentConcentration,actualChange, currentDir, prevDir);
 
 	//if the value previously decreased and just increased, the last point was a minimum
 	if(prevDir == -1 && currentDir == 1){ 
@@ -288,8 +366,8 @@ int Molecule::getID(){
 /**
  * void Molecule::reset()
  *
- * Reset the molecule between Runge-Kutta runs. The vector containing runge-kutta data points is erased, the initial
- * concentration is added as the first element, and the rkVals are all reset to 0.
+ * Reset the molecule between Runge-Kutta or Gillespie runs. The vector containing runge-kutta data points is erased, the initial
+ * concentration is added as the first element, the stochastic data points are erased, and the rkVals are all reset to 0.
  *
  */
 void Molecule::reset(){
@@ -301,6 +379,9 @@ void Molecule::reset(){
 
 	maxima.erase(maxima.begin(), maxima.end());
 
+	stochMolCounts.clear();
+	stochTimeData.clear();
+
 	currentConcentration = initialConcentration;
 	rkVal[0] = 0;
 	rkVal[1] = 0;
@@ -353,13 +434,13 @@ vector<float>* Molecule::getStochTimeData(){
  * Add a (molecules, time) data point to the molecule
  *
  */
-int Molecule::nextPoint(float molCount, float time){
+void Molecule::nextPoint(float molCount, float time){
 
 	
 	stochMolCounts.push_back(molCount);
 	stochTimeData.push_back(time);
 
-	t.trace("stoch", "pushing back new point (%d, %d)\n", molCount, time);
+	t.trace("stoch", "pushing back new point (%f, %f)\n", molCount, time);
 
 
 }
@@ -388,6 +469,52 @@ int Molecule::getScore(){
 
 }
 
+/**
+ * void Molecule::save(Snapshot&)
+ * (Virtual function)
+ *
+ * Serialize the state of the molecule which persists between generations. The kind is written by the DerivGraph,
+ * and the Runge-Kutta solution is not saved, since it is recalculated before it is used.
+ *
+ * @param s the snapshot to append to
+ */
+void Molecule::save(Snapshot& s){
+
+	s.putInt(moleculeID);
+	s.putFloat(initialConcentration);
+	s.putFloat(currentConcentration);
+	s.putInt(numChanges);
+	s.putInt(prevDir);
+	s.putInt(currentDir);
+	s.putInt(wasPTM);
+	s.putInt(stoch_numMols);
+	s.put(PTMArray, sizeof(PTMArray));
+}
+
+/**
+ * void Molecule::load(Snapshot&)
+ * (Virtual function)
+ *
+ * Restore the state written by Molecule::save.
+ *
+ * @param s the snapshot to read from
+ */
+void Molecule::load(Snapshot& s){
+
+	moleculeID = s.getInt();
+	initialConcentration = s.getFloat();
+	currentConcentration = s.getFloat();
+	numChanges = s.getInt();
+	prevDir = s.getInt();
+	currentDir = s.getInt();
+	wasPTM = s.getInt();
+	stoch_numMols = s.getInt();
+	s.get(PTMArray, sizeof(PTMArray));
+
+	rungeKuttaSolution.clear();
+	rungeKuttaSolution.push_back(initialConcentration);
+}
+
 /**
  * void Molecule::outputRK()
  *
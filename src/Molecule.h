@@ -12,21 +12,41 @@
 #include <vector>
 #include <typeinfo>
 #include <cstring>
-#include "MersenneTwister.h"
 
 using namespace std;
 
+class Snapshot;
+class Arena;
+
+// molecule types, used to rebuild a cell from a snapshot
+enum MoleculeKind{
+	MK_MOLECULE = 0,
+	MK_NULL,
+	MK_DNA,
+	MK_MRNA,
+	MK_PROTEIN,
+	MK_COMPLEX,
+	MK_PTM
+};
+
 
 class Molecule{
 
 public:
 	Molecule();
+	Molecule(const Molecule&);
 	virtual ~Molecule();
 
+	// copy of the molecule placed in an arena, used when a DerivGraph is copied
+	virtual Molecule* clone(Arena&);
+
 	virtual float getValue();
+	float getInitialValue(){ return initialConcentration; };
 	void updateRkVal(int, float);
 	void nextPoint(float);
-	int nextPoint(float, float);
+	void nextPoint(float, float);
+	void repeat(int);
+	void addPoint(float);
 	virtual	void setValue(float);
 	void outputRK();
 	float getrkVal(int);
@@ -38,6 +58,7 @@ public:
 	int getID();
 	void reset();
 	int nodeID;
+	int kind;
 	int wasPTM;
 	int n;
 
@@ -46,13 +67,16 @@ public:
 	int getScore();
 	int PTMArray[4];
 	int getPTMCount(int, int);
-	MTRand r;
 	
 	virtual int getPTMCount(int);
 
 	vector<float>* getStochMolCounts();
 	vector<float>* getStochTimeData();
 
+	// serialization
+	virtual void save(Snapshot&);
+	virtual void load(Snapshot&);
+
 
 protected:	
 	float initialConcentration;
@@ -74,6 +98,8 @@ protected:
 	
 	vector<float> maxima;
 	vector<float> minima;
+
+	void countChange(float);
 };
 
 
@@ -0,0 +1,225 @@
+/**
+ * Parareal.cpp
+ *
+ * Parareal iterations: coarse Lawson steps across the slices, fine integration of the slices on the thread pool.
+ */
+
+#include <cmath>
+#include <sys/time.h>
+#include <time.h>
+
+#include "Parareal.h"
+
+#include "ExternTrace.h"
+
+// fine timesteps in one step of the coarse propagator
+#define PARAREAL_COARSE_RATIO 20
+
+// largest change of a slice boundary, relative to the concentration, at which the iterations stop
+#define PARAREAL_TOLERANCE 1e-5
+
+/**
+ * static double now()
+ *
+ * @return the wall clock time in seconds
+ */
+static double now(){
+
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * static double threadTime()
+ *
+ * @return the processor time of the calling thread in seconds, which unlike the wall clock does not count the time
+ * other threads had the processor
+ */
+static double threadTime(){
+
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Parareal::Parareal(Kinetics&, const vector<float>&, int, ThreadPool*)
+ *
+ * @param k the compiled reactions of the network
+ * @param nodeScale the factor each concentration is multiplied by before the rate laws see it
+ * @param method the IntegratorMethod of the fine propagator
+ * @param threads the pool the slices are integrated on, one slice for each of its threads
+ */
+Parareal::Parareal(Kinetics& k, const vector<float>& nodeScale, int method, ThreadPool* threads){
+
+	pool = threads;
+	nodes = k.getNodeCount();
+	slices = 0;
+	step = 0;
+	solution = 0;
+	iterations = 0;
+	speedup = 1;
+
+	for(int s = 0; s < pool->getThreadCount(); s++)
+		fine.push_back(new Integrator(k, nodeScale, method));
+	rough = new Integrator(k, nodeScale, INTEGRATE_LAWSON);
+}
+
+Parareal::~Parareal(){
+
+	for(unsigned int s = 0; s < fine.size(); s++)
+		delete fine[s];
+	delete rough;
+}
+
+/**
+ * int Parareal::run(const vector<float>&, float, int, vector<float>&)
+ *
+ * @param initial the concentration of every node at the start, by node id
+ * @param h the timestep
+ * @param steps the number of timesteps
+ * @param points filled with the concentration of every node after every timestep, timestep by timestep
+ *
+ * @return 1 if the iterations converged before the last one, 0 if every slice had to be integrated from its exact start
+ */
+int Parareal::run(const vector<float>& initial, float h, int steps, vector<float>& points){
+
+	double begin = now();
+
+	step = h;
+	points.resize(steps * nodes);
+	solution = points.empty() ? 0 : &points[0];
+
+	slices = (int)fine.size() < steps ? (int)fine.size() : steps;
+	iterations = 0;
+	speedup = 1;
+	if(slices == 0 || nodes == 0)
+		return 1;
+
+	start.resize(slices + 1);
+	for(int j = 0; j <= slices; j++)
+		start[j] = (int)((long)steps * j / slices);
+
+	u.resize((slices + 1) * nodes);
+	g.resize(slices * nodes);
+	f.resize(slices * nodes);
+	fineTime.resize(slices);
+
+	//the first coarse pass. The end of the last slice starts none, so it is never propagated coarsely
+	for(int n = 0; n < nodes; n++)
+		u[n] = initial[n];
+	for(int j = 0; j < slices - 1; j++){
+		coarse(j, &u[j * nodes], &g[j * nodes]);
+		for(int n = 0; n < nodes; n++)
+			u[(j + 1) * nodes + n] = g[j * nodes + n];
+	}
+
+	vector<float> next(nodes);
+	int converged = 0;
+
+	//after k iterations the first k slices were integrated from their exact start, so there are at most as many iterations as slices
+	while(iterations < slices){
+
+		//the slices integrated from their exact start in the last iteration do not change any more
+		int first = iterations;
+
+		vector<Task> tasks;
+		for(int j = first; j < slices; j++){
+			Task task = { fineTask, this, j, start[j + 1] - start[j] };
+			tasks.push_back(task);
+		}
+
+		pool->run(tasks);
+		iterations++;
+		if(iterations == slices)
+			break;
+
+		double change = 0;
+		for(int j = first; j < slices - 1; j++){
+
+			coarse(j, &u[j * nodes], &next[0]);
+
+			for(int n = 0; n < nodes; n++){
+				int e = j * nodes + n;
+				float corrected = next[n] + f[e] - g[e];
+				if(corrected < 0)
+					corrected = 0;
+
+				float old = u[e + nodes];
+				double d = fabs(corrected - old) / (1 + fabs(old));
+				if(d > change)
+					change = d;
+
+				u[e + nodes] = corrected;
+				g[e] = next[n];
+			}
+		}
+
+		if(change <= PARAREAL_TOLERANCE){
+			converged = 1;
+			break;
+		}
+	}
+
+	//the fine propagation of every slice once, one after the other, is what a serial run would have taken
+	double serial = 0;
+	for(int j = 0; j < slices; j++)
+		serial += fineTime[j];
+	double wall = now() - begin;
+	if(wall > 0)
+		speedup = serial / wall;
+
+	return converged;
+}
+
+/**
+ * void Parareal::coarse(int, const float*, float*)
+ *
+ * The coarse propagator G: Lawson steps of PARAREAL_COARSE_RATIO timesteps over a slice.
+ *
+ * @param j the slice
+ * @param from the state at the start of the slice
+ * @param to filled with the state at its end
+ */
+void Parareal::coarse(int j, const float* from, float* to){
+
+	for(int n = 0; n < nodes; n++)
+		to[n] = from[n];
+
+	int length = start[j + 1] - start[j];
+	for(int s = 0; s < length / PARAREAL_COARSE_RATIO; s++)
+		rough->step(to, step * PARAREAL_COARSE_RATIO);
+	if(length % PARAREAL_COARSE_RATIO)
+		rough->step(to, step * (length % PARAREAL_COARSE_RATIO));
+}
+
+/**
+ * static void Parareal::fineTask(void*, int)
+ *
+ * The fine propagator F of a slice, from the state the last correction gave its start. Its points are written to the
+ * solution, and its end to f.
+ *
+ * @param parareal the Parareal object
+ * @param j the slice
+ */
+void Parareal::fineTask(void* parareal, int j){
+
+	Parareal* p = (Parareal*)parareal;
+	int nodes = p->nodes;
+	double begin = threadTime();
+
+	const float* c = &p->u[j * nodes];
+	for(int s = p->start[j]; s < p->start[j + 1]; s++){
+		float* point = p->solution + s * nodes;
+		for(int n = 0; n < nodes; n++)
+			point[n] = c[n];
+		p->fine[j]->step(point, p->step);
+		c = point;
+	}
+
+	for(int n = 0; n < nodes; n++)
+		p->f[j * nodes + n] = c[n];
+
+	p->fineTime[j] = threadTime() - begin;
+}
@@ -0,0 +1,73 @@
+/**
+ * Parareal.h
+ *
+ * Parallel-in-time integration of the rate equations of a network (the Parareal method).
+ *
+ * The run is cut into one time slice per thread of a pool. A cheap coarse propagator G, a few long Lawson steps per
+ * slice (see Integrator), carries the state across the slices one after the other, while the fine propagator F, the
+ * integration Cell asked for at the full timestep, runs on all slices at once from the states G gave. Every iteration
+ * then corrects the state at the start of each slice:
+ *   U[j+1] = G(U[j]) + F(U[j] of the last iteration) - G(U[j] of the last iteration)
+ * which is exact on one more slice every iteration, and usually within the tolerance much sooner. The fine points of
+ * the last iteration are the solution.
+ *
+ * The fine work is spread over the slices, so the wall time is that of about one slice per iteration, plus the coarse
+ * passes; the speedup over a serial fine run is getSpeedup().
+ *
+ */
+
+#ifndef PARAREAL_H_
+#define PARAREAL_H_
+
+#include <vector>
+
+#include "Kinetics.h"
+#include "Integrator.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+class Parareal{
+
+public:
+	Parareal(Kinetics&, const vector<float>&, int, ThreadPool*);
+	~Parareal();
+
+	int run(const vector<float>&, float, int, vector<float>&);
+
+	int getSliceCount(){ return slices; };
+	int getIterations(){ return iterations; };
+	double getSpeedup(){ return speedup; };
+
+private:
+	static void fineTask(void*, int);
+	void coarse(int, const float*, float*);
+
+	ThreadPool* pool;
+	int nodes;
+	int slices;
+
+	// the first timestep of every slice, and the end of the last one
+	vector<int> start;
+
+	// a fine integrator for every slice, and the coarse one
+	vector<Integrator*> fine;
+	Integrator* rough;
+
+	// the timestep of the run, and the fine solution, point by point
+	float step;
+	float* solution;
+
+	// the state at the start of every slice, and G and F of the last iteration at its end, slice by slice
+	vector<float> u;
+	vector<float> g;
+	vector<float> f;
+
+	// processor time of the fine propagation of every slice, in the last iteration
+	vector<double> fineTime;
+
+	int iterations;
+	double speedup;
+};
+
+#endif
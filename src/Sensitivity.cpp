@@ -0,0 +1,147 @@
+/**
+ * Sensitivity.cpp
+ *
+ * Integration of the rate equations of a network together with their sensitivities to every rate constant.
+ *
+ * The state is laid out as the concentrations y followed by the sensitivity vector of each reaction, all by node id.
+ */
+
+#include <cmath>
+
+#include "Sensitivity.h"
+
+#include "ExternTrace.h"
+
+// amplitudes smaller than this are too flat for a relative sensitivity, which is then left at 0
+#define SENSITIVITY_MIN_AMPLITUDE 1e-4
+
+/**
+ * int Sensitivity::evaluate(Kinetics&, const vector<float>&, const vector<float>&, int, float, float)
+ *
+ * Integrate the network and the sensitivities of the amplitude of one molecule.
+ *
+ * @param k the compiled reactions of the network
+ * @param initial the initial concentration of every node, by node id
+ * @param nodeScale the factor each concentration is multiplied by before the rate laws see it (the histone
+ *        modification of DNA, 0 for the null node, otherwise 1)
+ * @param target the node id of the molecule whose amplitude is analysed
+ * @param step the Runge-Kutta timestep
+ * @param limit the length of the run
+ *
+ * @return 1 if the amplitude was large enough to give relative sensitivities, 0 otherwise
+ */
+int Sensitivity::evaluate(Kinetics& k, const vector<float>& initial, const vector<float>& nodeScale, int target, float step, float limit){
+
+	kinetics = &k;
+	nodes = k.getNodeCount();
+	reactions = k.getReactionCount();
+	scale = nodeScale;
+
+	amplitude = 0;
+	relative.assign(reactions, 0);
+
+	if(reactions == 0)
+		return 0;
+
+	x.resize(nodes);
+	dx.resize(nodes);
+	v.resize(reactions);
+	dv.resize(reactions);
+	u.resize(reactions);
+
+	int size = nodes * (reactions + 1);
+	vector<float> z(size, 0), stage(size), k1(size), k2(size), k3(size), k4(size);
+
+	for(int n = 0; n < nodes; n++)
+		z[n] = initial[n];
+
+	//the sensitivities of the target at its highest and lowest point
+	vector<float> high(reactions), low(reactions);
+	float highest = 0;
+	float lowest = 0;
+	int tracking = 0;
+
+	for(float i = 0; i < limit; i += step){
+
+		derivative(&z[0], &k1[0]);
+		for(int e = 0; e < size; e++)
+			stage[e] = z[e] + step / 2 * k1[e];
+		derivative(&stage[0], &k2[0]);
+		for(int e = 0; e < size; e++)
+			stage[e] = z[e] + step / 2 * k2[e];
+		derivative(&stage[0], &k3[0]);
+		for(int e = 0; e < size; e++)
+			stage[e] = z[e] + step * k3[e];
+		derivative(&stage[0], &k4[0]);
+
+		for(int e = 0; e < size; e++)
+			z[e] += step / 6 * (k1[e] + 2 * k2[e] + 2 * k3[e] + k4[e]);
+
+		//concentrations are kept non-negative, as in Molecule::nextPoint, and a clamped one does not depend on the rates
+		for(int n = 0; n < nodes; n++){
+			if(z[n] >= 0)
+				continue;
+			z[n] = 0;
+			for(int p = 0; p < reactions; p++)
+				z[nodes * (p + 1) + n] = 0;
+		}
+
+		if(i + step < limit / 2)
+			continue;
+
+		float y = z[target];
+		if(!tracking || y > highest){
+			highest = y;
+			for(int p = 0; p < reactions; p++)
+				high[p] = z[nodes * (p + 1) + target];
+		}
+		if(!tracking || y < lowest){
+			lowest = y;
+			for(int p = 0; p < reactions; p++)
+				low[p] = z[nodes * (p + 1) + target];
+		}
+		tracking = 1;
+	}
+
+	amplitude = highest - lowest;
+	if(amplitude < SENSITIVITY_MIN_AMPLITUDE)
+		return 0;
+
+	for(int p = 0; p < reactions; p++)
+		relative[p] = k.getRateConstant(p) * (high[p] - low[p]) / amplitude;
+
+	return 1;
+}
+
+/**
+ * void Sensitivity::derivative(const float*, float*)
+ *
+ * The right hand side of the rate equations and of their sensitivity equations.
+ *
+ * @param z the concentrations followed by the sensitivities
+ * @param dz filled with their derivatives
+ */
+void Sensitivity::derivative(const float* z, float* dz){
+
+	for(int n = 0; n < nodes; n++){
+		x[n] = scale[n] * z[n];
+		if(x[n] < 0)
+			x[n] = 0;
+	}
+
+	kinetics->getFlux(&x[0], &v[0]);
+	kinetics->scatter(&v[0], dz);
+	kinetics->getRateDerivative(&x[0], &u[0]);
+
+	for(int p = 0; p < reactions; p++){
+		const float* s = z + nodes * (p + 1);
+
+		for(int n = 0; n < nodes; n++)
+			dx[n] = x[n] > 0 ? scale[n] * s[n] : 0;
+
+		//J s_p, plus the direct effect of k_p on its own reaction
+		kinetics->getFluxTangent(&x[0], &dx[0], &dv[0]);
+		dv[p] += u[p];
+		kinetics->scatter(&dv[0], dz + nodes * (p + 1));
+	}
+}
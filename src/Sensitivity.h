@@ -0,0 +1,55 @@
+/**
+ * Sensitivity.h
+ *
+ * Forward sensitivity analysis of the oscillation amplitude of a network with respect to its rate constants.
+ *
+ * The sensitivity s_p = dy/dk_p of the concentrations y to the rate constant k_p of reaction p follows
+ * ds_p/dt = J s_p + df/dk_p, where J is the Jacobian of the rate equations. It is integrated alongside y with the
+ * same fourth order Runge-Kutta steps, using the analytic derivatives of the rate laws given by Kinetics.
+ *
+ * The amplitude of a molecule is the difference between its highest and lowest concentration in the second half of
+ * the run, after the start-up transient. Its sensitivity to k_p is s_p at the highest point less s_p at the lowest,
+ * given relative to the amplitude and k_p: the fraction the amplitude changes by per fraction k_p changes by.
+ *
+ */
+
+#ifndef SENSITIVITY_H_
+#define SENSITIVITY_H_
+
+#include <vector>
+
+#include "Kinetics.h"
+
+using namespace std;
+
+class Sensitivity{
+
+public:
+	int evaluate(Kinetics&, const vector<float>&, const vector<float>&, int, float, float);
+
+	float getAmplitude(){ return amplitude; };
+	float get(int r){ return relative[r]; };
+
+private:
+	void derivative(const float*, float*);
+
+	Kinetics* kinetics;
+	int nodes;
+	int reactions;
+
+	// how the rate laws see the concentration of each node
+	vector<float> scale;
+
+	// work space of derivative()
+	vector<float> x;
+	vector<float> dx;
+	vector<float> v;
+	vector<float> dv;
+	vector<float> u;
+
+	// results of the last evaluation
+	float amplitude;
+	vector<float> relative;
+};
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ * Spectrum.cpp
+ *
+ * Radix-2 fast Fourier transform, and the autocorrelation measurement of oscillations.
+ *
+ * The transform of a pair of real trajectories a + ib is split into the transforms of a and b by their symmetry:
+ *   A[k] = (Z[k] + conj(Z[M-k])) / 2,   B[k] = (Z[k] - conj(Z[M-k])) / 2i
+ * The power spectra |A|^2 + i|B|^2 are transformed back together, giving both autocorrelations at once.
+ */
+
+#include <cmath>
+
+#include "Spectrum.h"
+
+#include "ExternTrace.h"
+
+// trajectories with a smaller amplitude (sqrt(2) times the standard deviation) do not oscillate
+#define SPECTRUM_MIN_AMPLITUDE 0.001
+
+// periods of fewer timesteps are not resolved by the solver, and are taken as integration jitter
+#define SPECTRUM_MIN_PERIOD 8
+
+Spectrum::Spectrum(){
+	size = 0;
+}
+
+/**
+ * void Spectrum::plan(int)
+ *
+ * Prepare the permutation and twiddle factors of a transform length, if it changed.
+ *
+ * @param n the transform length, a power of two
+ */
+void Spectrum::plan(int n){
+
+	if(n == size)
+		return;
+
+	size = n;
+
+	int bits = 0;
+	while((1 << bits) < n)
+		bits++;
+
+	reversed.resize(n);
+	for(int k = 0; k < n; k++){
+		int r = 0;
+		for(int b = 0; b < bits; b++)
+			if(k & (1 << b))
+				r |= 1 << (bits - 1 - b);
+		reversed[k] = r;
+	}
+
+	twiddle.resize(n / 2);
+	for(int k = 0; k < n / 2; k++)
+		twiddle[k] = polar(1.0, -2 * M_PI * k / n);
+}
+
+/**
+ * void Spectrum::transform(vector<complex<double> >&, int)
+ *
+ * In place iterative Cooley-Tukey transform of the planned length. The inverse is not scaled by 1/n.
+ *
+ * @param x the sequence to transform
+ * @param inverse 1 for the inverse transform
+ */
+void Spectrum::transform(vector<complex<double> >& x, int inverse){
+
+	for(int k = 0; k < size; k++)
+		if(k < reversed[k])
+			swap(x[k], x[reversed[k]]);
+
+	for(int len = 2; len <= size; len *= 2){
+		int stride = size / len;
+		for(int start = 0; start < size; start += len){
+			for(int k = 0; k < len / 2; k++){
+				complex<double> w = inverse ? conj(twiddle[k * stride]) : twiddle[k * stride];
+				complex<double> u = x[start + k];
+				complex<double> v = x[start + k + len / 2] * w;
+				x[start + k] = u + v;
+				x[start + k + len / 2] = u - v;
+			}
+		}
+	}
+}
+
+/**
+ * void Spectrum::analyse(const vector<vector<float>*>&, float, vector<Oscillation>&)
+ *
+ * Measure the oscillation of every trajectory in one batch. All trajectories must have the same length.
+ *
+ * @param trajectories the Runge-Kutta solutions
+ * @param step the Runge-Kutta timestep
+ * @param results filled with the oscillation of each trajectory
+ */
+void Spectrum::analyse(const vector<vector<float>*>& trajectories, float step, vector<Oscillation>& results){
+
+	int count = trajectories.size();
+	results.resize(count);
+	if(count == 0)
+		return;
+
+	int length = trajectories[0]->size();
+	int start = length / 4;
+	int n = length - start;
+	float duration = (length - 1) * step;
+
+	//twice the length, so the circular autocorrelation of the transform is the linear one
+	int m = 1;
+	while(m < 2 * n)
+		m *= 2;
+	plan(m);
+
+	signal.resize(m);
+	power.resize(m);
+	vector<double> acf[2];
+	acf[0].resize(n);
+	acf[1].resize(n);
+
+	for(int first = 0; first < count; first += 2){
+
+		int pair = (first + 1 < count);
+		const vector<float>& a = *trajectories[first];
+		const vector<float>& b = *trajectories[pair ? first + 1 : first];
+
+		double meanA = 0, meanB = 0;
+		for(int k = 0; k < n; k++){
+			meanA += a[start + k];
+			meanB += b[start + k];
+		}
+		meanA /= n;
+		meanB /= n;
+
+		for(int k = 0; k < n; k++)
+			signal[k] = complex<double>(a[start + k] - meanA, pair ? b[start + k] - meanB : 0);
+		for(int k = n; k < m; k++)
+			signal[k] = 0;
+
+		transform(signal, 0);
+
+		for(int k = 0; k < m; k++){
+			complex<double> z = signal[k];
+			complex<double> c = conj(signal[(m - k) % m]);
+			double pa = norm(z + c) / 4;
+			double pb = norm(z - c) / 4;
+			power[k] = complex<double>(pa, pb);
+		}
+
+		transform(power, 1);
+
+		for(int k = 0; k < n; k++){
+			acf[0][k] = power[k].real() / m;
+			acf[1][k] = power[k].imag() / m;
+		}
+
+		measure(acf[0], n, step, duration, results[first]);
+		if(pair)
+			measure(acf[1], n, step, duration, results[first + 1]);
+	}
+}
+
+/**
+ * void Spectrum::measure(const vector<double>&, int, float, float, Oscillation&)
+ *
+ * Find the period, regularity and damping of a trajectory from its autocorrelation.
+ *
+ * @param acf the autocorrelation sums of the trajectory, by lag
+ * @param n the number of points of the trajectory
+ * @param step the timestep between points
+ * @param duration the length of the whole run
+ * @param o filled with the oscillation
+ */
+void Spectrum::measure(const vector<double>& acf, int n, float step, float duration, Oscillation& o){
+
+	o.period = 0;
+	o.amplitude = 0;
+	o.regularity = 0;
+	o.damping = 0;
+	o.score = 0;
+
+	if(acf[0] <= 0)
+		return;
+
+	o.amplitude = sqrt(2 * acf[0] / n);
+	if(o.amplitude < SPECTRUM_MIN_AMPLITUDE)
+		return;
+
+	//normalized autocorrelation, with each lag averaged over the points it covers. Longer lags are too noisy
+	int limit = n / 2;
+	vector<double> r(limit);
+	for(int k = 0; k < limit; k++)
+		r[k] = acf[k] * n / ((n - k) * acf[0]);
+
+	//past the first zero crossing and the trough after it, to the first peak
+	int lag = 1;
+	while(lag < limit && r[lag] > 0)
+		lag++;
+	while(lag + 1 < limit && r[lag + 1] <= r[lag])
+		lag++;
+	while(lag + 1 < limit && r[lag + 1] >= r[lag])
+		lag++;
+
+	if(lag + 1 >= limit || lag < SPECTRUM_MIN_PERIOD || r[lag] <= 0)
+		return;
+
+	o.period = lag * step;
+	o.regularity = r[lag] < 1 ? r[lag] : 1;
+	o.damping = -log(o.regularity) / o.period;
+	o.score = (int)(2 * duration / o.period * o.regularity + .5);
+}
@@ -0,0 +1,56 @@
+/**
+ * Spectrum.h
+ *
+ * Spectral measurement of the oscillations in the Runge-Kutta solutions of a network.
+ *
+ * The autocorrelation of every trajectory is computed with zero padded fast Fourier transforms, two real trajectories
+ * to one complex transform. The period is the lag of the first peak of the autocorrelation after it turns negative,
+ * and the height of that peak (1 for a sustained oscillation, less for a damped or irregular one) is the regularity.
+ * The first quarter of every run is left out as the start-up transient.
+ *
+ * The score of a trajectory is the number of extrema a sustained oscillation of its period would have over the whole
+ * run, weighted by the regularity, so it can be compared with the direction change count of Molecule::getScore().
+ * Trajectories whose amplitude is below SPECTRUM_MIN_AMPLITUDE score 0, as does numerical jitter, which has no
+ * autocorrelation peak or one at a lag of a few timesteps.
+ *
+ */
+
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+#include <vector>
+#include <complex>
+
+using namespace std;
+
+// the oscillation measured in one trajectory. The period is 0 if there is none
+struct Oscillation{
+	float period;
+	float amplitude;
+	float regularity;
+	float damping;
+	int score;
+};
+
+class Spectrum{
+
+public:
+	Spectrum();
+
+	void analyse(const vector<vector<float>*>&, float, vector<Oscillation>&);
+
+private:
+	void plan(int);
+	void transform(vector<complex<double> >&, int);
+	void measure(const vector<double>&, int, float, float, Oscillation&);
+
+	// transform length, a power of two, with its bit reversal permutation and twiddle factors
+	int size;
+	vector<int> reversed;
+	vector<complex<double> > twiddle;
+
+	vector<complex<double> > signal;
+	vector<complex<double> > power;
+};
+
+#endif
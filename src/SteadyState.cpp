@@ -0,0 +1,552 @@
+/**
+ * SteadyState.cpp
+ *
+ * Newton solution of the steady state of a network, and the eigenvalues of its Jacobian there.
+ *
+ * The Jacobian is built a column at a time from the analytic flux derivatives of Kinetics, and the linear algebra is
+ * done in double precision on the nodes some reaction changes.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "SteadyState.h"
+
+#include "ExternTrace.h"
+
+// the steady state is found once no concentration changes faster than this
+#define STEADY_TOLERANCE 1e-6
+
+// Newton iterations before giving up on finding a steady state
+#define STEADY_MAX_ITERATIONS 100
+
+// pseudo timestep of the first Newton iteration, and the largest it grows to
+#define STEADY_INITIAL_STEP 1
+#define STEADY_MAX_STEP 1e12
+
+// eigenvalues with a real part closer to 0 than this are neither stable nor unstable
+#define STEADY_MARGIN 1e-5
+
+// QR iterations per eigenvalue before the eigenvalue solver gives up
+#define STEADY_MAX_QR 30
+
+/**
+ * int SteadyState::solve(Kinetics&, const vector<float>&, const vector<float>&, int)
+ *
+ * Find the steady state reached from the initial concentrations, and the eigenvalues of the Jacobian there.
+ *
+ * @param k the compiled reactions of the network
+ * @param initial the initial concentration of every node, by node id
+ * @param nodeScale the factor each concentration is multiplied by before the rate laws see it (the histone
+ *        modification of DNA, 0 for the null node, otherwise 1)
+ * @param predicted 1 if initial is a prediction of the steady state, to be refined by plain Newton iterations
+ *
+ * @return 1 if the steady state and its eigenvalues were found, 0 if the iterations did not converge
+ */
+int SteadyState::solve(Kinetics& k, const vector<float>& initial, const vector<float>& nodeScale, int predicted){
+
+	kinetics = &k;
+	nodes = k.getNodeCount();
+	reactions = k.getReactionCount();
+	scale = nodeScale;
+
+	real.clear();
+	imag.clear();
+	iterations = 0;
+
+	x.resize(nodes);
+	dx.assign(nodes, 0);
+	v.resize(reactions);
+	dv.resize(reactions);
+
+	//the nodes in the column of some reaction, leaving out those the rate laws do not see
+	vector<char> changed(nodes, 0);
+	vector<float> column(nodes);
+	for(int r = 0; r < reactions; r++){
+		dv.assign(reactions, 0);
+		dv[r] = 1;
+		k.scatter(&dv[0], &column[0]);
+		for(int n = 0; n < nodes; n++)
+			if(column[n] != 0)
+				changed[n] = 1;
+	}
+
+	active.clear();
+	for(int n = 0; n < nodes; n++)
+		if(changed[n] && scale[n] != 0)
+			active.push_back(n);
+
+	int m = active.size();
+	vector<float> z(initial), f(nodes);
+	vector<double> a, b(m);
+
+	//concentrations are kept from going negative, as in Runge-Kutta, so a molecule which is used up while its
+	//concentration is 0 stays at 0
+	vector<char> pinned(m);
+
+	//switched evolution relaxation: the pseudo timestep grows as the residual falls
+	double h = predicted ? STEADY_MAX_STEP : STEADY_INITIAL_STEP;
+	double previous = 0;
+
+	for(;; iterations++){
+
+		derivative(&z[0], &f[0]);
+
+		double residual = 0;
+		for(int i = 0; i < m; i++){
+			pinned[i] = z[active[i]] == 0 && f[active[i]] < 0;
+			if(!pinned[i])
+				residual = fmax(residual, fabs(f[active[i]]));
+		}
+
+		if(residual < STEADY_TOLERANCE)
+			break;
+
+		if(iterations == STEADY_MAX_ITERATIONS){
+			t.trace("hopf","No steady state after %d iterations, residual %g\n", iterations, residual);
+			return 0;
+		}
+
+		if(iterations > 0)
+			h = fmin(h * previous / residual, STEADY_MAX_STEP);
+		previous = residual;
+
+		//(I/h - J) d = f
+		jacobian(&z[0], a);
+		for(int i = 0; i < m; i++){
+			for(int j = 0; j < m; j++)
+				a[i * m + j] = -a[i * m + j];
+			a[i * m + i] += 1 / h;
+			b[i] = f[active[i]];
+
+			if(pinned[i]){
+				for(int j = 0; j < m; j++)
+					a[i * m + j] = i == j;
+				b[i] = 0;
+			}
+		}
+
+		if(!linearSolve(a, b, m)){
+			t.trace("hopf","Singular Newton iteration %d\n", iterations);
+			return 0;
+		}
+
+		for(int i = 0; i < m; i++){
+			z[active[i]] += b[i];
+			if(z[active[i]] < 0)
+				z[active[i]] = 0;
+		}
+	}
+
+	state = z;
+
+	//a pinned molecule returns to 0 whenever it is moved off it, so only the others decide the stability
+	int free = 0;
+	for(int i = 0; i < m; i++)
+		if(!pinned[i])
+			active[free++] = active[i];
+	active.resize(free);
+	m = free;
+
+	jacobian(&z[0], a);
+	hessenberg(a, m);
+	if(!eigenvalues(a, m, real, imag)){
+		t.trace("hopf","Eigenvalues did not converge\n");
+		return 0;
+	}
+
+	t.trace("hopf","Steady state of %d nodes after %d iterations, spectral abscissa %g%s\n", m, iterations, getAbscissa(), hasHopf() ? ", unstable focus" : "");
+	return 1;
+}
+
+/**
+ * int SteadyState::isStable()
+ *
+ * @return 1 if every eigenvalue has a negative real part, so the steady state attracts the nearby trajectories
+ */
+int SteadyState::isStable(){
+
+	for(unsigned int i = 0; i < real.size(); i++)
+		if(real[i] > -STEADY_MARGIN)
+			return 0;
+	return 1;
+}
+
+/**
+ * int SteadyState::hasHopf()
+ *
+ * @return 1 if a complex pair of eigenvalues has a positive real part, so the trajectories spiral away from the
+ *         steady state
+ */
+int SteadyState::hasHopf(){
+
+	for(unsigned int i = 0; i < real.size(); i++)
+		if(real[i] > STEADY_MARGIN && imag[i] != 0)
+			return 1;
+	return 0;
+}
+
+/**
+ * double SteadyState::getAbscissa()
+ *
+ * @return the largest real part of the eigenvalues, or -HUGE_VAL if no node changes
+ */
+double SteadyState::getAbscissa(){
+
+	double abscissa = -HUGE_VAL;
+	for(unsigned int i = 0; i < real.size(); i++)
+		abscissa = fmax(abscissa, real[i]);
+	return abscissa;
+}
+
+/**
+ * double SteadyState::getOscillatoryAbscissa(double*)
+ *
+ * The largest real part of the complex eigenvalues, which changes sign where a Hopf bifurcation makes the steady
+ * state start or stop oscillating.
+ *
+ * @param frequency if not null, filled with the angular frequency of that eigenvalue
+ *
+ * @return the real part, or -HUGE_VAL if all eigenvalues are real
+ */
+double SteadyState::getOscillatoryAbscissa(double* frequency){
+
+	double abscissa = -HUGE_VAL;
+	double omega = 0;
+	for(unsigned int i = 0; i < real.size(); i++){
+		if(imag[i] != 0 && real[i] > abscissa){
+			abscissa = real[i];
+			omega = fabs(imag[i]);
+		}
+	}
+
+	if(frequency)
+		*frequency = omega;
+	return abscissa;
+}
+
+/**
+ * void SteadyState::derivative(const float*, float*)
+ *
+ * @param z the concentration of every node
+ * @param f filled with the change of the concentration of every node
+ */
+void SteadyState::derivative(const float* z, float* f){
+
+	for(int n = 0; n < nodes; n++){
+		x[n] = scale[n] * z[n];
+		if(x[n] < 0)
+			x[n] = 0;
+	}
+
+	kinetics->getFlux(&x[0], &v[0]);
+	kinetics->scatter(&v[0], f);
+}
+
+/**
+ * void SteadyState::jacobian(const float*, vector<double>&)
+ *
+ * @param z the concentration of every node
+ * @param a filled with the Jacobian of the active nodes, row by row
+ */
+void SteadyState::jacobian(const float* z, vector<double>& a){
+
+	int m = active.size();
+	a.resize(m * m);
+
+	for(int n = 0; n < nodes; n++){
+		x[n] = scale[n] * z[n];
+		if(x[n] < 0)
+			x[n] = 0;
+	}
+
+	vector<float> column(nodes);
+	for(int j = 0; j < m; j++){
+		dx[active[j]] = scale[active[j]];
+		kinetics->getFluxTangent(&x[0], &dx[0], &dv[0]);
+		kinetics->scatter(&dv[0], &column[0]);
+		dx[active[j]] = 0;
+
+		for(int i = 0; i < m; i++)
+			a[i * m + j] = column[active[i]];
+	}
+}
+
+/**
+ * static int SteadyState::linearSolve(vector<double>&, vector<double>&, int)
+ *
+ * Gaussian elimination with partial pivoting.
+ *
+ * @param a the matrix, row by row, destroyed
+ * @param b the right hand side, replaced by the solution
+ * @param m the size of the system
+ *
+ * @return 1 on success, 0 if the matrix is singular
+ */
+int SteadyState::linearSolve(vector<double>& a, vector<double>& b, int m){
+
+	for(int c = 0; c < m; c++){
+
+		int pivot = c;
+		for(int i = c + 1; i < m; i++)
+			if(fabs(a[i * m + c]) > fabs(a[pivot * m + c]))
+				pivot = i;
+
+		if(a[pivot * m + c] == 0)
+			return 0;
+
+		if(pivot != c){
+			for(int j = c; j < m; j++)
+				swap(a[c * m + j], a[pivot * m + j]);
+			swap(b[c], b[pivot]);
+		}
+
+		for(int i = c + 1; i < m; i++){
+			double y = a[i * m + c] / a[c * m + c];
+			if(y == 0)
+				continue;
+			for(int j = c; j < m; j++)
+				a[i * m + j] -= y * a[c * m + j];
+			b[i] -= y * b[c];
+		}
+	}
+
+	for(int i = m - 1; i >= 0; i--){
+		double s = b[i];
+		for(int j = i + 1; j < m; j++)
+			s -= a[i * m + j] * b[j];
+		b[i] = s / a[i * m + i];
+	}
+	return 1;
+}
+
+/**
+ * static void SteadyState::hessenberg(vector<double>&, int)
+ *
+ * Reduce a matrix to upper Hessenberg form by similarity transforms (Gaussian elimination with pivoting), keeping
+ * its eigenvalues.
+ *
+ * @param a the matrix, row by row
+ * @param m its size
+ */
+void SteadyState::hessenberg(vector<double>& a, int m){
+
+	for(int c = 1; c < m - 1; c++){
+
+		int pivot = c;
+		for(int i = c + 1; i < m; i++)
+			if(fabs(a[i * m + c - 1]) > fabs(a[pivot * m + c - 1]))
+				pivot = i;
+
+		double p = a[pivot * m + c - 1];
+
+		if(pivot != c){
+			for(int j = c - 1; j < m; j++)
+				swap(a[pivot * m + j], a[c * m + j]);
+			for(int i = 0; i < m; i++)
+				swap(a[i * m + pivot], a[i * m + c]);
+		}
+
+		if(p == 0)
+			continue;
+
+		for(int i = c + 1; i < m; i++){
+			double y = a[i * m + c - 1] / p;
+			if(y == 0)
+				continue;
+			for(int j = c; j < m; j++)
+				a[i * m + j] -= y * a[c * m + j];
+			for(int j = 0; j < m; j++)
+				a[j * m + c] += y * a[j * m + i];
+		}
+	}
+
+	for(int i = 2; i < m; i++)
+		for(int j = 0; j < i - 1; j++)
+			a[i * m + j] = 0;
+}
+
+/**
+ * static int SteadyState::eigenvalues(vector<double>&, int, vector<double>&, vector<double>&)
+ *
+ * The eigenvalues of an upper Hessenberg matrix, by the QR algorithm with Francis double shifts. Eigenvalues are
+ * split off the bottom of the matrix as the subdiagonal there vanishes, one real eigenvalue or one complex pair at
+ * a time.
+ *
+ * @param a the Hessenberg matrix, row by row, destroyed
+ * @param m its size
+ * @param wr filled with the real parts of the eigenvalues
+ * @param wi filled with the imaginary parts
+ *
+ * @return 1 on success, 0 if an eigenvalue did not converge
+ */
+int SteadyState::eigenvalues(vector<double>& a, int m, vector<double>& wr, vector<double>& wi){
+
+	#define A(i, j) a[(i) * m + (j)]
+
+	wr.assign(m, 0);
+	wi.assign(m, 0);
+
+	double norm = 0;
+	for(int i = 0; i < m; i++)
+		for(int j = i > 0 ? i - 1 : 0; j < m; j++)
+			norm += fabs(A(i, j));
+
+	int nn = m - 1;
+	double shift = 0;
+	double p = 0, q = 0, r = 0, s, w, x, y, z = 0;
+
+	while(nn >= 0){
+
+		int its = 0;
+		int l;
+		do{
+			//look for a negligible subdiagonal element
+			for(l = nn; l >= 1; l--){
+				s = fabs(A(l - 1, l - 1)) + fabs(A(l, l));
+				if(s == 0)
+					s = norm;
+				if(fabs(A(l, l - 1)) + s == s){
+					A(l, l - 1) = 0;
+					break;
+				}
+			}
+
+			x = A(nn, nn);
+
+			//one real eigenvalue
+			if(l == nn){
+				wr[nn] = x + shift;
+				wi[nn] = 0;
+				nn--;
+				continue;
+			}
+
+			y = A(nn - 1, nn - 1);
+			w = A(nn, nn - 1) * A(nn - 1, nn);
+
+			//a 2 by 2 block: two real eigenvalues or a complex pair
+			if(l == nn - 1){
+				p = .5 * (y - x);
+				q = p * p + w;
+				z = sqrt(fabs(q));
+				x += shift;
+				if(q >= 0){
+					z = p + (p >= 0 ? z : -z);
+					wr[nn - 1] = wr[nn] = x + z;
+					if(z != 0)
+						wr[nn] = x - w / z;
+					wi[nn - 1] = wi[nn] = 0;
+				}
+				else{
+					wr[nn - 1] = wr[nn] = x + p;
+					wi[nn - 1] = -z;
+					wi[nn] = z;
+				}
+				nn -= 2;
+				continue;
+			}
+
+			if(its == STEADY_MAX_QR)
+				return 0;
+
+			//exceptional shifts break cycles of the iteration
+			if(its == 10 || its == 20){
+				shift += x;
+				for(int i = 0; i <= nn; i++)
+					A(i, i) -= x;
+				s = fabs(A(nn, nn - 1)) + fabs(A(nn - 1, nn - 2));
+				y = x = .75 * s;
+				w = -.4375 * s * s;
+			}
+			its++;
+
+			//look for two consecutive small subdiagonal elements
+			int k;
+			for(k = nn - 2; k >= l; k--){
+				z = A(k, k);
+				r = x - z;
+				s = y - z;
+				p = (r * s - w) / A(k + 1, k) + A(k, k + 1);
+				q = A(k + 1, k + 1) - z - r - s;
+				r = A(k + 2, k + 1);
+				s = fabs(p) + fabs(q) + fabs(r);
+				p /= s;
+				q /= s;
+				r /= s;
+				if(k == l)
+					break;
+				double u = fabs(A(k, k - 1)) * (fabs(q) + fabs(r));
+				double e = fabs(p) * (fabs(A(k - 1, k - 1)) + fabs(z) + fabs(A(k + 1, k + 1)));
+				if(u + e == e)
+					break;
+			}
+
+			for(int i = k + 2; i <= nn; i++){
+				A(i, i - 2) = 0;
+				if(i != k + 2)
+					A(i, i - 3) = 0;
+			}
+
+			//double QR step on rows l to nn and columns k to nn
+			for(int c = k; c <= nn - 1; c++){
+				if(c != k){
+					p = A(c, c - 1);
+					q = A(c + 1, c - 1);
+					r = c != nn - 1 ? A(c + 2, c - 1) : 0;
+					x = fabs(p) + fabs(q) + fabs(r);
+					if(x != 0){
+						p /= x;
+						q /= x;
+						r /= x;
+					}
+				}
+
+				s = sqrt(p * p + q * q + r * r);
+				if(p < 0)
+					s = -s;
+				if(s == 0)
+					continue;
+
+				if(c == k){
+					if(l != k)
+						A(c, c - 1) = -A(c, c - 1);
+				}
+				else
+					A(c, c - 1) = -s * x;
+
+				p += s;
+				x = p / s;
+				y = q / s;
+				z = r / s;
+				q /= p;
+				r /= p;
+
+				for(int j = c; j <= nn; j++){
+					p = A(c, j) + q * A(c + 1, j);
+					if(c != nn - 1){
+						p += r * A(c + 2, j);
+						A(c + 2, j) -= p * z;
+					}
+					A(c + 1, j) -= p * y;
+					A(c, j) -= p * x;
+				}
+
+				int last = nn < c + 3 ? nn : c + 3;
+				for(int i = l; i <= last; i++){
+					p = x * A(i, c) + y * A(i, c + 1);
+					if(c != nn - 1){
+						p += z * A(i, c + 2);
+						A(i, c + 2) -= p * r;
+					}
+					A(i, c + 1) -= p * q;
+					A(i, c) -= p;
+				}
+			}
+		} while(nn >= 0 && l < nn - 1);
+	}
+
+	#undef A
+
+	return 1;
+}
@@ -0,0 +1,77 @@
+/**
+ * SteadyState.h
+ *
+ * Linear stability of a network at its steady state, a cheap test of whether it can keep oscillating.
+ *
+ * The steady state is found from the initial concentrations by damped Newton iterations on the rate equations
+ * (pseudo-transient continuation): each step solves (I/h - J) d = f, where f is the change of the concentrations, J
+ * its Jacobian and h a pseudo timestep grown as the change shrinks, so the first steps follow the trajectory and the
+ * last ones are plain Newton steps. Molecules no reaction changes (DNA without a promoter, the null node) are left
+ * out, as they would make J singular.
+ *
+ * A steady state close to a known one, as when a parameter is changed a little (see Continuation), is found by plain
+ * Newton iterations from the prediction instead.
+ *
+ * The eigenvalues of J at the steady state are found by the QR algorithm on its Hessenberg form. If they all have a
+ * negative real part the steady state attracts the trajectory, which decays to it instead of oscillating. A complex
+ * pair with a positive real part is the signature of a Hopf bifurcation, past which a limit cycle appears.
+ *
+ */
+
+#ifndef STEADYSTATE_H_
+#define STEADYSTATE_H_
+
+#include <vector>
+
+#include "Kinetics.h"
+
+using namespace std;
+
+class SteadyState{
+
+public:
+	int solve(Kinetics&, const vector<float>&, const vector<float>&, int = 0);
+
+	// valid once solve() succeeded
+	int isStable();
+	int hasHopf();
+	double getAbscissa();
+	double getOscillatoryAbscissa(double*);
+	const vector<float>& getState(){ return state; };
+	int getIterations(){ return iterations; };
+
+	// Gaussian elimination with partial pivoting, also used by Integrator
+	static int linearSolve(vector<double>&, vector<double>&, int);
+
+private:
+	void derivative(const float*, float*);
+	void jacobian(const float*, vector<double>&);
+	static void hessenberg(vector<double>&, int);
+	static int eigenvalues(vector<double>&, int, vector<double>&, vector<double>&);
+
+	Kinetics* kinetics;
+	int nodes;
+	int reactions;
+
+	// how the rate laws see the concentration of each node
+	vector<float> scale;
+
+	// the nodes changed by some reaction, which the system is solved for
+	vector<int> active;
+
+	// work space of derivative() and jacobian()
+	vector<float> x;
+	vector<float> dx;
+	vector<float> v;
+	vector<float> dv;
+
+	// the steady state of every node, by node id
+	vector<float> state;
+
+	// the eigenvalues of the Jacobian at the steady state
+	vector<double> real;
+	vector<double> imag;
+	int iterations;
+};
+
+#endif
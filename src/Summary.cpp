@@ -0,0 +1,319 @@
+/**
+ * Summary.cpp
+ *
+ * Per-generation population summary stream.
+ *
+ * Statistics are accumulated while the generation runs, and a single compact NDJSON record is formatted and
+ * written through a buffered FILE when the generation ends:
+ *
+ * {"gen":3,"cells":20,"scored":20,"best":14,"bestCell":7,"mean":3.25,"median":2,"hist":[...],
+ *  "nodes":{"min":4,"mean":8.1,"max":12},"arcs":{...},"mutations":{"null":6,...},"time":{"mutate":0.0001,...},
+ *  "util":[0.98,0.95,...]}
+ *
+ * The score fields are only present on generations where the cells were scored, and the worker utilization only when
+ * the cells are processed by a thread pool. A summary writing to a shared stream
+ * starts each record with its label, for example {"point":2,"hill":14,"gen":3,...}.
+ */
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+
+#include "Summary.h"
+#include "Cell.h"
+
+#include "ExternTrace.h"
+
+// names of the mutation types, indexed by MutationType
+static const char* mutationNames[MUT_TYPE_COUNT] = { "null", "fwdRate", "revRate", "degRate", "newPTM", "histone", "newComplex", "newBasic", "newPromoter" };
+
+// names of the timing categories
+static const char* timeNames[Summary::TIME_COUNT] = { "mutate", "eval", "output", "select" };
+
+/**
+ * Summary::Summary(const char*)
+ *
+ * Open the summary stream.
+ *
+ * @param path the file the NDJSON records are written to
+ */
+Summary::Summary(const char* path){
+
+	ownsFile = 1;
+	label[0] = 0;
+
+	outFile = fopen(path, "w");
+	if(!outFile){
+		t.trace("error","Could not open summary file %s\n", path);
+		buffer = 0;
+		return;
+	}
+
+	//records are small, so let the stream collect many of them before touching the disk
+	buffer = new char[SUMMARY_BUFFER_SIZE];
+	setvbuf(outFile, buffer, _IOFBF, SUMMARY_BUFFER_SIZE);
+
+	mutations.resize(MUT_TYPE_COUNT);
+	generation = 0;
+}
+
+/**
+ * Summary::Summary(FILE*, const char*)
+ *
+ * Write the records to a stream opened by the caller, which may be shared with other summaries. The stream
+ * is not closed by the summary.
+ *
+ * @param stream the stream the NDJSON records are written to
+ * @param lbl JSON members (without braces) added to the start of every record
+ */
+Summary::Summary(FILE* stream, const char* lbl){
+
+	ownsFile = 0;
+	outFile = stream;
+	buffer = 0;
+	snprintf(label, sizeof(label), "%s", lbl ? lbl : "");
+
+	mutations.resize(MUT_TYPE_COUNT);
+	generation = 0;
+}
+
+/**
+ * Summary::~Summary()
+ *
+ * Flush any buffered records and close the stream, if it belongs to the summary.
+ */
+Summary::~Summary(){
+
+	if(outFile && ownsFile)
+		fclose(outFile);
+	delete [] buffer;
+}
+
+/**
+ * double Summary::now()
+ *
+ * @return the wall clock time in seconds
+ */
+double Summary::now(){
+
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * void Summary::beginGeneration(int)
+ *
+ * Reset the accumulated statistics for a new generation.
+ *
+ * @param gen the generation number
+ */
+void Summary::beginGeneration(int gen){
+
+	generation = gen;
+	startTime = now();
+
+	scores.clear();
+	bestScore = -1;
+	bestCell = -1;
+	memset(hist, 0, sizeof(hist));
+	screened = -1;
+
+	numNetworks = 0;
+	minNodes = maxNodes = 0;
+	minArcs = maxArcs = 0;
+	totalNodes = totalArcs = 0;
+
+	fill(mutations.begin(), mutations.end(), 0);
+
+	for(int i = 0; i < TIME_COUNT; i++)
+		times[i] = 0;
+
+	utilization.clear();
+}
+
+/**
+ * void Summary::addMutation(int)
+ *
+ * @param type the MutationType returned by Cell::mutate()
+ */
+void Summary::addMutation(int type){
+
+	if(type >= 0 && type < MUT_TYPE_COUNT)
+		mutations[type]++;
+}
+
+/**
+ * void Summary::addScore(int, int)
+ *
+ * Add the score of a single cell to the generation statistics.
+ *
+ * @param cellID the ID of the scored cell
+ * @param score the score of the cell
+ */
+void Summary::addScore(int cellID, int score){
+
+	scores.push_back(score);
+
+	if(score > bestScore){
+		bestScore = score;
+		bestCell = cellID;
+	}
+
+	//power of two bins, the last bin is open ended
+	int bin = 0;
+	for(int s = score; s > 0 && bin < SUMMARY_HIST_BINS - 1; s >>= 1)
+		bin++;
+	hist[bin]++;
+}
+
+/**
+ * void Summary::addScreened(int)
+ *
+ * Count the result of the screens of a scored cell (Experiment::setPrefilter, Experiment::setHopfScreen).
+ *
+ * @param skipped 1 if the cell was not evaluated because its network can not oscillate, 0 otherwise
+ */
+void Summary::addScreened(int skipped){
+
+	if(screened < 0)
+		screened = 0;
+	screened += skipped;
+}
+
+/**
+ * void Summary::addNetwork(int, int)
+ *
+ * Add the size of a single cell's network to the generation statistics.
+ *
+ * @param nodes number of molecules in the cell
+ * @param arcs number of interactions in the cell
+ */
+void Summary::addNetwork(int nodes, int arcs){
+
+	if(numNetworks == 0){
+		minNodes = maxNodes = nodes;
+		minArcs = maxArcs = arcs;
+	}
+
+	minNodes = min(minNodes, nodes);
+	maxNodes = max(maxNodes, nodes);
+	minArcs = min(minArcs, arcs);
+	maxArcs = max(maxArcs, arcs);
+	totalNodes += nodes;
+	totalArcs += arcs;
+	numNetworks++;
+}
+
+/**
+ * void Summary::addTime(int, double)
+ *
+ * @param category one of TIME_MUTATE, TIME_EVAL, TIME_OUTPUT, TIME_SELECT
+ * @param seconds the time to add to the category
+ */
+void Summary::addTime(int category, double seconds){
+
+	if(category >= 0 && category < TIME_COUNT)
+		times[category] += seconds;
+}
+
+/**
+ * void Summary::setUtilization(const vector<double>&)
+ *
+ * @param util the fraction of the generation each worker thread spent processing cells
+ */
+void Summary::setUtilization(const vector<double>& util){
+	utilization = util;
+}
+
+/**
+ * static void append(string&, const char*, ...)
+ *
+ * Append formatted text to a string, as sprintf would write it.
+ *
+ * @param s the string
+ * @param format the printf format
+ */
+static void append(string& s, const char* format, ...){
+
+	char buf[256];
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	if(n < 0)
+		return;
+
+	if(n < (int)sizeof(buf)){
+		s.append(buf, n);
+		return;
+	}
+
+	vector<char> big(n + 1);
+	va_start(args, format);
+	vsnprintf(&big[0], big.size(), format, args);
+	va_end(args);
+	s.append(&big[0], n);
+}
+
+/**
+ * void Summary::endGeneration()
+ *
+ * Format the record for the current generation and hand it to the buffered stream.
+ */
+void Summary::endGeneration(){
+
+	if(!outFile)
+		return;
+
+	//the record grows with the number of workers, so it is built in a string
+	string rec;
+
+	append(rec, "{%s%s\"gen\":%d,\"cells\":%d,\"scored\":%d", label, label[0] ? "," : "", generation, numNetworks, (int)scores.size());
+
+	if(!scores.empty()){
+
+		double total = 0;
+		for(unsigned int i = 0; i < scores.size(); i++)
+			total += scores[i];
+
+		//the median only needs a partial sort
+		vector<int>::iterator mid = scores.begin() + scores.size() / 2;
+		nth_element(scores.begin(), mid, scores.end());
+
+		append(rec, ",\"best\":%d,\"bestCell\":%d,\"mean\":%g,\"median\":%d,\"hist\":[", bestScore, bestCell, total / scores.size(), *mid);
+		for(int i = 0; i < SUMMARY_HIST_BINS; i++)
+			append(rec, i ? ",%d" : "%d", hist[i]);
+		append(rec, "]");
+	}
+
+	if(screened >= 0)
+		append(rec, ",\"screened\":%d", screened);
+
+	if(numNetworks){
+		append(rec, ",\"nodes\":{\"min\":%d,\"mean\":%g,\"max\":%d}", minNodes, totalNodes / numNetworks, maxNodes);
+		append(rec, ",\"arcs\":{\"min\":%d,\"mean\":%g,\"max\":%d}", minArcs, totalArcs / numNetworks, maxArcs);
+	}
+
+	append(rec, ",\"mutations\":{");
+	for(int i = 0; i < MUT_TYPE_COUNT; i++)
+		append(rec, "%s\"%s\":%d", i ? "," : "", mutationNames[i], mutations[i]);
+
+	append(rec, "},\"time\":{");
+	for(int i = 0; i < TIME_COUNT; i++)
+		append(rec, "\"%s\":%.6f,", timeNames[i], times[i]);
+	append(rec, "\"total\":%.6f}", now() - startTime);
+
+	if(!utilization.empty()){
+		append(rec, ",\"util\":[");
+		for(unsigned int i = 0; i < utilization.size(); i++)
+			append(rec, i ? ",%.3f" : "%.3f", utilization[i]);
+		append(rec, "]");
+	}
+
+	append(rec, "}\n");
+
+	fwrite(rec.data(), 1, rec.size(), outFile);
+}
@@ -0,0 +1,85 @@
+/**
+ * Summary.h
+ *
+ * Per-generation population summary stream.
+ *
+ * One NDJSON record is written for each generation, containing score statistics, network size statistics,
+ * mutation type counts and timings for the whole population. No per-cell output is required.
+ *
+ * Several experiments (the points of a parameter sweep) can write to one shared stream, each record starting with
+ * a label which identifies the experiment.
+ *
+ */
+
+#ifndef SUMMARY_H_
+#define SUMMARY_H_
+
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+// number of power of two score histogram bins: [0], [1], [2,3], [4,7], ... [1024,inf)
+#define SUMMARY_HIST_BINS 12
+
+// size of the buffer used by the summary writer
+#define SUMMARY_BUFFER_SIZE 65536
+
+class Summary{
+
+public:
+	Summary(const char*);
+	Summary(FILE*, const char*);
+	~Summary();
+
+	void beginGeneration(int);
+	void endGeneration();
+
+	void addMutation(int);
+	void addScore(int, int);
+	void addScreened(int);
+	void addNetwork(int, int);
+	void addTime(int, double);
+	void setUtilization(const vector<double>&);
+
+	// timing categories for addTime()
+	enum { TIME_MUTATE = 0, TIME_EVAL, TIME_OUTPUT, TIME_SELECT, TIME_COUNT };
+
+	static double now();
+
+private:
+	FILE* outFile;
+	char* buffer;
+
+	// set if the stream is closed by the summary, rather than shared with other summaries
+	int ownsFile;
+	char label[256];
+
+	int generation;
+	double startTime;
+
+	// score statistics
+	vector<int> scores;
+	int bestScore;
+	int bestCell;
+	int hist[SUMMARY_HIST_BINS];
+
+	// cells given a score of 0 by the screens, -1 if no screen is used
+	int screened;
+
+	// network size statistics
+	int numNetworks;
+	int minNodes, maxNodes;
+	int minArcs, maxArcs;
+	double totalNodes, totalArcs;
+
+	// mutation counts, indexed by MutationType
+	vector<int> mutations;
+
+	double times[TIME_COUNT];
+
+	// fraction of the generation each worker thread was busy (empty without a thread pool)
+	vector<double> utilization;
+};
+
+#endif
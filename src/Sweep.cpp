@@ -0,0 +1,290 @@
+/**
+ * Sweep.cpp
+ *
+ * Parsing of sweep specifications, and the generational loop shared by the experiments of a sweep.
+ *
+ * Each generation, every experiment is started, the cells of all experiments are handed to the thread pool as one
+ * batch (largest networks first), and the experiments are finished one after another. Experiments whose systems are
+ * stiffer than the others only cost the time of their own cells, as idle workers steal the remaining cells of any
+ * experiment.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Sweep.h"
+
+#include "ExternTrace.h"
+
+// the parameters which can be swept, named like the command line options
+enum SweepParam{
+	SWEEP_CELLS = 0,
+	SWEEP_HILL,
+	SWEEP_MINRATE,
+	SWEEP_MAXRATE,
+	SWEEP_INITCONC,
+	SWEEP_RKLIM,
+	SWEEP_RKSTEP,
+	SWEEP_MAXBASIC,
+	SWEEP_MAXPTM,
+	SWEEP_MAXCOMP,
+	SWEEP_MAXPROM,
+	SWEEP_PARAM_COUNT
+};
+
+static const char* paramNames[SWEEP_PARAM_COUNT] = { "cells", "hill", "minrate", "maxrate", "initconc", "rklim", "rkstep", "maxbasic", "maxptm", "maxcomp", "maxprom" };
+
+// values of a range closer than this to its upper bound are included, so float steps do not lose the last value
+#define SWEEP_EPSILON 1e-6
+
+/**
+ * int Sweep::parse(const char*)
+ *
+ * Read a sweep specification. Items are separated by commas. An item of the form name=values starts a new parameter,
+ * and an item without a name adds values to the parameter before it.
+ *
+ * @param spec the specification, for example "hill=13:16,maxrate=5,10"
+ *
+ * @return 1 on success, 0 otherwise
+ */
+int Sweep::parse(const char* spec){
+
+	dimensions.clear();
+
+	char buf[1024];
+	snprintf(buf, sizeof(buf), "%s", spec);
+
+	for(char* item = strtok(buf, ","); item; item = strtok(0, ",")){
+
+		char* values = item;
+		char* eq = strchr(item, '=');
+
+		//a new parameter
+		if(eq){
+			*eq = 0;
+			values = eq + 1;
+
+			int param = -1;
+			for(int p = 0; p < SWEEP_PARAM_COUNT; p++)
+				if(strcmp(item, paramNames[p]) == 0)
+					param = p;
+
+			if(param < 0){
+				t.trace("error","Unknown sweep parameter %s\n", item);
+				return 0;
+			}
+			for(unsigned int d = 0; d < dimensions.size(); d++){
+				if(dimensions[d].param == param){
+					t.trace("error","Sweep parameter %s is given twice\n", item);
+					return 0;
+				}
+			}
+
+			Dimension dim;
+			dim.param = param;
+			dimensions.push_back(dim);
+		}
+		else if(dimensions.empty()){
+			t.trace("error","Sweep value %s has no parameter\n", item);
+			return 0;
+		}
+
+		//a single value, or a range a:b[:step]
+		float range[3] = { 0, 0, 1 };
+		int count = 0;
+		char* end = values;
+		while(count < 3){
+			range[count++] = strtod(end, &end);
+			if(*end != ':')
+				break;
+			end++;
+		}
+
+		if(*end != 0 || end == values){
+			t.trace("error","Could not read sweep values %s\n", values);
+			return 0;
+		}
+
+		vector<float>& v = dimensions.back().values;
+		if(count == 1)
+			v.push_back(range[0]);
+		else{
+			if(range[2] <= 0 || range[1] < range[0]){
+				t.trace("error","Empty sweep range %s\n", values);
+				return 0;
+			}
+			for(int k = 0; range[0] + k * range[2] <= range[1] + SWEEP_EPSILON; k++)
+				v.push_back(range[0] + k * range[2]);
+		}
+	}
+
+	if(dimensions.empty()){
+		t.trace("error","Empty sweep %s\n", spec);
+		return 0;
+	}
+
+	t.trace("args","Sweep of %d points\n", getPointCount());
+	return 1;
+}
+
+/**
+ * int Sweep::getPointCount()
+ *
+ * @return the number of parameter combinations
+ */
+int Sweep::getPointCount(){
+
+	int n = 1;
+	for(unsigned int d = 0; d < dimensions.size(); d++)
+		n *= dimensions[d].values.size();
+	return n;
+}
+
+/**
+ * void Sweep::getValues(int, vector<int>&)
+ *
+ * @param point the number of the combination, from 0 to getPointCount()-1
+ * @param index filled with the index of the value of each parameter
+ */
+void Sweep::getValues(int point, vector<int>& index){
+
+	index.resize(dimensions.size());
+	for(int d = dimensions.size() - 1; d >= 0; d--){
+		int n = dimensions[d].values.size();
+		index[d] = point % n;
+		point /= n;
+	}
+}
+
+/**
+ * void Sweep::apply(int, RunParameters&)
+ *
+ * Set the swept parameters of one combination. The parameters which are not swept are left unchanged.
+ *
+ * @param point the number of the combination
+ * @param p the parameters to change
+ */
+void Sweep::apply(int point, RunParameters& p){
+
+	vector<int> index;
+	getValues(point, index);
+
+	for(unsigned int d = 0; d < dimensions.size(); d++){
+
+		float v = dimensions[d].values[index[d]];
+
+		switch(dimensions[d].param){
+		case SWEEP_CELLS:
+			p.cells = (int)v;
+			break;
+		case SWEEP_HILL:
+			p.hill = (int)v;
+			break;
+		case SWEEP_MINRATE:
+			p.minRate = v;
+			break;
+		case SWEEP_MAXRATE:
+			p.maxRate = v;
+			break;
+		case SWEEP_INITCONC:
+			p.initConc = v;
+			break;
+		case SWEEP_RKLIM:
+			p.rkLimit = v;
+			break;
+		case SWEEP_RKSTEP:
+			p.rkStep = v;
+			break;
+		case SWEEP_MAXBASIC:
+			p.maxBasic = (int)v;
+			break;
+		case SWEEP_MAXPTM:
+			p.maxPTM = (int)v;
+			break;
+		case SWEEP_MAXCOMP:
+			p.maxComp = (int)v;
+			break;
+		case SWEEP_MAXPROM:
+			p.maxProm = (int)v;
+			break;
+		}
+	}
+}
+
+/**
+ * void Sweep::getLabel(int, char*, size_t)
+ *
+ * @param point the number of the combination
+ * @param buf filled with JSON members identifying the combination, for example "point":2,"hill":15,"maxrate":5
+ * @param size the size of buf
+ */
+void Sweep::getLabel(int point, char* buf, size_t size){
+
+	vector<int> index;
+	getValues(point, index);
+
+	int n = snprintf(buf, size, "\"point\":%d", point);
+	for(unsigned int d = 0; d < dimensions.size() && n < (int)size; d++)
+		n += snprintf(buf + n, size - n, ",\"%s\":%g", paramNames[dimensions[d].param], dimensions[d].values[index[d]]);
+}
+
+/**
+ * int Sweep::run(vector<Experiment*>&, ThreadPool&)
+ *
+ * Run the experiments of the sweep, one for each point in order, until they reach their generation limit.
+ * The summary records of all experiments are written to sweep.ndjson in the output directory of the first
+ * experiment. The experiments can not be run again afterwards, as the stream is closed.
+ *
+ * @param runs the experiments
+ * @param pool the threads processing the cells
+ *
+ * @return 1 on success, 0 if the output could not be opened
+ */
+int Sweep::run(vector<Experiment*>& runs, ThreadPool& pool){
+
+	if(runs.empty())
+		return 1;
+
+	char path[200];
+	runs[0]->getOutputPath("sweep.ndjson", path, sizeof(path));
+
+	FILE* out = fopen(path, "w");
+	if(!out){
+		t.trace("error","Could not open sweep output %s\n", path);
+		return 0;
+	}
+
+	char label[256];
+	for(unsigned int e = 0; e < runs.size(); e++){
+		getLabel(e, label, sizeof(label));
+		runs[e]->setSummaryStream(out, label);
+	}
+
+	int first = runs[0]->getStartGeneration();
+	int last = runs[0]->getMaxGenerations();
+
+	vector<Task> tasks;
+
+	for(int gen = first; gen <= last; gen++){
+
+		tasks.clear();
+		for(unsigned int e = 0; e < runs.size(); e++){
+			runs[e]->beginGeneration(gen);
+			for(int c = 0; c < runs[e]->getCellCount(); c++){
+				Task task = { Experiment::processCellTask, runs[e], c, runs[e]->getCellCost(c) };
+				tasks.push_back(task);
+			}
+		}
+
+		pool.run(tasks);
+
+		for(unsigned int e = 0; e < runs.size(); e++)
+			runs[e]->endGeneration(gen);
+
+		t.trace("gens","Sweep generation %d finished, %d cells of %d experiments\n", gen, (int)tasks.size(), (int)runs.size());
+	}
+
+	fclose(out);
+	return 1;
+}
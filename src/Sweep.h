@@ -0,0 +1,64 @@
+/**
+ * Sweep.h
+ *
+ * Parameter sweeps: one Experiment for every combination of a set of parameter values, all run in one process.
+ *
+ * A sweep is given as a list of parameters and their values, for example "hill=13:16,maxrate=5,10":
+ *   name=a:b       every value from a to b, in steps of 1
+ *   name=a:b:step  every value from a to b, in steps of step
+ *   name=v,w,...   the listed values
+ *
+ * The experiments advance one generation at a time together, and the cells of all experiments are processed as tasks
+ * of a single ThreadPool. The summary records of all experiments go to one stream (prefix/pid/sweep.ndjson), labelled
+ * with the point of the sweep and its parameter values.
+ *
+ */
+
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <cstdio>
+#include <vector>
+#include "Experiment.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// the parameters of an Experiment which a sweep can vary
+struct RunParameters{
+	int cells;
+	int hill;
+	float minRate;
+	float maxRate;
+	float initConc;
+	float rkLimit;
+	float rkStep;
+	int maxBasic;
+	int maxPTM;
+	int maxComp;
+	int maxProm;
+};
+
+class Sweep{
+
+public:
+	int parse(const char*);
+
+	int getPointCount();
+	void apply(int, RunParameters&);
+	void getLabel(int, char*, size_t);
+
+	int run(vector<Experiment*>&, ThreadPool&);
+
+private:
+	void getValues(int, vector<int>&);
+
+	// one swept parameter and its values. The first parameter varies slowest
+	struct Dimension{
+		int param;
+		vector<float> values;
+	};
+	vector<Dimension> dimensions;
+};
+
+#endif
@@ -0,0 +1,269 @@
+/**
+ * ThreadPool.cpp
+ *
+ * Work-stealing thread pool.
+ *
+ * run() sorts the tasks of a batch by cost, deals them out to the worker queues in turn, wakes the workers and then
+ * works through the batch itself. A worker which runs out of tasks steals from the other queues, so a batch only ends once no queue
+ * has work left. The worker threads sleep between batches.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/time.h>
+
+#include "ThreadPool.h"
+
+#include "ExternTrace.h"
+
+/**
+ * static double now()
+ *
+ * @return the wall clock time in seconds
+ */
+static double now(){
+
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * static bool costlier(const Task&, const Task&)
+ *
+ * Sort order of the tasks of a batch: highest cost first.
+ */
+static bool costlier(const Task& a, const Task& b){
+	return a.cost > b.cost;
+}
+
+/**
+ * ThreadPool::ThreadPool(int)
+ *
+ * Start the worker threads. If a thread can not be started, the pool continues with the workers it has.
+ *
+ * @param n the number of workers, including the thread calling run()
+ */
+ThreadPool::ThreadPool(int n){
+
+	if(n < 1)
+		n = 1;
+
+	pthread_mutex_init(&mutex, 0);
+	pthread_cond_init(&started, 0);
+	pthread_cond_init(&finished, 0);
+	batch = 0;
+	remaining = 0;
+	stopping = 0;
+	runTime = 0;
+
+	for(int w = 0; w < n; w++){
+		Worker* worker = new Worker();
+		worker->pool = this;
+		worker->index = w;
+		worker->busy = 0;
+		worker->done = 0;
+		worker->steals = 0;
+		pthread_mutex_init(&worker->lock, 0);
+		workers.push_back(worker);
+	}
+
+	//worker 0 is the thread calling run()
+	running = 1;
+	while(running < n && pthread_create(&workers[running]->thread, 0, workerThread, workers[running]) == 0)
+		running++;
+
+	if(running < n)
+		t.trace("error","Could only start %d of %d worker threads\n", running, n);
+
+	t.trace("init","ThreadPool with %d workers created\n", running);
+}
+
+/**
+ * ThreadPool::~ThreadPool()
+ *
+ * Stop the worker threads and wait for them to exit.
+ */
+ThreadPool::~ThreadPool(){
+
+	pthread_mutex_lock(&mutex);
+	stopping = 1;
+	pthread_cond_broadcast(&started);
+	pthread_mutex_unlock(&mutex);
+
+	for(int w = 1; w < running; w++)
+		pthread_join(workers[w]->thread, 0);
+
+	for(unsigned int w = 0; w < workers.size(); w++){
+		pthread_mutex_destroy(&workers[w]->lock);
+		delete workers[w];
+	}
+
+	pthread_cond_destroy(&started);
+	pthread_cond_destroy(&finished);
+	pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * void ThreadPool::run(vector<Task>&)
+ *
+ * Run a batch of tasks and return once all of them have finished. The batch is sorted by cost, highest first (tasks
+ * of equal cost keep their order), and dealt out to the workers in turn, so every worker starts with its most
+ * expensive tasks and the cheap ones are left to balance the load at the end.
+ *
+ * @param tasks the batch, which is sorted in place and must not be changed while it runs
+ */
+void ThreadPool::run(vector<Task>& tasks){
+
+	if(tasks.empty())
+		return;
+
+	double start = now();
+	int n = workers.size();
+
+	stable_sort(tasks.begin(), tasks.end(), costlier);
+
+	//counted before any task is queued, as idle workers of the last batch may still be looking for tasks
+	__sync_lock_test_and_set(&remaining, (int)tasks.size());
+
+	for(int w = 0; w < n; w++){
+		pthread_mutex_lock(&workers[w]->lock);
+		for(unsigned int i = w; i < tasks.size(); i += n)
+			workers[w]->tasks.push_back(tasks[i]);
+		pthread_mutex_unlock(&workers[w]->lock);
+	}
+
+	pthread_mutex_lock(&mutex);
+	batch++;
+	pthread_cond_broadcast(&started);
+	pthread_mutex_unlock(&mutex);
+
+	work(0);
+
+	pthread_mutex_lock(&mutex);
+	while(__sync_fetch_and_add(&remaining, 0) > 0)
+		pthread_cond_wait(&finished, &mutex);
+	pthread_mutex_unlock(&mutex);
+
+	runTime += now() - start;
+}
+
+/**
+ * void ThreadPool::report(FILE*)
+ *
+ * Write the utilization of each worker: the fraction of the time spent in run() for which it was running tasks,
+ * the number of tasks it ran, and how many of those it stole from other workers.
+ *
+ * @param out the stream to write to
+ */
+void ThreadPool::report(FILE* out){
+
+	fprintf(out, "Worker utilization (%d workers, %.3f s in batches)\n", running, runTime);
+
+	for(int w = 0; w < (int)workers.size(); w++){
+		Worker* worker = workers[w];
+		fprintf(out, "  worker %-3d %6.1f%% busy  %8d tasks  %8d stolen\n", w, runTime > 0 ? 100 * worker->busy / runTime : 0.0, worker->done, worker->steals);
+	}
+}
+
+/**
+ * void* ThreadPool::workerThread(void*)
+ *
+ * Body of the worker threads. Sleeps until a batch is started, then works on it.
+ *
+ * @param arg the Worker
+ */
+void* ThreadPool::workerThread(void* arg){
+
+	Worker* worker = (Worker*) arg;
+	ThreadPool* pool = worker->pool;
+	int seen = 0;
+
+	while(1){
+
+		pthread_mutex_lock(&pool->mutex);
+		while(pool->batch == seen && !pool->stopping)
+			pthread_cond_wait(&pool->started, &pool->mutex);
+		if(pool->stopping){
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+		seen = pool->batch;
+		pthread_mutex_unlock(&pool->mutex);
+
+		pool->work(worker->index);
+	}
+
+	return 0;
+}
+
+/**
+ * void ThreadPool::work(int)
+ *
+ * Run tasks until none are left in any queue. The last task of a batch wakes the thread waiting in run().
+ *
+ * @param w the index of the worker
+ */
+void ThreadPool::work(int w){
+
+	Task task;
+	Worker* worker = workers[w];
+	int taken;
+
+	while((taken = take(w, task)) != 0){
+
+		double start = now();
+		task.run(task.data, task.index);
+
+		worker->busy += now() - start;
+		worker->done++;
+		if(taken == 2)
+			worker->steals++;
+
+		if(__sync_sub_and_fetch(&remaining, 1) == 0){
+			pthread_mutex_lock(&mutex);
+			pthread_cond_broadcast(&finished);
+			pthread_mutex_unlock(&mutex);
+		}
+	}
+}
+
+/**
+ * int ThreadPool::take(int, Task&)
+ *
+ * Take the next task from the front of the worker's own queue, or steal one from the back of another queue.
+ *
+ * @param w the index of the worker
+ * @param task filled with the task
+ *
+ * @return 1 if a task was taken from the worker's own queue, 2 if it was stolen, 0 if all queues are empty
+ */
+int ThreadPool::take(int w, Task& task){
+
+	int n = workers.size();
+
+	Worker* own = workers[w];
+	pthread_mutex_lock(&own->lock);
+	if(!own->tasks.empty()){
+		task = own->tasks.front();
+		own->tasks.pop_front();
+		pthread_mutex_unlock(&own->lock);
+		return 1;
+	}
+	pthread_mutex_unlock(&own->lock);
+
+	for(int k = 1; k < n; k++){
+		Worker* victim = workers[(w + k) % n];
+		pthread_mutex_lock(&victim->lock);
+		if(!victim->tasks.empty()){
+			task = victim->tasks.back();
+			victim->tasks.pop_back();
+			pthread_mutex_unlock(&victim->lock);
+			return 2;
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * ThreadPool.h
+ *
+ * A fixed set of worker threads running batches of independent tasks.
+ *
+ * Every worker has its own queue of tasks. A worker takes tasks from the front of its own queue, and once it is empty
+ * steals tasks from the back of the other queues, so workers which were given cheap tasks help the ones which were
+ * given expensive ones. The thread calling run() works as worker 0.
+ *
+ * Each batch is started largest first, by the estimated cost of its tasks, so the expensive tasks are not left for
+ * the end of the batch where they would keep one worker busy while the others are idle.
+ *
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <cstdio>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+// a unit of work: run(data, index). cost is an estimate of the time the task takes, in any unit
+struct Task{
+	void (*run)(void*, int);
+	void* data;
+	int index;
+	int cost;
+};
+
+class ThreadPool{
+
+public:
+	ThreadPool(int);
+	~ThreadPool();
+
+	void run(vector<Task>&);
+
+	int getThreadCount(){ return running; };
+
+	// statistics since the pool was created
+	double getBusyTime(int w){ return workers[w]->busy; };
+	int getTaskCount(int w){ return workers[w]->done; };
+	int getStealCount(int w){ return workers[w]->steals; };
+	double getRunTime(){ return runTime; };
+	void report(FILE*);
+
+private:
+	struct Worker{
+		ThreadPool* pool;
+		int index;
+		pthread_t thread;
+
+		// tasks of the current batch given to this worker, taken from the front by the worker and from the back by thieves
+		pthread_mutex_t lock;
+		deque<Task> tasks;
+
+		// only changed by the worker itself
+		double busy;
+		int done;
+		int steals;
+	};
+
+	static void* workerThread(void*);
+	void work(int);
+	int take(int, Task&);
+
+	vector<Worker*> workers;
+
+	// number of working workers: the caller, and the workers whose thread was started
+	int running;
+
+	// batches are started and finished under this lock
+	pthread_mutex_t mutex;
+	pthread_cond_t started;
+	pthread_cond_t finished;
+	int batch;
+	int remaining;
+	int stopping;
+
+	// total time spent in run()
+	double runTime;
+};
+
+#endif
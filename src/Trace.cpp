@@ -69,6 +69,9 @@ void Trace::addTraceType(const char* tag, int enabled){
  *
  * Outputs a trace message with the given format if the trace tag is enabled.
  * Output is not automatically terminated with a newline character.
+ *
+ * Tracing is safe from several threads once all trace types have been added: unknown tags are looked up without
+ * being inserted, and each message is written while holding the lock of the trace file.
  * 
  * @param tag Trace type
  * @param format string
@@ -82,13 +85,18 @@ void Trace::trace(const char* tag, const char* format, ...){
 	va_start(args, format);
 
 	//if the value associated with the tag is nonzero it is enabled
-	if(traceTypes[tag]){
+	map<const char*, int, cmp_str>::iterator it = traceTypes.find(tag);
+	if(it != traceTypes.end() && it->second){
 		
+		flockfile(traceFile);
+
 		//prefix message with tag
 		fprintf(traceFile,"[ %-6s ] \t",tag);
 		
 		//output formatted trace message
 		vfprintf(traceFile,format, args);
+
+		funlockfile(traceFile);
 	}	
 	
 	va_end(args);
@@ -21,7 +21,7 @@ using namespace std;
 //the map structure needs to know how to evaluate if two keys are the same
 struct cmp_str
 {
-  bool operator()(const char* a, const char* b)
+  bool operator()(const char* a, const char* b) const
   {
   	// strcmp returns a negative value if two strings are the same
 	return strcmp(a,b) < 0;
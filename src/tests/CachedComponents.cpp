@@ -0,0 +1,130 @@
+/**
+ * CachedComponents.cpp
+ *
+ * Component cache test: a network of several parts no reaction links, solved by Runge-Kutta with a ComponentCache,
+ * must have exactly the trajectories it has without the cache, whether its parts are integrated and stored, all found
+ * in the cache, or, after a rate of one part is changed, found for the other parts and integrated for that one.
+ *
+ * Built and run by "make check".
+ */
+
+#include <cstdio>
+#include "DerivGraph.h"
+#include "Trace.h"
+
+//the tags are not registered, so the test is silent
+Trace t;
+
+// the network: seed of its random generator, basic proteins (each a part of its own), rounds of mutations growing it,
+// and the timestep and time limit
+#define NETWORK_SEED 12345
+#define PARTS 3
+#define GROW_ROUNDS 100
+#define STEP .05
+#define LIMIT 20
+
+// the memory of the cache, in MB
+#define CACHE_MB 16
+
+class CachedComponents{
+
+public:
+	static int run();
+
+private:
+	static void solve(DerivGraph&, ComponentCache*, vector<float>&);
+	static int check(const char*, const vector<float>&, const vector<float>&, ComponentCache&, long, long);
+};
+
+/**
+ * void CachedComponents::solve(DerivGraph&, ComponentCache*, vector<float>&)
+ *
+ * @param g the network
+ * @param cache the component cache, null to integrate every part
+ * @param points filled with the trajectory of every molecule, by node id
+ */
+void CachedComponents::solve(DerivGraph& g, ComponentCache* cache, vector<float>& points){
+
+	g.invalidate();
+	g.rungeKuttaEvaluate(STEP, LIMIT, 0, INTEGRATE_RK4, 0, 1, cache);
+
+	points.clear();
+	for(int n = 0; n <= g.derivs->maxNodeId(); n++){
+		vector<float>* solution = (*g.molecules)[g.derivs->nodeFromId(n)]->getRungeKuttaSolution();
+		points.insert(points.end(), solution->begin(), solution->end());
+	}
+}
+
+/**
+ * int CachedComponents::check(const char*, const vector<float>&, const vector<float>&, ComponentCache&, long, long)
+ *
+ * @param name the case, for the report
+ * @param reference the trajectories without the cache
+ * @param points the trajectories with the cache
+ * @param cache the cache
+ * @param hits the parts the case should have found in the cache since the last case
+ * @param misses the parts the case should have integrated and stored since the last case
+ *
+ * @return 1 if the trajectories are the same and the cache was used as expected, 0 otherwise
+ */
+int CachedComponents::check(const char* name, const vector<float>& reference, const vector<float>& points, ComponentCache& cache, long hits, long misses){
+
+	static long lastHits = 0, lastMisses = 0;
+	long found = cache.hits - lastHits;
+	long stored = cache.misses - lastMisses;
+	lastHits = cache.hits;
+	lastMisses = cache.misses;
+
+	if(found != hits || stored != misses){
+		printf("FAIL: %s found %ld parts and integrated %ld, not %ld and %ld\n", name, found, stored, hits, misses);
+		return 0;
+	}
+	if(points != reference){
+		printf("FAIL: %s differs from the solution without the cache\n", name);
+		return 0;
+	}
+	printf("PASS: %s (%ld parts found, %ld integrated) is the solution without the cache\n", name, found, stored);
+	return 1;
+}
+
+/**
+ * int CachedComponents::run()
+ *
+ * @return 1 if every solution with the cache is the one without it, 0 otherwise
+ */
+int CachedComponents::run(){
+
+	DerivGraph g;
+	g.r.seed(NETWORK_SEED);
+	g.setLimits(PARTS, 0, 0, 0);
+	g.setKineticRateLimits(0, 1);
+	g.setDefaultInitialConc(.5);
+	g.setHill(2);
+	for(int round = 0; round < GROW_ROUNDS && !g.isLimited(MUT_NEW_BASIC); round++)
+		g.newBasic();
+
+	ComponentCache cache(CACHE_MB);
+	vector<float> reference, points;
+	int passed = 1;
+
+	solve(g, 0, reference);
+	solve(g, &cache, points);
+	passed &= check("the first solution", reference, points, cache, 0, PARTS);
+	solve(g, &cache, points);
+	passed &= check("the second solution", reference, points, cache, PARTS, 0);
+
+	//a rate of one part is changed, as a rate mutation would
+	SmartDigraph::ArcIt a(*g.derivs);
+	Interaction* i = (*g.interactions)[a];
+	i->setRate(i->getRate() * 2);
+
+	solve(g, 0, reference);
+	solve(g, &cache, points);
+	passed &= check("the solution after a change", reference, points, cache, PARTS - 1, 1);
+
+	return passed;
+}
+
+int main(){
+	return CachedComponents::run() ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+/**
+ * ConservationLaws.cpp
+ *
+ * Conservation test: on a network with a conserved moiety, Runge-Kutta (DerivGraph::rungeKuttaEvaluate), which
+ * integrates only the independent molecules and reconstructs the dependent one from the law, must agree with a full
+ * integration of every molecule by the Runge-Kutta of Integrator. The network is that of DerivGraph::test, three
+ * proteins modifying each other into each other, whose total never changes. Without DNA both integrations take the
+ * same steps, so the largest error of a point, relative to 1 + the full concentration, must stay within TOLERANCE,
+ * the rounding of the float state over the run.
+ *
+ * Built and run by "make check".
+ */
+
+#include <cstdio>
+#include <cmath>
+#include "DerivGraph.h"
+#include "Trace.h"
+
+//the tags are not registered, so the test is silent
+Trace t;
+
+#define STEP .05
+#define LIMIT 20
+
+// the largest error allowed
+#define TOLERANCE 1e-5
+
+class ConservationLaws{
+
+public:
+	static int run();
+
+private:
+	static void build(DerivGraph&);
+};
+
+/**
+ * void ConservationLaws::build(DerivGraph&)
+ *
+ * @param g a new network, given the three proteins and the modifications of DerivGraph::test at ten times its rates
+ */
+void ConservationLaws::build(DerivGraph& g){
+
+	SmartDigraph::Node A = g.add(new (*g.arena) Protein());
+	SmartDigraph::Node B = g.add(new (*g.arena) Protein());
+	SmartDigraph::Node C = g.add(new (*g.arena) Protein());
+	(*g.molecules)[A]->setID(g.count++);
+	(*g.molecules)[B]->setID(g.count++);
+	(*g.molecules)[C]->setID(g.count++);
+
+	(*g.molecules)[A]->setValue(2);
+	(*g.molecules)[B]->setValue(4);
+	(*g.molecules)[C]->setValue(1);
+
+	(*g.interactions)[g.add(new (*g.arena) ForwardPTM(), A, B)]->setRate(.1);
+	(*g.interactions)[g.add(new (*g.arena) ForwardPTM(), A, C)]->setRate(.3);
+	(*g.interactions)[g.add(new (*g.arena) ForwardPTM(), B, C)]->setRate(.7);
+	(*g.interactions)[g.add(new (*g.arena) ForwardPTM(), C, B)]->setRate(.9);
+}
+
+/**
+ * int ConservationLaws::run()
+ *
+ * @return 1 if the reconstructed solution agrees with the full integration, 0 otherwise
+ */
+int ConservationLaws::run(){
+
+	DerivGraph g;
+	build(g);
+
+	vector<float> initial, scale;
+	g.compile(initial, scale);
+	int numNodes = initial.size();
+
+	Conservation conservation;
+	conservation.analyze(*g.kinetics, initial);
+	if(conservation.getLawCount() <= conservation.getConstantCount()){
+		printf("FAIL: %d laws were found, all of a single molecule\n", conservation.getLawCount());
+		return 0;
+	}
+
+	//the full integration, point by point, counting the timesteps the way rungeKuttaEvaluate does
+	vector<float> full(initial), c(initial);
+	Integrator integrator(*g.kinetics, scale, INTEGRATE_RK4);
+	for(float i = 0; i < LIMIT; i += STEP){
+		integrator.step(&c[0], STEP);
+		full.insert(full.end(), c.begin(), c.end());
+	}
+	int points = full.size() / numNodes;
+
+	g.rungeKuttaEvaluate(STEP, LIMIT, 0, INTEGRATE_RK4, 0, 1, 0);
+
+	double error = 0;
+	for(int n = 0; n < numNodes; n++){
+		vector<float>* solution = (*g.molecules)[g.derivs->nodeFromId(n)]->getRungeKuttaSolution();
+		if((int)solution->size() != points){
+			printf("FAIL: node %d has %d points, the full integration %d\n", n, (int)solution->size(), points);
+			return 0;
+		}
+		for(int p = 0; p < points; p++){
+			double reference = full[p * numNodes + n];
+			double e = fabs((*solution)[p] - reference) / (1 + fabs(reference));
+			if(!(e <= error))
+				error = e;
+		}
+	}
+
+	if(!(error <= TOLERANCE)){
+		printf("FAIL: the reconstructed solution differs from the full integration by %g (tolerance %g)\n", error, TOLERANCE);
+		return 0;
+	}
+	printf("PASS: %d of %d laws reconstructed, within %g of the full integration (tolerance %g)\n", conservation.getLawCount() - conservation.getConstantCount(), conservation.getLawCount(), error, TOLERANCE);
+	return 1;
+}
+
+int main(){
+	return ConservationLaws::run() ? 0 : 1;
+}
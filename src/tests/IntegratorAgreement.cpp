@@ -0,0 +1,207 @@
+/**
+ * IntegratorAgreement.cpp
+ *
+ * Integrator test: the trajectories of a fixed network computed by the other integration methods must agree with
+ * those of plain Runge-Kutta (DerivGraph::rungeKuttaEvaluate with INTEGRATE_RK4) at the same timestep. The error of
+ * a point is measured as DerivGraph::stepBenchmark does, relative to 1 + the Runge-Kutta concentration, and the
+ * largest error over every molecule and timestep must stay within the tolerance of the method:
+ *   lawson    TOLERANCE_LAWSON, a second fourth order method, which only differs by the treatment of the linear
+ *             reactions and of DNA within a step
+ *   parareal  TOLERANCE_LAWSON as well, as its fine propagator is the Runge-Kutta of Integrator, which treats DNA as
+ *             Lawson does. Against its own serial fine run, a single slice, within TOLERANCE_PARAREAL, a few times
+ *             the change of the slice boundaries at which its iterations stop
+ *   qssa      TOLERANCE_QSSA, on the network with its mRNA degraded at FAST_DECAY, much faster than the other
+ *             molecules decay, so that the reduction holds the mRNA at its quasi-steady state. The error of the
+ *             reduction is about the ratio of the slow and fast decay rates
+ *   team      exactly, on a network large enough to be shared among threads, as every molecule is summed by one
+ *             member in the order Kinetics sums it
+ *
+ * Built and run by "make check".
+ */
+
+#include <cstdio>
+#include <cmath>
+#include "DerivGraph.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+//the tags are not registered, so the test is silent
+Trace t;
+
+// the networks: seed of their random generators, rounds of mutations growing them, the limits of the network shared
+// among threads, and the timestep and time limit
+#define NETWORK_SEED 12345
+#define GROW_ROUNDS 1000
+#define TEAM_LIMIT 60
+#define STEP .05
+#define LIMIT 20
+
+// the rate of the degradation of mRNA, over 10 times the decay of the other molecules through reactions of rates up to 1
+#define FAST_DECAY 40
+
+// the largest error allowed for each method, the accuracy DerivGraph::stepBenchmark asks of a timestep
+#define TOLERANCE_LAWSON 1e-2
+
+// the largest error allowed between the parallel-in-time run and its serial fine run
+#define TOLERANCE_PARAREAL 1e-4
+
+// the largest error allowed for the quasi-steady-state reduction, about the ratio of the slow decays, at most a few,
+// and FAST_DECAY
+#define TOLERANCE_QSSA 5e-2
+
+// the slices of the parallel-in-time run, and the largest team sharing the evaluation of the rate laws
+#define PARAREAL_SLICES 4
+#define TEAM_THREADS 4
+
+class IntegratorAgreement{
+
+public:
+	static int run();
+
+private:
+	static void build(DerivGraph&, int, int);
+	static void solve(DerivGraph&, int, ThreadPool*, int, vector<float>&);
+	static int check(const char*, const char*, const vector<float>&, const vector<float>&, double);
+};
+
+/**
+ * void IntegratorAgreement::build(DerivGraph&, int, int)
+ *
+ * Grow the network to its limits, the same network on every run.
+ *
+ * @param g the network
+ * @param basic the limit of the basic proteins
+ * @param others the limit of the PTM proteins, complexes and promoters
+ */
+void IntegratorAgreement::build(DerivGraph& g, int basic, int others){
+
+	g.r.seed(NETWORK_SEED);
+	g.setLimits(basic, others, others, others);
+	g.setKineticRateLimits(0, 1);
+	g.setDefaultInitialConc(.5);
+	g.setHill(2);
+
+	for(int round = 0; round < GROW_ROUNDS; round++){
+		if(!g.isLimited(MUT_NEW_BASIC))
+			g.newBasic();
+		if(!g.isLimited(MUT_NEW_PTM))
+			g.newPTM();
+		if(!g.isLimited(MUT_NEW_COMPLEX))
+			g.newComplex();
+		if(!g.isLimited(MUT_NEW_PROMOTER))
+			g.newPromoter();
+	}
+}
+
+/**
+ * void IntegratorAgreement::solve(DerivGraph&, int, ThreadPool*, int, vector<float>&)
+ *
+ * @param g the network
+ * @param integrator the IntegratorMethod
+ * @param slices the pool of threads integrating in parallel in time, one slice each (null to integrate serially)
+ * @param threads the largest team sharing the evaluation of the rate laws
+ * @param points filled with the trajectory of every molecule, by node id
+ */
+void IntegratorAgreement::solve(DerivGraph& g, int integrator, ThreadPool* slices, int threads, vector<float>& points){
+
+	g.invalidate();
+	g.rungeKuttaEvaluate(STEP, LIMIT, 0, integrator, slices, threads, 0);
+
+	points.clear();
+	for(int n = 0; n <= g.derivs->maxNodeId(); n++){
+		vector<float>* solution = (*g.molecules)[g.derivs->nodeFromId(n)]->getRungeKuttaSolution();
+		points.insert(points.end(), solution->begin(), solution->end());
+	}
+}
+
+/**
+ * int IntegratorAgreement::check(const char*, const char*, const vector<float>&, const vector<float>&, double)
+ *
+ * @param name the name of the method, for the report
+ * @param against the name of the reference, for the report
+ * @param reference the reference trajectories
+ * @param points the trajectories of the method
+ * @param tolerance the largest error allowed
+ *
+ * @return 1 if the trajectories agree within the tolerance, 0 otherwise
+ */
+int IntegratorAgreement::check(const char* name, const char* against, const vector<float>& reference, const vector<float>& points, double tolerance){
+
+	if(points.size() != reference.size()){
+		printf("FAIL: %s gave %d points, %s %d\n", name, (int)points.size(), against, (int)reference.size());
+		return 0;
+	}
+
+	double error = 0;
+	for(unsigned int i = 0; i < points.size(); i++){
+		double e = fabs(points[i] - reference[i]) / (1 + fabs(reference[i]));
+		if(!(e <= error))
+			error = e;
+	}
+
+	if(!(error <= tolerance)){
+		printf("FAIL: %s differs from %s by %g (tolerance %g)\n", name, against, error, tolerance);
+		return 0;
+	}
+	printf("PASS: %s agrees with %s within %g (tolerance %g)\n", name, against, error, tolerance);
+	return 1;
+}
+
+/**
+ * int IntegratorAgreement::run()
+ *
+ * @return 1 if every method agrees with Runge-Kutta, 0 otherwise
+ */
+int IntegratorAgreement::run(){
+
+	DerivGraph g;
+	build(g, 4, 3);
+
+	vector<float> reference, points, serial;
+	solve(g, INTEGRATE_RK4, 0, 1, reference);
+
+	int passed = 1;
+
+	solve(g, INTEGRATE_LAWSON, 0, 1, points);
+	passed &= check("lawson", "Runge-Kutta", reference, points, TOLERANCE_LAWSON);
+
+	ThreadPool single(1), slices(PARAREAL_SLICES);
+	solve(g, INTEGRATE_RK4, &single, 1, serial);
+	solve(g, INTEGRATE_RK4, &slices, 1, points);
+	passed &= check("parareal", "Runge-Kutta", reference, points, TOLERANCE_LAWSON);
+	passed &= check("parareal", "its serial fine run", serial, points, TOLERANCE_PARAREAL);
+
+	//the mRNA made fast, the network is solved again
+	for(SmartDigraph::ArcIt a(*g.derivs); a != INVALID; ++a){
+		Interaction* i = (*g.interactions)[a];
+		if(i->kind == IK_DEGRADATION && (*g.molecules)[g.derivs->source(a)]->kind == MK_MRNA)
+			i->setRate(FAST_DECAY);
+	}
+	vector<float> initial, scale;
+	g.compile(initial, scale);
+	Integrator reduction(*g.kinetics, scale, INTEGRATE_QSSA);
+	if(reduction.getFastCount() == 0){
+		printf("FAIL: no molecule of the network is held at its quasi-steady state\n");
+		return 0;
+	}
+	solve(g, INTEGRATE_RK4, 0, 1, reference);
+	solve(g, INTEGRATE_QSSA, 0, 1, points);
+	passed &= check("qssa", "Runge-Kutta", reference, points, TOLERANCE_QSSA);
+
+	DerivGraph large;
+	build(large, TEAM_LIMIT, TEAM_LIMIT);
+	int size = KineticsTeam::getTeamSize(large.getArcCount(), TEAM_THREADS);
+	if(size < 2){
+		printf("FAIL: the network of %d arcs is not shared among threads\n", large.getArcCount());
+		return 0;
+	}
+	solve(large, INTEGRATE_RK4, 0, 1, reference);
+	solve(large, INTEGRATE_RK4, 0, TEAM_THREADS, points);
+	passed &= check("team", "Runge-Kutta", reference, points, 0);
+
+	return passed;
+}
+
+int main(){
+	return IntegratorAgreement::run() ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/**
+ * LgfRoundTrip.cpp
+ *
+ * LEMON Graph Format test: a network written by DerivGraph::exportLgf and read back by DerivGraph::importLgf must be
+ * the same network, with the same molecule kinds, IDs, concentrations and PTM counts, the same interactions between
+ * the same molecules with the same rates, and the same promoters, complex components and complexation pairs.
+ *
+ * Built and run by "make check".
+ */
+
+#include <cstdio>
+#include <unistd.h>
+#include "DerivGraph.h"
+#include "Trace.h"
+
+//the tags are not registered, so the test is silent
+Trace t;
+
+#define LGF_FILE "LgfRoundTrip.lgf"
+
+// rounds of mutations growing the network, and of rate changes after it is grown
+#define GROW_ROUNDS 100
+#define RATE_CHANGES 50
+
+class LgfRoundTrip{
+
+public:
+	static int run();
+
+private:
+	static void grow(DerivGraph&);
+	static int compareNodes(DerivGraph&, DerivGraph&);
+	static int compareArcs(DerivGraph&, DerivGraph&);
+};
+
+/**
+ * void LgfRoundTrip::grow(DerivGraph&)
+ *
+ * Grow the network to its limits with every kind of molecule and interaction, then move the rates and histone
+ * modifications away from the values they were created with.
+ *
+ * @param g the network
+ */
+void LgfRoundTrip::grow(DerivGraph& g){
+
+	for(int round = 0; round < GROW_ROUNDS; round++){
+		if(!g.isLimited(MUT_NEW_BASIC))
+			g.newBasic();
+		if(!g.isLimited(MUT_NEW_PTM))
+			g.newPTM();
+		if(!g.isLimited(MUT_NEW_COMPLEX))
+			g.newComplex();
+		if(!g.isLimited(MUT_NEW_PROMOTER))
+			g.newPromoter();
+	}
+
+	for(int i = 0; i < RATE_CHANGES; i++){
+		g.forwardRateChange();
+		g.reverseRateChange();
+		g.degradationRateChange();
+		g.histoneMod();
+	}
+}
+
+/**
+ * int LgfRoundTrip::compareNodes(DerivGraph&, DerivGraph&)
+ *
+ * @param a the exported network
+ * @param b the imported network
+ *
+ * @return 1 if every node of a has the same molecule as the node with the same id in b, 0 otherwise
+ */
+int LgfRoundTrip::compareNodes(DerivGraph& a, DerivGraph& b){
+
+	SmartDigraph* ga = a.derivs;
+	SmartDigraph* gb = b.derivs;
+	SmartDigraph::NodeMap<Molecule*>& ma = *a.molecules;
+	SmartDigraph::NodeMap<Molecule*>& mb = *b.molecules;
+
+	for(SmartDigraph::NodeIt it(*ga); it != INVALID; ++it){
+
+		int id = ga->id(it);
+		Molecule* x = ma[it];
+		Molecule* y = mb[gb->nodeFromId(id)];
+
+		if(x->kind != y->kind || x->getID() != y->getID() || x->getInitialValue() != y->getInitialValue()){
+			printf("FAIL: node %d is molecule %d of kind %d (%g), not %d of kind %d (%g)\n", id, y->getID(), y->kind, y->getInitialValue(), x->getID(), x->kind, x->getInitialValue());
+			return 0;
+		}
+		for(int p = 0; p < 4; p++){
+			if(x->PTMArray[p] != y->PTMArray[p]){
+				printf("FAIL: molecule %d has %d PTMs of type %d, not %d\n", x->getID(), y->PTMArray[p], p, x->PTMArray[p]);
+				return 0;
+			}
+		}
+
+		if(x->kind == MK_DNA){
+			DNA* dx = (DNA*)x;
+			DNA* dy = (DNA*)y;
+			if(dx->getValue() != dy->getValue() || dx->promoterId != dy->promoterId){
+				printf("FAIL: DNA %d has histone value %g and promoter %d, not %g and %d\n", x->getID(), dy->getValue(), dy->promoterId, dx->getValue(), dx->promoterId);
+				return 0;
+			}
+		}
+
+		//the components are recovered in the order of the forward complexations, which may swap them
+		if(x->kind == MK_COMPLEX){
+			Complex* cx = (Complex*)x;
+			Complex* cy = (Complex*)y;
+			int same = cx->getComponentId(1) == cy->getComponentId(1) && cx->getComponentId(2) == cy->getComponentId(2);
+			int swapped = cx->getComponentId(1) == cy->getComponentId(2) && cx->getComponentId(2) == cy->getComponentId(1);
+			if(!same && !swapped){
+				printf("FAIL: complex %d has components %d and %d, not %d and %d\n", x->getID(), cy->getComponentId(1), cy->getComponentId(2), cx->getComponentId(1), cx->getComponentId(2));
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/**
+ * int LgfRoundTrip::compareArcs(DerivGraph&, DerivGraph&)
+ *
+ * @param a the exported network
+ * @param b the imported network
+ *
+ * @return 1 if every arc of a has the same interaction as the arc with the same id in b, 0 otherwise
+ */
+int LgfRoundTrip::compareArcs(DerivGraph& a, DerivGraph& b){
+
+	SmartDigraph* ga = a.derivs;
+	SmartDigraph* gb = b.derivs;
+	SmartDigraph::ArcMap<Interaction*>& ia = *a.interactions;
+	SmartDigraph::ArcMap<Interaction*>& ib = *b.interactions;
+
+	for(SmartDigraph::ArcIt it(*ga); it != INVALID; ++it){
+
+		int id = ga->id(it);
+		SmartDigraph::Arc other = gb->arcFromId(id);
+		Interaction* x = ia[it];
+		Interaction* y = ib[other];
+
+		if(x->kind != y->kind || x->getRate() != y->getRate() || ga->id(ga->source(it)) != gb->id(gb->source(other)) || ga->id(ga->target(it)) != gb->id(gb->target(other))){
+			printf("FAIL: arc %d is %s (%g) from node %d to %d, not %s (%g) from %d to %d\n", id, y->getName(), y->getRate(), gb->id(gb->source(other)), gb->id(gb->target(other)), x->getName(), x->getRate(), ga->id(ga->source(it)), ga->id(ga->target(it)));
+			return 0;
+		}
+
+		if(x->kind == IK_PROMOTER_BIND){
+			PromoterBind* px = (PromoterBind*)x;
+			PromoterBind* py = (PromoterBind*)y;
+			if(px->kf != py->kf || px->kr != py->kr || px->promoterType != py->promoterType){
+				printf("FAIL: promoter arc %d has kf %g, kr %g and type %d, not %g, %g and %d\n", id, py->kf, py->kr, py->promoterType, px->kf, px->kr, px->promoterType);
+				return 0;
+			}
+		}
+
+		int px = -1, py = -1;
+		if(x->kind == IK_FORWARD_COMPLEXATION){
+			px = ((ForwardComplexation*)x)->pairArcID;
+			py = ((ForwardComplexation*)y)->pairArcID;
+		}
+		else if(x->kind == IK_REVERSE_COMPLEXATION){
+			px = ((ReverseComplexation*)x)->pairArcID;
+			py = ((ReverseComplexation*)y)->pairArcID;
+		}
+		if(px != py){
+			printf("FAIL: complexation arc %d is paired with arc %d, not %d\n", id, py, px);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * int LgfRoundTrip::run()
+ *
+ * @return 1 if the imported network is the exported one, 0 otherwise
+ */
+int LgfRoundTrip::run(){
+
+	DerivGraph a;
+	a.setLimits(4, 3, 3, 3);
+	a.setKineticRateLimits(0, 1);
+	a.setDefaultInitialConc(.5);
+	a.setHill(2);
+	grow(a);
+
+	//every kind of node and arc the format has to carry
+	int kinds[MK_PTM + 1] = { 0 };
+	int promoters = 0, pairs = 0;
+	SmartDigraph::NodeMap<Molecule*>& molecules = *a.molecules;
+	SmartDigraph::ArcMap<Interaction*>& interactions = *a.interactions;
+	for(SmartDigraph::NodeIt it(*a.derivs); it != INVALID; ++it)
+		kinds[molecules[it]->kind]++;
+	for(SmartDigraph::ArcIt it(*a.derivs); it != INVALID; ++it){
+		promoters += interactions[it]->kind == IK_PROMOTER_BIND;
+		pairs += interactions[it]->kind == IK_FORWARD_COMPLEXATION;
+	}
+	if(!kinds[MK_DNA] || !kinds[MK_MRNA] || !kinds[MK_PROTEIN] || !kinds[MK_COMPLEX] || !kinds[MK_PTM] || !promoters || !pairs){
+		printf("FAIL: the grown network lacks a kind of molecule or interaction\n");
+		return 0;
+	}
+
+	if(!a.exportLgf(LGF_FILE)){
+		printf("FAIL: could not write %s\n", LGF_FILE);
+		return 0;
+	}
+
+	DerivGraph b;
+	b.copySettings(&a);
+	int imported = b.importLgf(LGF_FILE);
+	unlink(LGF_FILE);
+	if(!imported){
+		printf("FAIL: could not read %s\n", LGF_FILE);
+		return 0;
+	}
+
+	if(b.getNodeCount() != a.getNodeCount() || b.getArcCount() != a.getArcCount()){
+		printf("FAIL: %d nodes and %d arcs were read, %d and %d written\n", b.getNodeCount(), b.getArcCount(), a.getNodeCount(), a.getArcCount());
+		return 0;
+	}
+
+	if(!compareNodes(a, b) || !compareArcs(a, b))
+		return 0;
+
+	printf("PASS: %d nodes and %d arcs (%d promoters, %d complexation pairs) read back as written\n", a.getNodeCount(), a.getArcCount(), promoters, pairs);
+	return 1;
+}
+
+int main(){
+	return LgfRoundTrip::run() ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+/**
+ * ResumeCheckpoint.cpp
+ *
+ * Checkpoint test: an experiment resumed from the checkpoint of a scoring generation must end as the uninterrupted
+ * run does, with the same scores and the same cells, networks and random generator states. The run stops before the
+ * next scoring generation, so cells rejected by the Hopf screen at the checkpoint are not screened again and have to
+ * keep the score of 0 the screen gave them. Before the run the cells are grown until they score and settle to a stable
+ * steady state, so the molecules of the rejected networks hold the counts of an earlier solution.
+ *
+ * Built and run by "make check".
+ */
+
+#include <cstdio>
+#include <unistd.h>
+#include "Experiment.h"
+#include "Trace.h"
+
+//the tags are not registered, so the test is silent
+Trace t;
+
+#define CELLS 8
+#define INTERVAL 3
+#define CHECKPOINT 3
+#define GENERATIONS 5
+
+// tries at growing a stable network which scores
+#define GROW_TRIES 2000
+
+class ResumeCheckpoint{
+
+public:
+	static int run();
+
+private:
+	static Experiment* create(int);
+	static void record(Experiment*, vector<int>&, vector<Snapshot>&);
+};
+
+/**
+ * Experiment* ResumeCheckpoint::create(int)
+ *
+ * @param checkpoints 1 to save a checkpoint every CHECKPOINT generations
+ *
+ * @return a new experiment scoring every INTERVAL generations, screening for stable steady states and selecting by
+ * tournament
+ */
+Experiment* ResumeCheckpoint::create(int checkpoints){
+
+	Experiment* e = new Experiment(CELLS, GENERATIONS, 3, 2, 2, 2, 0, 1, 20, .05, 0, 1, 1, 0);
+	e->setOutputOptions(0, 0, 0, 0, 0, INTERVAL, 0, 0);
+	e->setSelection(SELECT_TOURNAMENT, 1, 2);
+	e->setHopfScreen(1);
+	if(checkpoints)
+		e->setCheckpointInterval(CHECKPOINT);
+	return e;
+}
+
+/**
+ * void ResumeCheckpoint::record(Experiment*, vector<int>&, vector<Snapshot>&)
+ *
+ * @param e the experiment
+ * @param scores filled with the score of each cell
+ * @param states filled with the serialized state of each cell
+ */
+void ResumeCheckpoint::record(Experiment* e, vector<int>& scores, vector<Snapshot>& states){
+
+	scores.resize(e->cells.size());
+	states.resize(e->cells.size());
+	for(unsigned int c = 0; c < e->cells.size(); c++){
+		scores[c] = e->cells[c]->getScore();
+		e->cells[c]->save(states[c]);
+	}
+}
+
+/**
+ * int ResumeCheckpoint::run()
+ *
+ * @return 1 if the resumed experiment ended as the uninterrupted one, 0 otherwise
+ */
+int ResumeCheckpoint::run(){
+
+	vector<int> scores, resumedScores;
+	vector<Snapshot> states, resumedStates;
+	char file[200];
+
+	Experiment* e = create(1);
+	e->getOutputPath("checkpoint.bin", file, sizeof(file));
+
+	for(unsigned int c = 0; c < e->cells.size(); c++){
+		int grown = 0;
+		for(int i = 0; i < GROW_TRIES && !grown; i++){
+			e->cells[c]->mutate();
+			e->cells[c]->rk();
+			grown = e->cells[c]->getScore() > 0 && e->cells[c]->isStable();
+		}
+	}
+
+	e->start();
+	record(e, scores, states);
+
+	//waits for the checkpoint to be written
+	delete e;
+
+	e = create(0);
+	if(!e->resume(file)){
+		printf("FAIL: could not resume from %s\n", file);
+		delete e;
+		return 0;
+	}
+	e->start();
+	record(e, resumedScores, resumedStates);
+	delete e;
+
+	unlink(file);
+
+	int passed = 1;
+	for(unsigned int c = 0; c < scores.size(); c++){
+		if(resumedScores[c] != scores[c]){
+			printf("FAIL: cell %d scores %d after the resume, not %d\n", c, resumedScores[c], scores[c]);
+			passed = 0;
+		}
+		else if(resumedStates[c].data != states[c].data){
+			printf("FAIL: cell %d differs after the resume\n", c);
+			passed = 0;
+		}
+	}
+
+	if(passed)
+		printf("PASS: resumed at generation %d, %d cells ended as the uninterrupted run\n", CHECKPOINT + 1, CELLS);
+	return passed;
+}
+
+int main(){
+	return ResumeCheckpoint::run() ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/**
+ * ScreenedSelection.cpp
+ *
+ * Selection test: the child of a high scoring cell, rejected by a screen on the next scoring generation, must not
+ * keep the score of its parent. Its mutated network holds the counts its parent's solution left in the molecules, so
+ * without the screen result it ties its parent, comes first in the population order, and is selected in its place.
+ *
+ * Built and run by "make check".
+ */
+
+#include <cstdio>
+#include "Experiment.h"
+#include "Trace.h"
+
+//the tags are not registered, so the test is silent
+Trace t;
+
+// tries at growing a parent network which scores, and at mutating the child away from it
+#define PARENT_TRIES 2000
+
+class ScreenedSelection{
+
+public:
+	static int run();
+};
+
+/**
+ * int ScreenedSelection::run()
+ *
+ * @return 1 if the screened child was not selected, 0 otherwise
+ */
+int ScreenedSelection::run(){
+
+	Experiment e(2, 1, 3, 2, 2, 2, 0, 1, 20, .05, 0, 1, 1, 0);
+	e.setSelection(SELECT_TRUNCATION, 0, 1);
+
+	//the parent comes second in the population order, so a tie is won by the child
+	Cell* child = e.cells[0];
+	Cell* parent = e.cells[1];
+
+	int score = 0;
+	for(int i = 0; i < PARENT_TRIES && score <= 0; i++){
+		parent->mutate();
+		parent->rk();
+		score = parent->getScore();
+	}
+	if(score <= 0){
+		printf("FAIL: no parent network scored after %d mutations\n", PARENT_TRIES);
+		return 0;
+	}
+
+	DerivGraph* network = parent->shareNetwork();
+	child->replaceNetwork(parent->shareNetwork());
+
+	//a mutation may leave the network unchanged, and then still shared with the parent
+	for(int i = 0; i < PARENT_TRIES; i++){
+		child->mutate();
+		DerivGraph* own = child->shareNetwork();
+		own->release();
+		if(own != network)
+			break;
+	}
+	if(child->getScore() != score){
+		printf("FAIL: the child does not start with the score of its parent (%d, not %d)\n", child->getScore(), score);
+		network->release();
+		return 0;
+	}
+
+	//what Experiment::processCell records when the child is screened out
+	child->setRejected(1);
+
+	vector<int> scores, ranking;
+	e.rankCells(scores, ranking);
+	int passed = 1;
+	if(scores[0] != 0 || ranking[0] != 1){
+		printf("FAIL: the screened child scores %d and ranks %s, its parent scores %d\n", scores[0], ranking[0] == 0 ? "first" : "second", scores[1]);
+		passed = 0;
+	}
+
+	//truncation keeps the better half, the parent, and gives its network to the child
+	e.select();
+	DerivGraph* first = child->shareNetwork();
+	DerivGraph* second = parent->shareNetwork();
+	if(first != network || second != network){
+		printf("FAIL: the screened child was selected over its parent (score %d)\n", score);
+		passed = 0;
+	}
+	first->release();
+	second->release();
+	network->release();
+
+	if(passed)
+		printf("PASS: the screened child of a parent scoring %d was not selected\n", score);
+	return passed;
+}
+
+int main(){
+	return ScreenedSelection::run() ? 0 : 1;
+}